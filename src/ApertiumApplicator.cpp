@@ -195,11 +195,28 @@ void ApertiumApplicator::runGrammarOnText(std::istream& input, std::ostream& out
 
 	gWindow->window_span = num_windows;
 
+	// Windows that no rule can see past are run as soon as they are delimited, and written as soon as the next window starts
+	bool eager = false;
+	if (low_latency) {
+		eager = (windows_ahead == 0 && windows_behind == 0);
+		if (!eager && verbosity_level > 0) {
+			u_fprintf(ux_stderr, "Info: Grammar has contexts that span windows - low latency mode keeps %u windows of lookahead.\n", windows_ahead);
+		}
+	}
+
+	// Time from the first character of a request until its null has been written
+	typedef std::chrono::steady_clock clock;
+	std::vector<uint64_t> latencies;
+	clock::time_point request_start;
+	bool in_request = false;
+	bool time_requests = (verbosity_level > 0);
+
 	uint32FlatHashMap variables_set;
 	uint32FlatHashSet variables_rem;
 	uint32SortedVector variables_output;
 
 	ux_stripBOM(input);
+	UStreamReader reader(input);
 
 	auto ensure_endtag = [&]() {
 		if (lSWindow && !lSWindow->cohorts.empty() && lSWindow->cohorts.back()->readings.front()->tags.count(endtag) == 0) {
@@ -242,7 +259,7 @@ void ApertiumApplicator::runGrammarOnText(std::istream& input, std::ostream& out
 		gWindow->shuffleWindowsDown();
 		while (!gWindow->previous.empty()) {
 			SingleWindow* tmp = gWindow->previous.front();
-			printSingleWindow(tmp, output);
+			outputSingleWindow(tmp, output);
 			free_swindow(tmp);
 			gWindow->previous.erase(gWindow->previous.begin());
 		}
@@ -270,13 +287,17 @@ void ApertiumApplicator::runGrammarOnText(std::istream& input, std::ostream& out
 		variables.clear();
 	};
 
-	while ((c = u_fgetc(input)) != U_EOF) {
+	while ((c = reader.getc()) != U_EOF) {
 		if (c == '\n') {
 			++numLines;
 		}
+		if (time_requests && !in_request && !ISSPACE(c)) {
+			request_start = clock::now();
+			in_request = true;
+		}
 
 		if (c == '\\') {
-			auto n = u_fgetc(input);
+			auto n = reader.getc();
 			if (!in_cohort) {
 				blank += c;
 				blank += n;
@@ -290,6 +311,10 @@ void ApertiumApplicator::runGrammarOnText(std::istream& input, std::ostream& out
 
 		if (c == 0) {
 			flush(true);
+			if (in_request) {
+				latencies.push_back(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - request_start).count()));
+				in_request = false;
+			}
 			continue;
 		}
 
@@ -363,6 +388,20 @@ void ApertiumApplicator::runGrammarOnText(std::istream& input, std::ostream& out
 			if (!cSWindow) {
 				ensure_endtag();
 
+				// The blank before this cohort was the last thing that could still change the windows already run
+				if (eager && gWindow->next.empty()) {
+					gWindow->shuffleWindowsDown();
+					while (!gWindow->previous.empty()) {
+						SingleWindow* tmp = gWindow->previous.front();
+						outputSingleWindow(tmp, output);
+						free_swindow(tmp);
+						gWindow->previous.erase(gWindow->previous.begin());
+					}
+					u_fflush(output);
+					lSWindow = nullptr;
+					lCohort = nullptr;
+				}
+
 				cSWindow = gWindow->allocAppendSingleWindow();
 
 				initEmptySingleWindow(cSWindow);
@@ -507,11 +546,21 @@ void ApertiumApplicator::runGrammarOnText(std::istream& input, std::ostream& out
 				did_delim = true;
 			} // end >= hard_limit
 
-			if (did_delim && gWindow->next.size() > num_windows) {
+			if (did_delim && eager) {
+				// DELIMIT may have split off more windows, which are just as complete
+				while (!gWindow->next.empty()) {
+					gWindow->shuffleWindowsDown();
+					runGrammarOnWindow();
+				}
+				if (numWindows % resetAfter == 0) {
+					reclaimTags();
+				}
+			}
+			else if (did_delim && gWindow->next.size() > windows_ahead) {
 				gWindow->shuffleWindowsDown();
 				runGrammarOnWindow();
 				if (numWindows % resetAfter == 0) {
-					resetIndexes();
+					reclaimTags();
 				}
 			}
 			token.clear();
@@ -519,6 +568,14 @@ void ApertiumApplicator::runGrammarOnText(std::istream& input, std::ostream& out
 	}
 
 	flush();
+
+	if (time_requests && !latencies.empty()) {
+		std::sort(latencies.begin(), latencies.end());
+		auto pct = [&](size_t p) {
+			return UI32(latencies[(latencies.size() * p + 99) / 100 - 1]);
+		};
+		u_fprintf(ux_stderr, "Info: %u requests, latency p50 %uus, p90 %uus, p99 %uus, max %uus.\n", UI32(latencies.size()), pct(50), pct(90), pct(99), UI32(latencies.back()));
+	}
 } // runGrammarOnText
 
 /*
@@ -662,7 +719,7 @@ void ApertiumApplicator::testPR(std::ostream& output) {
 	for (size_t i = 0; i < 6; ++i) {
 		UString text(texts[i].begin(), texts[i].end());
 		Reading* reading = alloc_reading();
-		processReading(reading, text, grammar->single_tags[grammar->tag_any]);
+		processReading(reading, text, single_tags[grammar->tag_any]);
 		if (grammar->sub_readings_ltr && reading->next) {
 			reading = reverse(reading);
 		}
@@ -680,7 +737,7 @@ void ApertiumApplicator::printReading(const Reading* reading, std::ostream& outp
 
 	if (reading->baseform) {
 		// Lop off the initial and final '"' characters
-		UnicodeString bf(grammar->single_tags[reading->baseform]->tag.data() + 1, SI32(grammar->single_tags[reading->baseform]->tag.size() - 2));
+		UnicodeString bf(single_tags[reading->baseform]->tag.data() + 1, SI32(single_tags[reading->baseform]->tag.size() - 2));
 
 		if (wordform_case) {
 			if (casing == ApertiumCasing::Upper) {
@@ -709,7 +766,7 @@ void ApertiumApplicator::printReading(const Reading* reading, std::ostream& outp
 		}
 		u_fprintf(output, "%S", bf_escaped.data());
 
-		// Tag::printTagRaw(output, grammar->single_tags[reading->baseform]);
+		// Tag::printTagRaw(output, single_tags[reading->baseform]);
 	}
 
 	if(surface_readings && !trace) {
@@ -725,7 +782,7 @@ void ApertiumApplicator::printReading(const Reading* reading, std::ostream& outp
 	Reading::tags_list_t multitags_list; // everything after a +, until the first MAPPING tag
 	bool multi = false;
 	for (auto tter : reading->tags_list) {
-		const Tag* tag = grammar->single_tags[tter];
+		const Tag* tag = single_tags[tter];
 		if (tag->tag[0] == '+') {
 			multi = true;
 		}
@@ -758,16 +815,24 @@ void ApertiumApplicator::printReading(const Reading* reading, std::ostream& outp
 		if (tter == endtag || tter == begintag) {
 			continue;
 		}
-		const Tag* tag = grammar->single_tags[tter];
+		const Tag* tag = single_tags[tter];
 		if (!(tag->type & T_BASEFORM) && !(tag->type & T_WORDFORM)) {
 			if (tag->tag[0] == '+') {
-				u_fprintf(output, "%S", tag->tag.data());
+				tag->printUTF8(output);
 			}
 			else if (tag->tag[0] == '&') {
 				u_fprintf(output, "%S<%S%S>", escape.data(), substr(tag->tag, 2).data(), escape.data());
 			}
 			else {
-				u_fprintf(output, "%S<%S%S>", escape.data(), tag->tag.data(), escape.data());
+				if (surface_readings) {
+					output.put('\\');
+				}
+				output.put('<');
+				tag->printUTF8(output);
+				if (surface_readings) {
+					output.put('\\');
+				}
+				output.put('>');
 			}
 		}
 	}
@@ -888,15 +953,17 @@ void ApertiumApplicator::printCohort(Cohort* cohort, std::ostream& output, bool
 				if (tter == cohort->wordform->hash) {
 					continue;
 				}
-				const Tag* tag = grammar->single_tags[tter];
-				u_fprintf(output, "<%S>", tag->tag.data());
+				const Tag* tag = single_tags[tter];
+				output.put('<');
+				tag->printUTF8(output);
+				output.put('>');
 			}
 		}
 	}
 
 	bool need_slash = print_word_forms;
 
-	//Tag::printTagRaw(output, grammar->single_tags[cohort->wordform]);
+	//Tag::printTagRaw(output, single_tags[cohort->wordform]);
 	std::sort(cohort->readings.begin(), cohort->readings.end(), Reading::cmp_number);
 	for (auto reading : cohort->readings) {
 		if (reading->noprint) {
@@ -38,6 +38,7 @@ public:
 	bool print_only_first = false;
 	bool delimit_lexical_units = true; // Should cohorts be surrounded by ^$ ?
 	bool surface_readings = false;	   // Should readings have escaped symbols as if they were surface forms?
+	bool low_latency = false;	       // Run and write each window as soon as no later input can change it
 
 	void testPR(std::ostream& output);
 
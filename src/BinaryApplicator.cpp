@@ -60,11 +60,15 @@ void BinaryApplicator::runGrammarOnText(std::istream& input, std::ostream& outpu
 			u_fprintf(ux_stderr, "Error: Stream does not start with magic bytes - cannot read as binary!\n");
 			CG3Quit(1);
 		}
-		uint32_t version = reinterpret_cast<uint32_t*>(&header[4])[0];
-		if (version != CG3_BINARY_STREAM) {
-			u_fprintf(ux_stderr, "Error: Stream is version %u but this reader only knows version %u!\n", version, CG3_BINARY_STREAM);
+		uint32_t version = 0;
+		memcpy(&version, &header[4], sizeof(version));
+		be::little_to_native_inplace(version);
+		if (version == 0 || version > CG3_BINARY_STREAM) {
+			u_fprintf(ux_stderr, "Error: Stream is version %u but this reader only knows versions 1 through %u!\n", version, CG3_BINARY_STREAM);
 			CG3Quit(1);
 		}
+		stream_version = version;
+		stream_tags.clear();
 	}
 
 	index();
@@ -87,7 +91,7 @@ void BinaryApplicator::runGrammarOnText(std::istream& input, std::ostream& outpu
 		gWindow->shuffleWindowsDown();
 		while (!gWindow->previous.empty()) {
 			SingleWindow* tmp = gWindow->previous.front();
-			printSingleWindow(tmp, output);
+			outputSingleWindow(tmp, output);
 			free_swindow(tmp);
 			gWindow->previous.erase(gWindow->previous.begin());
 		}
@@ -100,11 +104,11 @@ void BinaryApplicator::runGrammarOnText(std::istream& input, std::ostream& outpu
 		if (packet.type == BFP_WINDOW) {
 			//auto cSWindow = static_cast<SingleWindow*>(packet.payload);
 			++numWindows;
-			if (gWindow->next.size() > num_windows) {
+			if (gWindow->next.size() > windows_ahead) {
 				gWindow->shuffleWindowsDown();
 				runGrammarOnWindow();
 				if (numWindows % resetAfter == 0) {
-					resetIndexes();
+					reclaimTags();
 				}
 			}
 		}
@@ -166,7 +170,7 @@ void BinaryApplicator::readWindow(void*& payload) {
 	uint32_t pos = 0;
 
 	auto READ_U16_INTO = [&](uint16_t& dest) {
-		dest = *reinterpret_cast<uint16_t*>(&buf[pos]);
+		memcpy(&dest, &buf[pos], sizeof(dest));
 		be::little_to_native_inplace(dest);
 		pos += sizeof(dest);
 	};
@@ -178,7 +182,7 @@ void BinaryApplicator::readWindow(void*& payload) {
 	};
 
 	auto READ_U32_INTO = [&](uint32_t& dest) {
-		dest = *reinterpret_cast<uint32_t*>(&buf[pos]);
+		memcpy(&dest, &buf[pos], sizeof(dest));
 		be::little_to_native_inplace(dest);
 		pos += sizeof(dest);
 	};
@@ -205,31 +209,49 @@ void BinaryApplicator::readWindow(void*& payload) {
 	if (flags & BFW_DEP_SPAN) {
 		dep_has_spanned = true;
 	}
+	if (flags & BFW_TAGS_RESET) {
+		stream_tags.clear();
+	}
 
-	TagVector window_tags;
+	// Version 1 streams have a table of all tags used in each window, while later versions only send the tags not seen before
+	TagVector v1_tags;
 	auto tag_count = READ_U16();
-	window_tags.reserve(tag_count);
+	UString tg;
 	for (uint16_t i = 0; i < tag_count; ++i) {
-		UString tg;
 		READ_STR_INTO(tg);
-		window_tags.push_back(addTag(tg));
-		if (tg[0] == grammar->mapping_prefix) {
-			window_tags.back()->type |= T_MAPPING;
+		auto tag = addTag(tg);
+		if (stream_version == 1) {
+			v1_tags.push_back(tag);
 		}
 		else {
-			window_tags.back()->type &= ~T_MAPPING;
+			stream_tags.emplace_back();
+			stream_tags.back().text = tg;
+			stream_tags.back().tag = tag;
+			stream_tags.back().epoch = tag_epoch;
 		}
 	}
 
+	auto READ_TAG = [&]() {
+		if (stream_version == 1) {
+			return v1_tags[READ_U16()];
+		}
+		// Later windows may refer to a tag long after reclaimTags() freed it, so look it up again once per epoch
+		auto& st = stream_tags[READ_U32()];
+		if (st.epoch != tag_epoch) {
+			st.tag = addTag(st.text);
+			st.epoch = tag_epoch;
+		}
+		return st.tag;
+	};
+
 	auto var_count = READ_U16();
 	for (uint16_t vn = 0; vn < var_count; ++vn) {
 		char mode = buf[pos];
 		++pos;
-		auto tag1 = READ_U16();
-		auto tag2 = READ_U16();
-		auto hash1 = window_tags[tag1]->hash;
+		auto hash1 = READ_TAG()->hash;
+		auto tag2 = READ_TAG();
 		if (mode == BFV_SETVAR) {
-			cSWindow->variables_set[hash1] = window_tags[tag2]->hash;
+			cSWindow->variables_set[hash1] = tag2->hash;
 			cSWindow->variables_rem.erase(hash1);
 			cSWindow->variables_output.insert(hash1);
 		}
@@ -249,7 +271,6 @@ void BinaryApplicator::readWindow(void*& payload) {
 	READ_STR_INTO(cSWindow->text_post);
 
 	auto cohort_count = READ_U16();
-	uint16_t tag;
 	for (uint16_t cn = 0; cn < cohort_count; ++cn) {
 		Cohort* cCohort = alloc_cohort(cSWindow);
 		cCohort->global_number = gWindow->cohort_counter++;
@@ -261,16 +282,14 @@ void BinaryApplicator::readWindow(void*& payload) {
 			has_relations = true;
 		}
 
-		READ_U16_INTO(tag);
-		cCohort->wordform = window_tags[tag];
+		cCohort->wordform = READ_TAG();
 
 		READ_U16_INTO(tag_count);
 		if (tag_count) {
 			cCohort->wread = alloc_reading(cCohort);
 			addTagToReading(*cCohort->wread, cCohort->wordform);
 			for (uint16_t tn = 0; tn < tag_count; ++tn) {
-				READ_U16_INTO(tag);
-				addTagToReading(*cCohort->wread, window_tags[tag], (tn + 1 == tag_count));
+				addTagToReading(*cCohort->wread, READ_TAG(), (tn + 1 == tag_count));
 			}
 		}
 
@@ -284,9 +303,9 @@ void BinaryApplicator::readWindow(void*& payload) {
 
 		auto rel_count = READ_U16();
 		for (uint16_t rn = 0; rn < rel_count; ++rn) {
-			READ_U16_INTO(tag);
+			auto tag = READ_TAG();
 			auto head = READ_U32();
-			cCohort->relations_input[window_tags[tag]->hash].insert(head);
+			cCohort->relations_input[tag->hash].insert(head);
 		}
 		if (rel_count) {
 			has_relations = true;
@@ -308,18 +327,17 @@ void BinaryApplicator::readWindow(void*& payload) {
 
 			READ_U16_INTO(flags);
 
-			READ_U16_INTO(tag);
-			addTagToReading(*cReading, window_tags[tag]);
+			addTagToReading(*cReading, READ_TAG());
 
 			READ_U16_INTO(tag_count);
 			TagList mappings;
 			for (uint16_t tn = 0; tn < tag_count; ++tn) {
-				READ_U16_INTO(tag);
-				if (window_tags[tag]->type & T_MAPPING) {
-					mappings.push_back(window_tags[tag]);
+				auto tag = READ_TAG();
+				if (tag->type & T_MAPPING) {
+					mappings.push_back(tag);
 				}
 				else {
-					addTagToReading(*cReading, window_tags[tag]);
+					addTagToReading(*cReading, tag);
 				}
 			}
 			if (!mappings.empty()) {
@@ -364,42 +382,54 @@ void BinaryApplicator::readText(void*& payload) {
 	payload = &text;
 }
 
+void BinaryApplicator::printStreamHeader(std::ostream& output) {
+	if (header_done) {
+		return;
+	}
+	output.write("CGBF", 4);
+	writeLE(output, CG3_BINARY_STREAM);
+	header_done = true;
+	stream_tag_ids.clear();
+	stream_tag_ids_epoch = tag_epoch;
+}
+
 void BinaryApplicator::printSingleWindow(SingleWindow* window, std::ostream& output, bool profiling) {
 	(void)profiling;
 
-	if (!header_done) {
-		output.write("CGBF", 4);
-		writeLE(output, CG3_BINARY_STREAM);
-		header_done = true;
-	}
+	printStreamHeader(output);
 
 	writeLE(output, UI8(BFP_WINDOW));
 
+	// Tag hashes may have been given to other tags since reclaimTags() last ran, so the reader has to start over too
+	bool tags_reset = false;
+	if (stream_tag_ids_epoch != tag_epoch) {
+		stream_tag_ids.clear();
+		stream_tag_ids_epoch = tag_epoch;
+		tags_reset = true;
+	}
+
 	TagVector tags_to_write;
-	std::map<Tag*, uint16_t> tag_index;
 
 	auto WRITE_U16_INTO = [&](uint16_t n, std::string& buffer) {
 		be::native_to_little_inplace(n);
-		auto chr = reinterpret_cast<char*>(&n);
-		buffer += chr[0];
-		buffer += chr[1];
+		buffer.append(reinterpret_cast<const char*>(&n), sizeof(n));
 	};
 
 	auto WRITE_U32_INTO = [&](uint32_t n, std::string& buffer) {
 		be::native_to_little_inplace(n);
-		auto chr = reinterpret_cast<char*>(&n);
-		buffer += chr[0];
-		buffer += chr[1];
-		buffer += chr[2];
-		buffer += chr[3];
+		buffer.append(reinterpret_cast<const char*>(&n), sizeof(n));
 	};
 
 	auto WRITE_TAG_INTO = [&](Tag* tag, std::string& buffer) {
-		if (tag_index.find(tag) == tag_index.end()) {
-			tag_index[tag] = UI16(tags_to_write.size());
-			tags_to_write.push_back(tag);
-		}
-		WRITE_U16_INTO(tag_index[tag], buffer);
+		auto it = stream_tag_ids.find(tag->hash);
+		if (it != stream_tag_ids.end()) {
+			WRITE_U32_INTO(it->second, buffer);
+			return;
+		}
+		auto id = UI32(stream_tag_ids.size());
+		stream_tag_ids[tag->hash] = id;
+		tags_to_write.push_back(tag);
+		WRITE_U32_INTO(id, buffer);
 	};
 
 	auto WRITE_STR_INTO = [&](const UString& s, std::string& buffer) {
@@ -416,24 +446,24 @@ void BinaryApplicator::printSingleWindow(SingleWindow* window, std::ostream& out
 	std::string var_buffer;
 	for (auto var : window->variables_output) {
 		++var_count;
-		Tag* key = grammar->single_tags[var];
+		Tag* key = single_tags[var];
 		auto iter = window->variables_set.find(var);
 		if (iter != window->variables_set.end()) {
 			if (iter->second != grammar->tag_any) {
 				var_buffer += static_cast<char>(BFV_SETVAR);
 				WRITE_TAG_INTO(key, var_buffer);
-				WRITE_TAG_INTO(grammar->single_tags[iter->second], var_buffer);
+				WRITE_TAG_INTO(single_tags[iter->second], var_buffer);
 			}
 			else {
 				var_buffer += static_cast<char>(BFV_SETVAR_ANY);
 				WRITE_TAG_INTO(key, var_buffer);
-				WRITE_U16_INTO(0, var_buffer);
+				WRITE_U32_INTO(0, var_buffer);
 			}
 		}
 		else {
 			var_buffer += static_cast<char>(BFV_REMVAR);
 			WRITE_TAG_INTO(key, var_buffer);
-			WRITE_U16_INTO(0, var_buffer);
+			WRITE_U32_INTO(0, var_buffer);
 		}
 	}
 
@@ -478,7 +508,7 @@ void BinaryApplicator::printSingleWindow(SingleWindow* window, std::ostream& out
 				if (tter == cohort->wordform->hash) {
 					continue;
 				}
-				WRITE_TAG_INTO(grammar->single_tags[tter], tag_buffer);
+				WRITE_TAG_INTO(single_tags[tter], tag_buffer);
 				++tag_count;
 			}
 			WRITE_U16_INTO(tag_count, cohort_buffer);
@@ -510,9 +540,9 @@ void BinaryApplicator::printSingleWindow(SingleWindow* window, std::ostream& out
 		std::string rel_buffer;
 		uint16_t rel_count = 0;
 		for (const auto& miter : cohort->relations) {
-			auto it = grammar->single_tags.find(miter.first);
-			if (it == grammar->single_tags.end()) {
-				it = grammar->single_tags.find(miter.first);
+			auto it = single_tags.find(miter.first);
+			if (it == single_tags.end()) {
+				it = single_tags.find(miter.first);
 			}
 			for (auto siter : miter.second) {
 				++rel_count;
@@ -541,12 +571,12 @@ void BinaryApplicator::printSingleWindow(SingleWindow* window, std::ostream& out
 					flags |= BFR_SUBREADING;
 				}
 				WRITE_U16_INTO(flags, reading_buffer);
-				WRITE_TAG_INTO(grammar->single_tags[reading->baseform], reading_buffer);
+				WRITE_TAG_INTO(single_tags[reading->baseform], reading_buffer);
 				std::string tag_buffer;
 				uint16_t tag_count = 0;
 				uint32SortedVector unique;
 				for (auto& tter : reading->tags_list) {
-					auto tag = grammar->single_tags[tter];
+					auto tag = single_tags[tter];
 					if (tter == reading->baseform || tter == reading->parent->wordform->hash) {
 						continue;
 					}
@@ -577,11 +607,15 @@ void BinaryApplicator::printSingleWindow(SingleWindow* window, std::ostream& out
 	if (dep_has_spanned) {
 		flags |= BFW_DEP_SPAN;
 	}
+	if (tags_reset) {
+		flags |= BFW_TAGS_RESET;
+	}
 	WRITE_U16_INTO(flags, header_buffer);
 
 	WRITE_U16_INTO(UI16(tags_to_write.size()), header_buffer);
-	for (auto& tag : tags_to_write) {
-		WRITE_STR_INTO(tag->tag, header_buffer);
+	for (auto tag : tags_to_write) {
+		WRITE_U16_INTO(UI16(tag->tag_u8.size()), header_buffer);
+		header_buffer += tag->tag_u8;
 	}
 
 	WRITE_U16_INTO(var_count, header_buffer);
@@ -605,11 +639,7 @@ void BinaryApplicator::printSingleWindow(SingleWindow* window, std::ostream& out
 }
 
 void BinaryApplicator::printStreamCommand(UStringView cmd, std::ostream& output) {
-	if (!header_done) {
-		output.write("CGBF", 4);
-		writeLE(output, CG3_BINARY_STREAM);
-		header_done = true;
-	}
+	printStreamHeader(output);
 
 	writeLE(output, UI8(BFP_COMMAND));
 	if (cmd == STR_CMD_FLUSH) {
@@ -627,11 +657,7 @@ void BinaryApplicator::printStreamCommand(UStringView cmd, std::ostream& output)
 }
 
 void BinaryApplicator::printPlainTextLine(UStringView line, std::ostream& output) {
-	if (!header_done) {
-		output.write("CGBF", 4);
-		writeLE(output, CG3_BINARY_STREAM);
-		header_done = true;
-	}
+	printStreamHeader(output);
 
 	writeLE(output, UI8(BFP_TEXT));
 	writeUTF8_LE(output, line);
@@ -28,6 +28,7 @@ namespace CG3 {
 enum BinaryFormatFlags {
 	// Window
 	BFW_DEP_SPAN      = (1 << 0),
+	BFW_TAGS_RESET    = (1 << 1),
 	// Cohort
 	BFC_RELATED       = (1 << 0),
 	// Reading
@@ -72,6 +73,18 @@ protected:
 private:
 	bool header_done = false;
 	UString text;
+	// Tags are sent once per stream and then referred to by their position in these, until the writer starts over
+	uint32_t stream_version = 0;
+	struct stream_tag_t {
+		UString text;
+		Tag* tag = nullptr;
+		// The tag is only known to exist in the epoch it was looked up in; after that, reclaimTags() may have freed it
+		uint32_t epoch = 0;
+	};
+	std::vector<stream_tag_t> stream_tags;
+	uint32FlatHashMap stream_tag_ids;
+	uint32_t stream_tag_ids_epoch = 0;
+	void printStreamHeader(std::ostream& output);
 	BinaryPacket readPacket();
 	void readWindow(void*& payload);
 	void readCommand(void*& payload);
@@ -21,6 +21,11 @@
 #include "Strings.hpp"
 #include "Grammar.hpp"
 
+#ifndef _WIN32
+	#include <sys/mman.h>
+	#include <fcntl.h>
+#endif
+
 namespace CG3 {
 
 BinaryGrammar::BinaryGrammar(Grammar& res, std::ostream& ux_err)
@@ -53,10 +58,31 @@ int BinaryGrammar::parse_grammar(const char* filename) {
 		grammar->grammar_size = static_cast<size_t>(_stat.st_size);
 	}
 
+#ifndef _WIN32
+	// Map the file rather than read it, so the loader works straight from the page cache without an extra copy, and
+	// grammars of a mapped revision keep using the mapping for as long as they live
+	if (grammar->grammar_size) {
+		int fd = open(filename, O_RDONLY);
+		if (fd != -1) {
+			void* map = mmap(nullptr, grammar->grammar_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			close(fd);
+			if (map != MAP_FAILED) {
+				auto size = grammar->grammar_size;
+				image.reset(static_cast<const char*>(map), [size](const char* p) { munmap(const_cast<char*>(p), size); });
+				int rv = parse_grammar(image.get(), size);
+				image.reset();
+				return rv;
+			}
+		}
+	}
+#endif
+
 	std::ifstream input;
 	input.exceptions(std::ios::failbit | std::ios::eofbit | std::ios::badbit);
 	input.open(filename, std::ios::binary);
 
-	return parse_grammar(input);
+	std::string buffer(grammar->grammar_size, 0);
+	input.read(&buffer[0], buffer.size());
+	return parse_grammar(buffer.data(), buffer.size());
 }
 }
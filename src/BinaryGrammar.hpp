@@ -25,6 +25,7 @@
 
 namespace CG3 {
 class ContextualTest;
+class Rule;
 
 enum : uint32_t {
 	BINF_DEP          = (1 <<  0),
@@ -45,10 +46,93 @@ enum : uint32_t {
 	BINF_ORDERED      = (1 << 15),
 	BINF_TEXT_DELIMS  = (1 << 16),
 	BINF_ADDCOHORT_ATTACH = (1 << 17),
+	BINF_REACH        = (1 << 18),
 };
 
 constexpr uint32_t BIN_REV_ANCIENT = 10297;
 constexpr uint32_t BIN_REV_CMDARGS = 13898;
+constexpr uint32_t BIN_REV_MAPPED = 13899;
+
+/*
+ * From BIN_REV_MAPPED on, the revision is followed by a byte order mark, a table of sections, and the sections
+ * themselves at 8 byte aligned offsets. Apart from the stream section, the sections are arrays of native 32 bit
+ * words (or UTF-16 for the strings) that the loader reads straight from the mapped file, so a grammar loads without
+ * decoding its tags, set tries, and rules field by field. Tags and rules are copied out, but the set tries stay in
+ * the mapping and are used from there. A file from a machine of the other byte order is swapped into private
+ * memory first.
+ */
+constexpr uint32_t BIN_BYTE_ORDER = 0x01020304;
+
+enum : uint32_t {
+	BINS_STREAM  = 1, // Everything else, in the big-endian encoding of older revisions, minus tags, rules, and the plain set tries
+	BINS_STRINGS = 2, // UTF-16 text that tags and rules refer to
+	BINS_U32     = 3, // Lists that tags, sets, and rules refer to
+	BINS_TAGS    = 4, // mapped_tag by tag number
+	BINS_SETS    = 5, // mapped_set by set number
+	BINS_TRIES   = 6, // flat_trie_node_t of all sets
+	BINS_RULES   = 7, // mapped_rule by rule number
+};
+
+struct mapped_section {
+	uint32_t id;
+	uint32_t offset;
+	uint32_t count;
+};
+
+enum : uint32_t {
+	MT_REGEXP   = (1 << 0),
+	MT_VS_SETS  = (1 << 1),
+	MT_VS_NAMES = (1 << 2),
+};
+
+constexpr uint32_t MAPPED_NONE = std::numeric_limits<uint32_t>::max();
+
+// Ranges are (first, size) into BINS_STRINGS or BINS_U32, and 64 bit values are stored as low and high words
+struct mapped_tag {
+	uint32_t hash;
+	uint32_t plain_hash;
+	uint32_t seed;
+	uint32_t type;
+	uint32_t comparison_hash;
+	uint32_t comparison_op;
+	uint32_t comparison_val[2];
+	uint32_t variable_hash;
+	uint32_t context_ref_pos;
+	uint32_t flags;
+	uint32_t tag[2];
+	uint32_t regexp[2];
+	uint32_t vs_sets[2];
+	uint32_t vs_names[2]; // Pairs of string ranges
+};
+
+struct mapped_set {
+	uint32_t trie[2];
+	uint32_t keys[2];
+};
+
+struct mapped_rule {
+	uint32_t section;
+	uint32_t type;
+	uint32_t line;
+	uint32_t number;
+	uint32_t flags[2];
+	uint32_t name[2];
+	uint32_t target;
+	uint32_t wordform; // Tag number or MAPPED_NONE
+	uint32_t varname;
+	uint32_t varvalue;
+	uint32_t sub_reading;
+	uint32_t childset1;
+	uint32_t childset2;
+	uint32_t maplist; // Set number or MAPPED_NONE
+	uint32_t sublist; // Set number or MAPPED_NONE
+	uint32_t dep_target;
+	uint32_t dep_tests[2];
+	uint32_t tests[2];
+	uint32_t sub_rules[2];
+};
+
+static_assert(sizeof(mapped_tag) % 4 == 0 && sizeof(mapped_set) % 4 == 0 && sizeof(mapped_rule) % 4 == 0, "Mapped records must be plain 32 bit words");
 
 class BinaryGrammar : public IGrammarParser {
 public:
@@ -68,8 +152,10 @@ private:
 	int parse_grammar(UString& buffer) override;
 
 	Grammar* grammar = nullptr;
+	// The file that parse_grammar(filename) mapped, handed on to the grammar if it is of a mapped revision
+	std::shared_ptr<const char> image;
 	void writeContextualTest(ContextualTest* t, std::ostream& output);
-	ContextualTest* readContextualTest(std::istream& input);
+	ContextualTest* readContextualTest(buffer_reader& input);
 
 	typedef std::unordered_map<ContextualTest*, uint32_t> deferred_t;
 	deferred_t deferred_tmpls;
@@ -78,6 +164,14 @@ private:
 
 	uint32FlatHashSet seen_uint32;
 
+	// Which sets the varstring tags use; they can't be assigned until the sets are loaded
+	typedef std::map<uint32_t, uint32Vector> tag_varsets_t;
+	tag_varsets_t tag_varsets;
+
+	int readBinaryGrammar(buffer_reader& input, uint32_t bin_revision);
+	int readMappedGrammar(const char* buffer, size_t length, uint32_t bin_revision);
+	void filterRule(Rule* r);
+
 	int readBinaryGrammar_10043(std::istream& input);
 	ContextualTest* readContextualTest_10043(std::istream& input);
 };
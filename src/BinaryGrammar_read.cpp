@@ -36,26 +36,19 @@ int BinaryGrammar::parse_grammar(const std::string& buffer) {
 	return parse_grammar(buffer.data(), buffer.size());
 }
 
-int BinaryGrammar::parse_grammar(const char* buffer, size_t length) {
-	std::stringstream input;
-	input.write(buffer, length);
-	input.seekg(0);
-	return parse_grammar(input);
-}
-
 int BinaryGrammar::parse_grammar(std::istream& input) {
-	input.exceptions(std::ios::failbit | std::ios::eofbit | std::ios::badbit);
+	std::string buffer{ std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>() };
+	return parse_grammar(buffer.data(), buffer.size());
+}
 
-	uint32_t u32tmp = 0;
-	int32_t i32tmp = 0;
-	UErrorCode err = U_ZERO_ERROR;
-	UConverter* conv = ucnv_open("UTF-8", &err);
-	std::stringstream buffer;
+int BinaryGrammar::parse_grammar(const char* buf, size_t length) {
+	buffer_reader input(buf, length);
 
-	if (!input.read(&cbuffers[0][0], 4)) {
+	if (input.remaining() < 4) {
 		std::cerr << "Error: Error reading first 4 bytes from grammar!" << std::endl;
 		CG3Quit(1);
 	}
+	input.read(&cbuffers[0][0], 4);
 	if (!is_cg3b(cbuffers[0])) {
 		u_fprintf(ux_stderr, "Error: Grammar does not begin with magic bytes - cannot load as binary!\n");
 		CG3Quit(1);
@@ -67,8 +60,9 @@ int BinaryGrammar::parse_grammar(std::istream& input) {
 			u_fprintf(ux_stderr, "Warning: Grammar revision is %u, but current format is %u or later. Please recompile the binary grammar with latest CG-3.\n", bin_revision, CG3_FEATURE_REV);
 			u_fflush(ux_stderr);
 		}
-		input.seekg(0);
-		return readBinaryGrammar_10043(input);
+		std::istringstream ancient(std::string(buf, length));
+		ancient.exceptions(std::ios::failbit | std::ios::eofbit | std::ios::badbit);
+		return readBinaryGrammar_10043(ancient);
 	}
 	if (bin_revision < CG3_TOO_OLD) {
 		u_fprintf(ux_stderr, "Error: Grammar revision is %u, but this loader requires %u or later!\n", bin_revision, CG3_TOO_OLD);
@@ -79,6 +73,18 @@ int BinaryGrammar::parse_grammar(std::istream& input) {
 		CG3Quit(1);
 	}
 
+	if (bin_revision >= BIN_REV_MAPPED) {
+		return readMappedGrammar(buf, length, bin_revision);
+	}
+	return readBinaryGrammar(input, bin_revision);
+}
+
+int BinaryGrammar::readBinaryGrammar(buffer_reader& input, uint32_t bin_revision) {
+	uint32_t u32tmp = 0;
+	int32_t i32tmp = 0;
+	UErrorCode err = U_ZERO_ERROR;
+	UConverter* conv = ucnv_open("UTF-8", &err);
+
 	grammar->is_binary = true;
 
 	auto fields = readBE<uint32_t>(input);
@@ -111,17 +117,16 @@ int BinaryGrammar::parse_grammar(std::istream& input) {
 		}
 	}
 
-	// Keep track of which sets that the varstring tags used; we can't just assign them as sets are not loaded yet
-	typedef std::map<uint32_t, uint32Vector> tag_varsets_t;
-	tag_varsets_t tag_varsets;
-
 	u32tmp = 0;
 	if (fields & BINF_TAGS) {
 		u32tmp = readBE<uint32_t>(input);
 	}
 	auto num_single_tags = u32tmp;
-	grammar->num_tags = num_single_tags;
-	grammar->single_tags_list.resize(num_single_tags);
+	// Mapped revisions have no tags here, but loaded them from their own section before this
+	if (num_single_tags) {
+		grammar->num_tags = num_single_tags;
+		grammar->single_tags_list.resize(num_single_tags);
+	}
 	for (uint32_t i = 0; i < num_single_tags; ++i) {
 		Tag* t = grammar->allocateTag();
 
@@ -159,12 +164,7 @@ int BinaryGrammar::parse_grammar(std::istream& input) {
 			}
 		}
 		if (fields & (1 << 12)) {
-			char buf[sizeof(uint64_t) + sizeof(int32_t)] = {};
-			input.read(&buf[0], sizeof(buf));
-			buffer.str("");
-			buffer.clear();
-			buffer.write(buf, sizeof(buf));
-			t->comparison_val = readBE<double>(buffer);
+			t->comparison_val = readBE<double>(input);
 		}
 
 		if (fields & (1 << 8)) {
@@ -184,19 +184,8 @@ int BinaryGrammar::parse_grammar(std::istream& input) {
 				input.read(&cbuffers[0][0], u32tmp);
 				i32tmp = ucnv_toUChars(conv, &gbuffers[0][0], CG3_BUFFER_SIZE - 1, &cbuffers[0][0], u32tmp, &err);
 
-				UParseError pe;
-				UErrorCode status = U_ZERO_ERROR;
-
-				if (t->type & T_CASE_INSENSITIVE) {
-					t->regexp = uregex_open(&gbuffers[0][0], i32tmp, UREGEX_CASE_INSENSITIVE, &pe, &status);
-				}
-				else {
-					t->regexp = uregex_open(&gbuffers[0][0], i32tmp, 0, &pe, &status);
-				}
-				if (status != U_ZERO_ERROR) {
-					u_fprintf(ux_stderr, "Error: uregex_open returned %s trying to parse tag %S - cannot continue!\n", u_errorName(status), t->tag.data());
-					CG3Quit(1);
-				}
+				// Compiled on first use, as most regex tags are never tried against most input
+				t->regexp_src.reset(new UString(&gbuffers[0][0], i32tmp));
 			}
 		}
 
@@ -238,6 +227,10 @@ int BinaryGrammar::parse_grammar(std::istream& input) {
 			grammar->tag_any = t->hash;
 		}
 	}
+	// The compiler already classified all tags against the grammar's own patterns, so reindex() need not do that again
+	for (auto t : grammar->single_tags_list) {
+		grammar->addTextualPattern(t);
+	}
 
 	u32tmp = 0;
 	if (fields & BINF_REOPEN_MAP) {
@@ -345,6 +338,10 @@ int BinaryGrammar::parse_grammar(std::istream& input) {
 	for (const auto& iter : tag_varsets) {
 		Tag* t = grammar->single_tags_list[iter.first];
 		for (auto uit : iter.second) {
+			if (uit >= grammar->sets_list.size()) {
+				u_fprintf(ux_stderr, "Error: Tag %u refers to set %u which does not exist - cannot load as binary!\n", iter.first, uit);
+				CG3Quit(1);
+			}
 			Set* s = grammar->sets_list[uit];
 			t->vs_sets->push_back(s);
 		}
@@ -483,24 +480,7 @@ int BinaryGrammar::parse_grammar(std::istream& input) {
 			}
 		}
 
-		UErrorCode status;
-		if (nrules) {
-			status = U_ZERO_ERROR;
-			uregex_setText(nrules, r->name.c_str(), SI32(r->name.size()), &status);
-			status = U_ZERO_ERROR;
-			if (!uregex_find(nrules, -1, &status)) {
-				r->type = K_IGNORE;
-			}
-		}
-		if (nrules_inv) {
-			status = U_ZERO_ERROR;
-			uregex_setText(nrules_inv, r->name.c_str(), SI32(r->name.size()), &status);
-			status = U_ZERO_ERROR;
-			if (uregex_find(nrules_inv, -1, &status)) {
-				r->type = K_IGNORE;
-			}
-		}
-
+		filterRule(r);
 		grammar->rule_by_number[r->number] = r;
 	}
 
@@ -517,11 +497,264 @@ int BinaryGrammar::parse_grammar(std::istream& input) {
 		}
 	}
 
+	if (fields & BINF_REACH) {
+		u32tmp = readBE<uint32_t>(input);
+		for (uint32_t i = 0; i < u32tmp; ++i) {
+			auto& reach = grammar->section_reach[SI32(readBE<uint32_t>(input))];
+			reach.behind = readBE<uint32_t>(input);
+			reach.ahead = readBE<uint32_t>(input);
+		}
+	}
+
 	ucnv_close(conv);
 	return 0;
 }
 
-ContextualTest* BinaryGrammar::readContextualTest(std::istream& input) {
+void BinaryGrammar::filterRule(Rule* r) {
+	UErrorCode status;
+	if (nrules) {
+		status = U_ZERO_ERROR;
+		uregex_setText(nrules, r->name.c_str(), SI32(r->name.size()), &status);
+		status = U_ZERO_ERROR;
+		if (!uregex_find(nrules, -1, &status)) {
+			r->type = K_IGNORE;
+		}
+	}
+	if (nrules_inv) {
+		status = U_ZERO_ERROR;
+		uregex_setText(nrules_inv, r->name.c_str(), SI32(r->name.size()), &status);
+		status = U_ZERO_ERROR;
+		if (uregex_find(nrules_inv, -1, &status)) {
+			r->type = K_IGNORE;
+		}
+	}
+}
+
+int BinaryGrammar::readMappedGrammar(const char* buf, size_t length, uint32_t bin_revision) {
+	uint32_t bom = 0;
+	uint32_t num_sections = 0;
+	if (length >= 16) {
+		memcpy(&bom, buf + 8, sizeof(bom));
+		memcpy(&num_sections, buf + 12, sizeof(num_sections));
+	}
+	bool swap = (bom != BIN_BYTE_ORDER);
+	if (swap) {
+		be::endian_reverse_inplace(num_sections);
+	}
+	if ((swap && be::endian_reverse(bom) != BIN_BYTE_ORDER) || num_sections > (length - 16) / sizeof(mapped_section)) {
+		u_fprintf(ux_stderr, "Error: Grammar has no valid table of sections - cannot load as binary!\n");
+		CG3Quit(1);
+	}
+
+	// The sections are used in place for as long as the grammar lives, so unless they are in a file mapped for the
+	// grammar they go in a copy of its own, which is also where a file of the other byte order is swapped
+	std::shared_ptr<const char> keep;
+	keep.swap(image);
+	char* own = nullptr;
+	if (swap || keep.get() != buf) {
+		auto words = new uint64_t[(length + 7) / 8];
+		own = reinterpret_cast<char*>(words);
+		memcpy(own, buf, length);
+		keep.reset(own, [](const char* p) { delete[] reinterpret_cast<const uint64_t*>(p); });
+	}
+	const char* base = keep.get();
+
+	constexpr size_t widths[] = { 0, 1, sizeof(UChar), sizeof(uint32_t), sizeof(mapped_tag), sizeof(mapped_set), sizeof(flat_trie_node_t), sizeof(mapped_rule) };
+	const char* sections[BINS_RULES + 1] = {};
+	uint32_t counts[BINS_RULES + 1] = {};
+	for (uint32_t i = 0; i < num_sections; ++i) {
+		auto sec = reinterpret_cast<const mapped_section*>(base + 16) + i;
+		if (swap) {
+			auto w = reinterpret_cast<mapped_section*>(own + 16) + i;
+			be::endian_reverse_inplace(w->id);
+			be::endian_reverse_inplace(w->offset);
+			be::endian_reverse_inplace(w->count);
+		}
+		if (sec->id == 0 || sec->id > BINS_RULES) {
+			continue;
+		}
+		auto width = widths[sec->id];
+		if (sec->offset % 8 || sec->offset > length || sec->count > (length - sec->offset) / width) {
+			u_fprintf(ux_stderr, "Error: Grammar section %u lies outside the file - cannot load as binary!\n", sec->id);
+			CG3Quit(1);
+		}
+		sections[sec->id] = base + sec->offset;
+		counts[sec->id] = sec->count;
+		if (swap && width == sizeof(UChar)) {
+			auto p = reinterpret_cast<uint16_t*>(own + sec->offset);
+			for (size_t j = 0; j < sec->count; ++j) {
+				be::endian_reverse_inplace(p[j]);
+			}
+		}
+		else if (swap && width % sizeof(uint32_t) == 0) {
+			auto p = reinterpret_cast<uint32_t*>(own + sec->offset);
+			for (size_t j = 0; j < sec->count * width / sizeof(uint32_t); ++j) {
+				be::endian_reverse_inplace(p[j]);
+			}
+		}
+	}
+	if (!sections[BINS_STREAM]) {
+		u_fprintf(ux_stderr, "Error: Grammar has no stream section - cannot load as binary!\n");
+		CG3Quit(1);
+	}
+
+	auto strings = reinterpret_cast<const UChar*>(sections[BINS_STRINGS]);
+	auto u32s = reinterpret_cast<const uint32_t*>(sections[BINS_U32]);
+	auto tags = reinterpret_cast<const mapped_tag*>(sections[BINS_TAGS]);
+	auto sets = reinterpret_cast<const mapped_set*>(sections[BINS_SETS]);
+	auto tries = reinterpret_cast<const flat_trie_node_t*>(sections[BINS_TRIES]);
+	auto rules = reinterpret_cast<const mapped_rule*>(sections[BINS_RULES]);
+
+	// The records are trusted no more than the table of sections, so every range and index is checked before use
+	auto check = [&](bool ok, const char* what, uint32_t i) {
+		if (!ok) {
+			u_fprintf(ux_stderr, "Error: Grammar %s %u refers outside its sections - cannot load as binary!\n", what, i);
+			CG3Quit(1);
+		}
+	};
+	auto in_range = [](uint64_t first, uint64_t size, uint64_t count) {
+		return first + size <= count;
+	};
+	auto context = [&](uint32_t hash, uint32_t i) {
+		auto it = grammar->contexts.find(hash);
+		check(it != grammar->contexts.end(), "rule", i);
+		return it->second;
+	};
+
+	grammar->num_tags = counts[BINS_TAGS];
+	grammar->single_tags_list.resize(counts[BINS_TAGS]);
+	for (uint32_t i = 0; i < counts[BINS_TAGS]; ++i) {
+		const mapped_tag& m = tags[i];
+		// The two highest hashes mark free slots in the tag tables
+		check(m.hash < MAPPED_NONE - 1 && in_range(m.tag[0], m.tag[1], counts[BINS_STRINGS]), "tag", i);
+		check(!(m.flags & MT_REGEXP) || in_range(m.regexp[0], m.regexp[1], counts[BINS_STRINGS]), "tag", i);
+		check(!(m.flags & MT_VS_SETS) || in_range(m.vs_sets[0], m.vs_sets[1], counts[BINS_U32]), "tag", i);
+		check(!(m.flags & MT_VS_NAMES) || in_range(m.vs_names[0], UI64(m.vs_names[1]) * 2, counts[BINS_U32]), "tag", i);
+		Tag* t = grammar->allocateTag();
+		t->number = i;
+		t->hash = m.hash;
+		t->plain_hash = m.plain_hash;
+		t->seed = m.seed;
+		t->type = m.type;
+		t->comparison_hash = m.comparison_hash;
+		t->comparison_op = static_cast<C_OPS>(m.comparison_op);
+		auto bits = m.comparison_val[0] | (UI64(m.comparison_val[1]) << 32);
+		memcpy(&t->comparison_val, &bits, sizeof(bits));
+		if (t->type & (T_VARIABLE | T_LOCAL_VARIABLE)) {
+			t->variable_hash = m.variable_hash;
+		}
+		if (t->type & T_CONTEXT) {
+			t->context_ref_pos = m.context_ref_pos;
+		}
+		t->tag.assign(strings + m.tag[0], m.tag[1]);
+		if (m.flags & MT_REGEXP) {
+			// Compiled on first use, as most regex tags are never tried against most input
+			t->regexp_src.reset(new UString(strings + m.regexp[0], m.regexp[1]));
+		}
+		if (m.flags & MT_VS_SETS) {
+			t->allocateVsSets();
+			t->vs_sets->reserve(m.vs_sets[1]);
+			tag_varsets[i].assign(u32s + m.vs_sets[0], u32s + m.vs_sets[0] + m.vs_sets[1]);
+		}
+		if (m.flags & MT_VS_NAMES) {
+			t->allocateVsNames();
+			t->vs_names->reserve(m.vs_names[1]);
+			for (uint32_t j = 0; j < m.vs_names[1]; ++j) {
+				auto name = u32s + m.vs_names[0] + j * 2;
+				check(in_range(name[0], name[1], counts[BINS_STRINGS]), "tag", i);
+				if (name[1]) {
+					t->vs_names->emplace_back(strings + name[0], name[1]);
+				}
+			}
+		}
+
+		grammar->single_tags[t->hash] = t;
+		grammar->single_tags_list[i] = t;
+		if (t->tag.size() == 1 && t->tag[0] == '*') {
+			grammar->tag_any = t->hash;
+		}
+	}
+
+	buffer_reader input(sections[BINS_STREAM], counts[BINS_STREAM]);
+	if (int rv = readBinaryGrammar(input, bin_revision)) {
+		return rv;
+	}
+
+	if (counts[BINS_SETS] != grammar->sets_list.size()) {
+		u_fprintf(ux_stderr, "Error: Grammar has %u sets in its stream but %u in its set section - cannot load as binary!\n", UI32(grammar->sets_list.size()), counts[BINS_SETS]);
+		CG3Quit(1);
+	}
+	for (uint32_t i = 0; i < counts[BINS_SETS]; ++i) {
+		const mapped_set& m = sets[i];
+		check(in_range(m.trie[0], m.trie[1], counts[BINS_TRIES]) && in_range(m.keys[0], m.keys[1], counts[BINS_U32]), "set", i);
+		// Children lie past their parent, as trie_flatten() lays them out, so a walk can neither leave the set nor loop
+		for (uint32_t j = 0; j < m.trie[1]; ++j) {
+			auto& n = tries[m.trie[0] + j];
+			check(!n.count || (n.first > j && in_range(n.first, n.count, m.trie[1])), "set", i);
+			check(n.hash < MAPPED_NONE - 1 && grammar->single_tags.count(n.hash) != 0, "set", i);
+		}
+		Set* s = grammar->sets_list[i];
+		s->trie_flat.borrow(tries + m.trie[0], m.trie[1]);
+		s->trie_keys.borrow(u32s + m.keys[0], m.keys[1]);
+	}
+
+	grammar->rule_by_number.resize(counts[BINS_RULES]);
+	for (uint32_t i = 0; i < counts[BINS_RULES]; ++i) {
+		const mapped_rule& m = rules[i];
+		check(m.number < counts[BINS_RULES] && in_range(m.name[0], m.name[1], counts[BINS_STRINGS]), "rule", i);
+		check(m.target < counts[BINS_SETS] && m.childset1 < counts[BINS_SETS] && m.childset2 < counts[BINS_SETS], "rule", i);
+		check(m.wordform == MAPPED_NONE || m.wordform < counts[BINS_TAGS], "rule", i);
+		check(m.maplist == MAPPED_NONE || m.maplist < counts[BINS_SETS], "rule", i);
+		check(m.sublist == MAPPED_NONE || m.sublist < counts[BINS_SETS], "rule", i);
+		check(in_range(m.dep_tests[0], m.dep_tests[1], counts[BINS_U32]) && in_range(m.tests[0], m.tests[1], counts[BINS_U32]), "rule", i);
+		check(in_range(m.sub_rules[0], m.sub_rules[1], counts[BINS_U32]), "rule", i);
+		Rule* r = grammar->allocateRule();
+		r->section = SI32(m.section);
+		r->type = static_cast<KEYWORDS>(m.type);
+		r->line = m.line;
+		r->number = m.number;
+		r->flags = m.flags[0] | (UI64(m.flags[1]) << 32);
+		r->name.assign(strings + m.name[0], m.name[1]);
+		r->target = m.target;
+		if (m.wordform != MAPPED_NONE) {
+			r->wordform = grammar->single_tags_list[m.wordform];
+		}
+		r->varname = m.varname;
+		r->varvalue = m.varvalue;
+		r->sub_reading = SI32(m.sub_reading);
+		r->childset1 = m.childset1;
+		r->childset2 = m.childset2;
+		if (m.maplist != MAPPED_NONE) {
+			r->maplist = grammar->sets_list[m.maplist];
+		}
+		if (m.sublist != MAPPED_NONE) {
+			r->sublist = grammar->sets_list[m.sublist];
+		}
+		if (m.dep_target) {
+			r->dep_target = context(m.dep_target, i);
+		}
+		for (uint32_t j = 0; j < m.dep_tests[1]; ++j) {
+			r->addContextualTest(context(u32s[m.dep_tests[0] + j], i), r->dep_tests);
+		}
+		for (uint32_t j = 0; j < m.tests[1]; ++j) {
+			r->addContextualTest(context(u32s[m.tests[0] + j], i), r->tests);
+		}
+		r->sub_rules.reserve(m.sub_rules[1]);
+		for (uint32_t j = 0; j < m.sub_rules[1]; ++j) {
+			auto sr = u32s[m.sub_rules[0] + j];
+			check(sr < counts[BINS_RULES], "rule", i);
+			r->sub_rules.push_back(grammar->rule_by_number[sr]);
+		}
+
+		filterRule(r);
+		grammar->rule_by_number[r->number] = r;
+	}
+
+	grammar->binary_image = keep;
+	return 0;
+}
+
+ContextualTest* BinaryGrammar::readContextualTest(buffer_reader& input) {
 	ContextualTest* t = grammar->allocateContextualTest();
 	uint32_t u32tmp = 0;
 
@@ -35,11 +35,12 @@ int BinaryGrammar::writeBinaryGrammar(std::ostream& output) {
 		CG3Quit(1);
 	}
 	uint32_t fields = 0;
-	uint32_t u32tmp = 0;
 	int32_t i32tmp = 0;
 	UErrorCode err = U_ZERO_ERROR;
 	UConverter* conv = ucnv_open("UTF-8", &err);
 	std::ostringstream buffer;
+	// Everything that isn't in a section of its own, in the big-endian encoding of older revisions
+	std::ostringstream stream;
 
 	output.write("CG3B", 4);
 
@@ -55,9 +56,7 @@ int BinaryGrammar::writeBinaryGrammar(std::ostream& output) {
 	if (grammar->sub_readings_ltr) {
 		fields |= BINF_SUB_LTR;
 	}
-	if (!grammar->single_tags_list.empty()) {
-		fields |= BINF_TAGS;
-	}
+	// BINF_TAGS and BINF_RULES stay unset, as tags and rules have sections of their own
 	if (!grammar->reopen_mappings.empty()) {
 		fields |= BINF_REOPEN_MAP;
 	}
@@ -82,9 +81,6 @@ int BinaryGrammar::writeBinaryGrammar(std::ostream& output) {
 	if (!grammar->contexts.empty()) {
 		fields |= BINF_CONTEXTS;
 	}
-	if (!grammar->rule_by_number.empty()) {
-		fields |= BINF_RULES;
-	}
 	if (grammar->has_relations) {
 		fields |= BINF_RELATIONS;
 	}
@@ -100,154 +96,63 @@ int BinaryGrammar::writeBinaryGrammar(std::ostream& output) {
 	if (grammar->addcohort_attach) {
 		fields |= BINF_ADDCOHORT_ATTACH;
 	}
+	if (!grammar->section_reach.empty()) {
+		fields |= BINF_REACH;
+	}
 
-	writeBE(output, fields);
+	writeBE(stream, fields);
 
 	if (grammar->mapping_prefix) {
 		ucnv_reset(conv);
 		i32tmp = ucnv_fromUChars(conv, &cbuffers[0][0], CG3_BUFFER_SIZE - 1, &grammar->mapping_prefix, 1, &err);
-		writeBE(output, UI32(i32tmp));
-		output.write(&cbuffers[0][0], i32tmp);
+		writeBE(stream, UI32(i32tmp));
+		stream.write(&cbuffers[0][0], i32tmp);
 	}
 
 	i32tmp = SI32(grammar->cmdargs.size());
-	writeBE(output, UI32(i32tmp));
+	writeBE(stream, UI32(i32tmp));
 	if (i32tmp) {
-		output.write(&grammar->cmdargs[0], i32tmp);
+		stream.write(&grammar->cmdargs[0], i32tmp);
 	}
 
 	i32tmp = SI32(grammar->cmdargs_override.size());
-	writeBE(output, UI32(i32tmp));
+	writeBE(stream, UI32(i32tmp));
 	if (i32tmp) {
-		output.write(&grammar->cmdargs_override[0], i32tmp);
-	}
-
-	if (grammar->num_tags) {
-		writeBE(output, UI32(grammar->num_tags));
-	}
-	for (size_t i = 0; i < grammar->num_tags; ++i) {
-		auto t = grammar->single_tags_list[i];
-		uint32_t fields = 0;
-		buffer.str("");
-		buffer.clear();
-
-		if (t->number) {
-			fields |= (1 << 0);
-			writeBE(buffer, t->number);
-		}
-		if (t->hash) {
-			fields |= (1 << 1);
-			writeBE(buffer, t->hash);
-		}
-		if (t->plain_hash) {
-			fields |= (1 << 2);
-			writeBE(buffer, t->plain_hash);
-		}
-		if (t->seed) {
-			fields |= (1 << 3);
-			writeBE(buffer, t->seed);
-		}
-		if (t->type) {
-			fields |= (1 << 4);
-			writeBE(buffer, t->type);
-		}
-
-		if (t->comparison_hash) {
-			fields |= (1 << 5);
-			writeBE(buffer, t->comparison_hash);
-		}
-		if (t->comparison_op) {
-			fields |= (1 << 6);
-			writeBE<uint32_t>(buffer, t->comparison_op);
-		}
-		// ToDo: Field 1 << 7 cannot be reused until hard format break
-		if (t->comparison_val) {
-			fields |= (1 << 12);
-			writeBE(buffer, t->comparison_val);
-		}
-
-		if (!t->tag.empty()) {
-			fields |= (1 << 8);
-			ucnv_reset(conv);
-			i32tmp = ucnv_fromUChars(conv, &cbuffers[0][0], CG3_BUFFER_SIZE - 1, t->tag.data(), SI32(t->tag.size()), &err);
-			writeBE(buffer, i32tmp);
-			buffer.write(&cbuffers[0][0], i32tmp);
-		}
-
-		if (t->regexp) {
-			fields |= (1 << 9);
-			int32_t len = 0;
-			const UChar* p = uregex_pattern(t->regexp, &len, &err);
-			ucnv_reset(conv);
-			i32tmp = ucnv_fromUChars(conv, &cbuffers[0][0], CG3_BUFFER_SIZE - 1, p, len, &err);
-			writeBE(buffer, i32tmp);
-			buffer.write(&cbuffers[0][0], i32tmp);
-		}
-
-		if (t->vs_sets) {
-			fields |= (1 << 10);
-			writeBE<uint32_t>(buffer, UI32(t->vs_sets->size()));
-			for (auto iter : *t->vs_sets) {
-				writeBE(buffer, iter->number);
-			}
-		}
-		if (t->vs_names) {
-			fields |= (1 << 11);
-			writeBE<uint32_t>(buffer, UI32(t->vs_names->size()));
-			for (const auto& iter : *t->vs_names) {
-				ucnv_reset(conv);
-				i32tmp = ucnv_fromUChars(conv, &cbuffers[0][0], CG3_BUFFER_SIZE - 1, iter.data(), SI32(iter.size()), &err);
-				writeBE(buffer, i32tmp);
-				buffer.write(&cbuffers[0][0], i32tmp);
-			}
-		}
-		// 1 << 12 used above
-		if ((t->type & (T_VARIABLE|T_LOCAL_VARIABLE)) && t->variable_hash) {
-			fields |= (1 << 13);
-			writeBE(buffer, t->variable_hash);
-		}
-		if (t->type & T_CONTEXT) {
-			fields |= (1 << 14);
-			writeBE(buffer, t->context_ref_pos);
-		}
-
-		writeBE(output, fields);
-		const auto& str = buffer.str();
-		output.write(str.data(), str.size());
+		stream.write(&grammar->cmdargs_override[0], i32tmp);
 	}
 
 	if (!grammar->reopen_mappings.empty()) {
-		writeBE(output, UI32(grammar->reopen_mappings.size()));
+		writeBE(stream, UI32(grammar->reopen_mappings.size()));
 	}
 	for (auto iter : grammar->reopen_mappings) {
-		writeBE(output, iter);
+		writeBE(stream, iter);
 	}
 
 	if (!grammar->preferred_targets.empty()) {
-		writeBE(output, UI32(grammar->preferred_targets.size()));
+		writeBE(stream, UI32(grammar->preferred_targets.size()));
 	}
 	for (auto iter : grammar->preferred_targets) {
-		writeBE(output, iter);
+		writeBE(stream, iter);
 	}
 
 	if (!grammar->parentheses.empty()) {
-		writeBE(output, UI32(grammar->parentheses.size()));
+		writeBE(stream, UI32(grammar->parentheses.size()));
 	}
 	for (const auto& iter_par : grammar->parentheses) {
-		writeBE(output, iter_par.first);
-		writeBE(output, iter_par.second);
+		writeBE(stream, iter_par.first);
+		writeBE(stream, iter_par.second);
 	}
 
 	if (!grammar->anchors.empty()) {
-		writeBE(output, UI32(grammar->anchors.size()));
+		writeBE(stream, UI32(grammar->anchors.size()));
 	}
 	for (const auto& iter_anchor : grammar->anchors) {
-		writeBE(output, iter_anchor.first);
-		writeBE(output, iter_anchor.second);
+		writeBE(stream, iter_anchor.first);
+		writeBE(stream, iter_anchor.second);
 	}
 
 	if (!grammar->sets_list.empty()) {
-		writeBE(output, UI32(grammar->sets_list.size()));
+		writeBE(stream, UI32(grammar->sets_list.size()));
 	}
 	for (auto s : grammar->sets_list) {
 		uint32_t fields = 0;
@@ -266,10 +171,10 @@ int BinaryGrammar::writeBinaryGrammar(std::ostream& output) {
 			fields |= (1 << 2);
 			writeBE(buffer, UI8(s->type));
 		}
-		if (!s->getNonEmpty().empty()) {
+		// The plain trie goes in BINS_TRIES as it is flattened, so only the special one is serialized here
+		if (!s->trie_flat.empty() || !s->trie_special.empty()) {
 			fields |= (1 << 3);
-			writeBE<uint32_t>(buffer, UI32(s->trie.size()));
-			trie_serialize(s->trie, buffer);
+			writeBE<uint32_t>(buffer, 0);
 			writeBE<uint32_t>(buffer, UI32(s->trie_special.size()));
 			trie_serialize(s->trie_special, buffer);
 		}
@@ -295,146 +200,188 @@ int BinaryGrammar::writeBinaryGrammar(std::ostream& output) {
 			buffer.write(&cbuffers[0][0], i32tmp);
 		}
 
-		writeBE(output, fields);
+		writeBE(stream, fields);
 		const auto& str = buffer.str();
-		output.write(str.data(), str.size());
+		stream.write(str.data(), str.size());
 	}
 
 	if (grammar->delimiters) {
-		writeBE(output, grammar->delimiters->number);
+		writeBE(stream, grammar->delimiters->number);
 	}
 
 	if (grammar->soft_delimiters) {
-		writeBE(output, grammar->soft_delimiters->number);
+		writeBE(stream, grammar->soft_delimiters->number);
 	}
 
 	if (grammar->text_delimiters) {
-		writeBE(output, grammar->text_delimiters->number);
+		writeBE(stream, grammar->text_delimiters->number);
 	}
 
 	seen_uint32.clear();
 	if (!grammar->contexts.empty()) {
-		writeBE(output, UI32(grammar->contexts.size()));
+		writeBE(stream, UI32(grammar->contexts.size()));
 	}
 	for (auto& cntx : grammar->contexts) {
-		writeContextualTest(cntx.second, output);
+		writeContextualTest(cntx.second, stream);
 	}
 
-	if (!grammar->rule_by_number.empty()) {
-		writeBE(output, UI32(grammar->rule_by_number.size()));
+	// Last, so that older readers never get to it
+	if (fields & BINF_REACH) {
+		writeBE(stream, UI32(grammar->section_reach.size()));
+		for (auto& it : grammar->section_reach) {
+			writeBE(stream, UI32(it.first));
+			writeBE(stream, it.second.behind);
+			writeBE(stream, it.second.ahead);
+		}
 	}
-	for (auto r : grammar->rule_by_number) {
-		uint32_t fields = 0;
-		buffer.str("");
-		buffer.clear();
+	ucnv_close(conv);
 
-		if (r->section) {
-			fields |= (1 << 0);
-			writeBE(buffer, r->section);
+	std::vector<UChar> strings;
+	uint32Vector u32s;
+	auto add_string = [&](const UChar* str, size_t n, uint32_t* range) {
+		range[0] = UI32(strings.size());
+		range[1] = UI32(n);
+		strings.insert(strings.end(), str, str + n);
+	};
+
+	std::vector<mapped_tag> tags(grammar->num_tags);
+	for (size_t i = 0; i < grammar->num_tags; ++i) {
+		auto t = grammar->single_tags_list[i];
+		auto& m = tags[i];
+		m.hash = t->hash;
+		m.plain_hash = t->plain_hash;
+		m.seed = t->seed;
+		m.type = t->type;
+		m.comparison_hash = t->comparison_hash;
+		m.comparison_op = t->comparison_op;
+		uint64_t bits = 0;
+		memcpy(&bits, &t->comparison_val, sizeof(bits));
+		m.comparison_val[0] = UI32(bits);
+		m.comparison_val[1] = UI32(bits >> 32);
+		if (t->type & (T_VARIABLE | T_LOCAL_VARIABLE)) {
+			m.variable_hash = t->variable_hash;
 		}
-		if (r->type) {
-			fields |= (1 << 1);
-			writeBE(buffer, UI32(r->type));
+		if (t->type & T_CONTEXT) {
+			m.context_ref_pos = t->context_ref_pos;
 		}
-		if (r->line) {
-			fields |= (1 << 2);
-			writeBE(buffer, r->line);
+		add_string(t->tag.data(), t->tag.size(), m.tag);
+		if (t->hasRegexp()) {
+			m.flags |= MT_REGEXP;
+			auto p = t->regexpPattern();
+			add_string(p.data(), p.size(), m.regexp);
 		}
-		if (r->flags) {
-			fields |= (1 << 3);
-			if (r->flags > std::numeric_limits<uint32_t>::max()) {
-				fields |= (1 << 16);
-				writeBE(buffer, r->flags);
-			}
-			else {
-				writeBE(buffer, UI32(r->flags));
+		if (t->vs_sets) {
+			m.flags |= MT_VS_SETS;
+			m.vs_sets[0] = UI32(u32s.size());
+			m.vs_sets[1] = UI32(t->vs_sets->size());
+			for (auto iter : *t->vs_sets) {
+				u32s.push_back(iter->number);
 			}
 		}
-		if (!r->name.empty()) {
-			fields |= (1 << 4);
-			ucnv_reset(conv);
-			i32tmp = ucnv_fromUChars(conv, &cbuffers[0][0], CG3_BUFFER_SIZE - 1, r->name.data(), SI32(r->name.size()), &err);
-			writeBE(buffer, i32tmp);
-			buffer.write(&cbuffers[0][0], i32tmp);
-		}
-		if (r->target) {
-			fields |= (1 << 5);
-			writeBE(buffer, r->target);
-		}
-		if (r->wordform) {
-			fields |= (1 << 6);
-			writeBE(buffer, r->wordform->number);
-		}
-		if (r->varname) {
-			fields |= (1 << 7);
-			writeBE(buffer, r->varname);
-		}
-		if (r->varvalue) {
-			fields |= (1 << 8);
-			writeBE(buffer, r->varvalue);
-		}
-		if (r->sub_reading) {
-			fields |= (1 << 9);
-			uint32_t v = std::abs(r->sub_reading);
-			if (r->sub_reading < 0) {
-				v |= (1 << 31);
+		if (t->vs_names) {
+			m.flags |= MT_VS_NAMES;
+			uint32Vector names;
+			for (const auto& iter : *t->vs_names) {
+				uint32_t range[2];
+				add_string(iter.data(), iter.size(), range);
+				names.insert(names.end(), range, range + 2);
 			}
-			writeBE(buffer, v);
-		}
-		if (r->childset1) {
-			fields |= (1 << 10);
-			writeBE(buffer, r->childset1);
-		}
-		if (r->childset2) {
-			fields |= (1 << 11);
-			writeBE(buffer, r->childset2);
-		}
-		if (r->maplist) {
-			fields |= (1 << 12);
-			writeBE(buffer, r->maplist->number);
-		}
-		if (r->sublist) {
-			fields |= (1 << 13);
-			writeBE(buffer, r->sublist->number);
-		}
-		if (r->number) {
-			fields |= (1 << 14);
-			writeBE(buffer, r->number);
-		}
-		if (!r->sub_rules.empty()) {
-			fields |= (1 << 15);
+			m.vs_names[0] = UI32(u32s.size());
+			m.vs_names[1] = UI32(t->vs_names->size());
+			u32s.insert(u32s.end(), names.begin(), names.end());
 		}
+	}
 
-		writeBE(output, fields);
-		const auto& str = buffer.str();
-		output.write(str.data(), str.size());
+	std::vector<mapped_set> sets(grammar->sets_list.size());
+	std::vector<flat_trie_node_t> tries;
+	for (auto s : grammar->sets_list) {
+		auto& m = sets[s->number];
+		m.trie[0] = UI32(tries.size());
+		m.trie[1] = UI32(s->trie_flat.size());
+		tries.insert(tries.end(), s->trie_flat.begin(), s->trie_flat.end());
+		m.keys[0] = UI32(u32s.size());
+		m.keys[1] = UI32(s->trie_keys.size());
+		u32s.insert(u32s.end(), s->trie_keys.begin(), s->trie_keys.end());
+	}
 
-		u32tmp = 0;
-		if (r->dep_target) {
-			u32tmp = r->dep_target->hash;
-		}
-		writeBE(output, u32tmp);
+	std::vector<mapped_rule> rules(grammar->rule_by_number.size());
+	for (auto r : grammar->rule_by_number) {
+		auto& m = rules[r->number];
+		m.section = UI32(r->section);
+		m.type = UI32(r->type);
+		m.line = r->line;
+		m.number = r->number;
+		m.flags[0] = UI32(r->flags);
+		m.flags[1] = UI32(r->flags >> 32);
+		add_string(r->name.data(), r->name.size(), m.name);
+		m.target = r->target;
+		m.wordform = r->wordform ? r->wordform->number : MAPPED_NONE;
+		m.varname = r->varname;
+		m.varvalue = r->varvalue;
+		m.sub_reading = UI32(r->sub_reading);
+		m.childset1 = r->childset1;
+		m.childset2 = r->childset2;
+		m.maplist = r->maplist ? r->maplist->number : MAPPED_NONE;
+		m.sublist = r->sublist ? r->sublist->number : MAPPED_NONE;
+		m.dep_target = r->dep_target ? r->dep_target->hash : 0;
 
 		r->reverseContextualTests();
-		writeBE(output, UI32(r->dep_tests.size()));
+		m.dep_tests[0] = UI32(u32s.size());
+		m.dep_tests[1] = UI32(r->dep_tests.size());
 		for (auto it : r->dep_tests) {
-			writeBE(output, it->hash);
+			u32s.push_back(it->hash);
 		}
-
-		writeBE(output, UI32(r->tests.size()));
+		m.tests[0] = UI32(u32s.size());
+		m.tests[1] = UI32(r->tests.size());
 		for (auto it : r->tests) {
-			writeBE(output, it->hash);
-		}
-
-		if (!r->sub_rules.empty()) {
-			writeBE(output, UI32(r->sub_rules.size()));
-			for (auto it : r->sub_rules) {
-				writeBE(output, it->number);
-			}
-		}
+			u32s.push_back(it->hash);
+		}
+		m.sub_rules[0] = UI32(u32s.size());
+		m.sub_rules[1] = UI32(r->sub_rules.size());
+		for (auto it : r->sub_rules) {
+			u32s.push_back(it->number);
+		}
+	}
+
+	const auto& str = stream.str();
+	struct {
+		uint32_t id;
+		const void* data;
+		size_t count;
+		size_t width;
+	} sections[] = {
+		{ BINS_STREAM, str.data(), str.size(), 1 },
+		{ BINS_STRINGS, strings.data(), strings.size(), sizeof(UChar) },
+		{ BINS_U32, u32s.data(), u32s.size(), sizeof(uint32_t) },
+		{ BINS_TAGS, tags.data(), tags.size(), sizeof(mapped_tag) },
+		{ BINS_SETS, sets.data(), sets.size(), sizeof(mapped_set) },
+		{ BINS_TRIES, tries.data(), tries.size(), sizeof(flat_trie_node_t) },
+		{ BINS_RULES, rules.data(), rules.size(), sizeof(mapped_rule) },
+	};
+	constexpr auto num_sections = UI32(sizeof(sections) / sizeof(sections[0]));
+
+	writeRaw(output, BIN_BYTE_ORDER);
+	writeRaw(output, num_sections);
+	size_t at = 16 + num_sections * sizeof(mapped_section);
+	for (auto& sec : sections) {
+		at = (at + 7) & ~size_t(7);
+		if (at + sec.count * sec.width > std::numeric_limits<uint32_t>::max()) {
+			u_fprintf(ux_stderr, "Error: Grammar is too large for the binary format!\n");
+			CG3Quit(1);
+		}
+		mapped_section ms{ sec.id, UI32(at), UI32(sec.count) };
+		writeRaw(output, ms);
+		at += sec.count * sec.width;
+	}
+	at = 16 + num_sections * sizeof(mapped_section);
+	for (auto& sec : sections) {
+		for (; at % 8; ++at) {
+			output.put(0);
+		}
+		output.write(static_cast<const char*>(sec.data), sec.count * sec.width);
+		at += sec.count * sec.width;
 	}
 
-	ucnv_close(conv);
 	return 0;
 }
 
@@ -162,72 +162,38 @@ void DepDescendentIter::reset(Cohort* cohort, const ContextualTest* test, bool s
 	m_cohort = nullptr;
 
 	if (cohort && test) {
-		for (auto dter : cohort->dep_children) {
-			if (cohort->parent->parent->cohort_map.find(dter) == cohort->parent->parent->cohort_map.end()) {
-				continue;
-			}
-			Cohort* current = cohort->parent->parent->cohort_map.find(dter)->second;
-			bool good = true;
-			if (current->parent != cohort->parent) {
-				if ((!(test->pos & (POS_SPAN_BOTH | POS_SPAN_LEFT))) && current->parent->number < cohort->parent->number) {
-					good = false;
-				}
-				else if ((!(test->pos & (POS_SPAN_BOTH | POS_SPAN_RIGHT))) && current->parent->number > cohort->parent->number) {
-					good = false;
-				}
-			}
-			if (good) {
-				m_descendents.insert(current);
-			}
-		}
-
-		CohortSet m_seen;
-		m_seen.insert(cohort);
-
-		bool added = false;
-		do {
-			added = false;
-			CohortSet to_add;
-
-			for (auto cohort_inner : m_descendents) {
-				if (m_seen.find(cohort_inner) != m_seen.end()) {
+		auto& cohort_map = cohort->parent->parent->cohort_map;
+		// Breadth first, expanding each cohort once; the origin is never expanded, even if a loop leads back to it
+		m_frontier.clear();
+		m_frontier.push_back(cohort);
+		for (size_t i = 0; i < m_frontier.size(); ++i) {
+			for (auto dter : m_frontier[i]->dep_children) {
+				auto it = cohort_map.find(dter);
+				if (it == cohort_map.end()) {
 					continue;
 				}
-				m_seen.insert(cohort_inner);
-
-				for (auto dter : cohort_inner->dep_children) {
-					if (cohort_inner->parent->parent->cohort_map.find(dter) == cohort_inner->parent->parent->cohort_map.end()) {
+				Cohort* current = it->second;
+				if (current->parent != cohort->parent) {
+					if ((!(test->pos & (POS_SPAN_BOTH | POS_SPAN_LEFT))) && current->parent->number < cohort->parent->number) {
 						continue;
 					}
-					Cohort* current = cohort_inner->parent->parent->cohort_map.find(dter)->second;
-					bool good = true;
-					if (current->parent != cohort->parent) {
-						if ((!(test->pos & (POS_SPAN_BOTH | POS_SPAN_LEFT))) && current->parent->number < cohort->parent->number) {
-							good = false;
-						}
-						else if ((!(test->pos & (POS_SPAN_BOTH | POS_SPAN_RIGHT))) && current->parent->number > cohort->parent->number) {
-							good = false;
-						}
-					}
-					if (good) {
-						to_add.insert(current);
-						added = true;
+					else if ((!(test->pos & (POS_SPAN_BOTH | POS_SPAN_RIGHT))) && current->parent->number > cohort->parent->number) {
+						continue;
 					}
 				}
+				if (m_descendents.insert(current).second && current != cohort) {
+					m_frontier.push_back(current);
+				}
 			}
-
-			for (auto iter : to_add) {
-				m_descendents.insert(iter);
-			}
-		} while (added);
+		}
 
 		if (test->pos & POS_LEFT) {
-			m_seen.assign(m_descendents.begin(), m_descendents.lower_bound(cohort));
-			m_descendents.swap(m_seen);
+			m_scratch.assign(m_descendents.begin(), m_descendents.lower_bound(cohort));
+			m_descendents.swap(m_scratch);
 		}
 		if (test->pos & POS_RIGHT) {
-			m_seen.assign(m_descendents.lower_bound(cohort), m_descendents.end());
-			m_descendents.swap(m_seen);
+			m_scratch.assign(m_descendents.lower_bound(cohort), m_descendents.end());
+			m_descendents.swap(m_scratch);
 		}
 		if (test->pos & POS_SELF) {
 			m_descendents.insert(cohort);
@@ -288,14 +254,12 @@ void DepAncestorIter::reset(Cohort* cohort, const ContextualTest* test, bool spa
 		}
 
 		if (test->pos & POS_LEFT) {
-			CohortSet tmp;
-			tmp.assign(m_ancestors.begin(), m_ancestors.lower_bound(cohort));
-			m_ancestors.swap(tmp);
+			m_scratch.assign(m_ancestors.begin(), m_ancestors.lower_bound(cohort));
+			m_ancestors.swap(m_scratch);
 		}
 		if (test->pos & POS_RIGHT) {
-			CohortSet tmp;
-			tmp.assign(m_ancestors.lower_bound(cohort), m_ancestors.end());
-			m_ancestors.swap(tmp);
+			m_scratch.assign(m_ancestors.lower_bound(cohort), m_ancestors.end());
+			m_ancestors.swap(m_scratch);
 		}
 		if (test->pos & POS_SELF) {
 			m_ancestors.insert(cohort);
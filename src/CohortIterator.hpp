@@ -92,6 +92,9 @@ public:
 protected:
 	CohortSet m_descendents;
 	CohortSet::const_iterator m_ai;
+	// Scratch space kept between resets, so that reusing the iterator doesn't allocate
+	CohortSet m_scratch;
+	CohortVector m_frontier;
 };
 
 class DepAncestorIter : public CohortIterator {
@@ -105,6 +108,7 @@ public:
 protected:
 	CohortSet m_ancestors;
 	CohortSet::const_iterator m_ai;
+	CohortSet m_scratch;
 };
 
 class CohortSetIter : public CohortIterator {
@@ -84,10 +84,11 @@ void FSTApplicator::runGrammarOnText(std::istream& input, std::ostream& output)
 	gWindow->window_span = num_windows;
 
 	ux_stripBOM(input);
+	UStreamReader reader(input);
 
 	while (!input.eof()) {
 		++lines;
-		auto packoff = get_line_clean(line, cleaned, input, true);
+		auto packoff = get_line_clean(line, cleaned, reader, true);
 
 		// Trim trailing whitespace
 		while (cleaned[0] && ISSPACE(cleaned[packoff - 1])) {
@@ -260,7 +261,7 @@ void FSTApplicator::runGrammarOnText(std::istream& input, std::ostream& output)
 					u_fprintf(ux_stderr, "Warning: Line %u had no valid baseform.\n", numLines);
 					u_fflush(ux_stderr);
 				}
-				if (grammar->single_tags[cReading->baseform]->tag.size() == 2) {
+				if (single_tags[cReading->baseform]->tag.size() == 2) {
 					delTagFromReading(*cReading, cReading->baseform);
 					cReading->baseform = makeBaseFromWord(cCohort->wordform->hash)->hash;
 				}
@@ -354,11 +355,11 @@ void FSTApplicator::runGrammarOnText(std::istream& input, std::ostream& output)
 				cSWindow->appendCohort(cCohort);
 				lCohort = cCohort;
 			}
-			if (gWindow->next.size() > num_windows) {
+			if (gWindow->next.size() > windows_ahead + 1) {
 				gWindow->shuffleWindowsDown();
 				runGrammarOnWindow();
 				if (numWindows % resetAfter == 0) {
-					resetIndexes();
+					reclaimTags();
 				}
 				if (verbosity_level > 0) {
 					u_fprintf(ux_stderr, "Progress: L:%u, W:%u, C:%u, R:%u\r", lines, numWindows, numCohorts, numReadings);
@@ -404,7 +405,7 @@ void FSTApplicator::runGrammarOnText(std::istream& input, std::ostream& output)
 	gWindow->shuffleWindowsDown();
 	while (!gWindow->previous.empty()) {
 		SingleWindow* tmp = gWindow->previous.front();
-		printSingleWindow(tmp, output);
+		outputSingleWindow(tmp, output);
 		free_swindow(tmp);
 		gWindow->previous.erase(gWindow->previous.begin());
 	}
@@ -425,8 +426,7 @@ void FSTApplicator::printReading(const Reading* reading, std::ostream& output) {
 	}
 
 	if (reading->baseform) {
-		auto& tag = grammar->single_tags.find(reading->baseform)->second->tag;
-		u_fprintf(output, "%.*S", tag.size() - 2, tag.data() + 1);
+		single_tags.find(reading->baseform)->second->printUTF8(output, 1, 1);
 	}
 
 	uint32SortedVector unique;
@@ -443,14 +443,15 @@ void FSTApplicator::printReading(const Reading* reading, std::ostream& output) {
 			}
 			unique.insert(tter);
 		}
-		const Tag* tag = grammar->single_tags[tter];
+		const Tag* tag = single_tags[tter];
 		if (tag->type & T_DEPENDENCY && has_dep && !dep_original) {
 			continue;
 		}
 		if (tag->type & T_RELATION && has_relations) {
 			continue;
 		}
-		u_fprintf(output, "+%S", tag->tag.data());
+		output.put('+');
+		tag->printUTF8(output);
 	}
 }
 
@@ -484,13 +485,15 @@ void FSTApplicator::printCohort(Cohort* cohort, std::ostream& output, bool profi
 	}
 
 	{
-		auto& wform = cohort->wordform->tag;
+		auto wform = cohort->wordform;
 		if (cohort->readings.empty() || (cohort->readings.size() == 1 && cohort->readings[0]->noprint)) {
-			u_fprintf(output, "%.*S\t+?\n", wform.size() - 4, wform.data() + 2);
+			wform->printUTF8(output, 2, 2);
+			output.write("\t+?\n", 4);
 		}
 		else {
 			for (auto rter : cohort->readings) {
-				u_fprintf(output, "%.*S\t", wform.size() - 4, wform.data() + 2);
+				wform->printUTF8(output, 2, 2);
+				output.put('\t');
 				printReading(rter, output);
 				u_fputc('\n', output);
 			}
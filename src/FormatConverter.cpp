@@ -133,7 +133,7 @@ void FormatConverter::runGrammarOnText(std::istream& input, std::ostream& output
 	ux_stdout = &output;
 
 	if (fmt_output == CG3SF_BINARY || fmt_input == CG3SF_BINARY) {
-		grammar->has_relations = true;
+		parse_relations = true;
 	}
 
 	switch (fmt_input) {
@@ -602,6 +602,31 @@ void Grammar::destroyTag(Tag* tag) {
 	delete tag;
 }
 
+/**
+ * Registers a regex or case-insensitive tag that can make other tags T_TEXTUAL, compiling its regex if needed.
+ *
+ * @return Whether the tag is such a pattern and wasn't registered before
+ */
+bool Grammar::addTextualPattern(Tag* tag) {
+	if (is_textual(tag->tag)) {
+		return false;
+	}
+	bool added = false;
+	if (tag->hasRegexp()) {
+		UErrorCode status = U_ZERO_ERROR;
+		tag->compileRegexp(status);
+		if (status != U_ZERO_ERROR) {
+			u_fprintf(ux_stderr, "Error: uregex_open returned %s trying to parse tag %S - cannot continue!\n", u_errorName(status), tag->tag.data());
+			CG3Quit(1);
+		}
+		added = regex_tags.emplace(tag->regexp, tag->regexpLiteral()).second;
+	}
+	if (tag->type & T_CASE_INSENSITIVE) {
+		added = icase_tags.insert(tag).second || added;
+	}
+	return added;
+}
+
 ContextualTest* Grammar::allocateContextualTest() {
 	return new ContextualTest;
 }
@@ -666,6 +691,20 @@ void Grammar::addAnchor(const UChar* to, uint32_t at, bool primary) {
 	}
 }
 
+inline uint32_t reach_add(uint32_t a, uint32_t b) {
+	return (a > WindowReach::ANY - b) ? WindowReach::ANY : a + b;
+}
+
+inline void reach_max(WindowReach& to, const WindowReach& from) {
+	to.behind = std::max(to.behind, from.behind);
+	to.ahead = std::max(to.ahead, from.ahead);
+}
+
+inline void reach_add(WindowReach& to, const WindowReach& from) {
+	to.behind = reach_add(to.behind, from.behind);
+	to.ahead = reach_add(to.ahead, from.ahead);
+}
+
 void Grammar::reindex(bool unused_sets, bool used_tags) {
 	for (const auto& dset : sets_by_contents) {
 		if (dset.second->number == std::numeric_limits<uint32_t>::max()) {
@@ -713,12 +752,11 @@ void Grammar::reindex(bool unused_sets, bool used_tags) {
 	sets_any = nullptr;
 	rules_any = nullptr;
 
+	TagVector new_patterns;
 	for (auto iter : single_tags_list) {
-		if (iter->regexp && !is_textual(iter->tag)) {
-			regex_tags.insert(iter->regexp);
-		}
-		if ((iter->type & T_CASE_INSENSITIVE) && !is_textual(iter->tag)) {
-			icase_tags.insert(iter);
+		iter->cacheUTF8();
+		if (addTextualPattern(iter)) {
+			new_patterns.push_back(iter);
 		}
 		if (is_binary) {
 			continue;
@@ -731,25 +769,43 @@ void Grammar::reindex(bool unused_sets, bool used_tags) {
 		}
 	}
 
-	for (auto titer : single_tags_list) {
-		if (titer->type & T_TEXTUAL) {
-			continue;
-		}
-		for (auto iter : regex_tags) {
-			UErrorCode status = U_ZERO_ERROR;
-			uregex_setText(iter, titer->tag.data(), SI32(titer->tag.size()), &status);
-			if (status == U_ZERO_ERROR) {
-				if (uregex_find(iter, -1, &status)) {
-					titer->type |= T_TEXTUAL;
+	// Tags are checked against the known patterns as they are created, so only patterns new since the last reindex need a pass over all tags
+	if (!new_patterns.empty()) {
+		for (auto titer : single_tags_list) {
+			if (titer->type & T_TEXTUAL) {
+				continue;
+			}
+			for (auto iter : new_patterns) {
+				if (iter->regexp && regex_tags.count(iter->regexp)) {
+					UErrorCode status = U_ZERO_ERROR;
+					uregex_setText(iter->regexp, titer->tag.data(), SI32(titer->tag.size()), &status);
+					if (status == U_ZERO_ERROR) {
+						if (uregex_find(iter->regexp, -1, &status)) {
+							titer->type |= T_TEXTUAL;
+						}
+					}
+				}
+				if (icase_tags.count(iter)) {
+					if (ux_strCaseCompare(titer->tag, iter->tag)) {
+						titer->type |= T_TEXTUAL;
+					}
 				}
 			}
 		}
-		for (auto iter : icase_tags) {
-			if (ux_strCaseCompare(titer->tag, iter->tag)) {
-				titer->type |= T_TEXTUAL;
-			}
+	}
+
+	regex_literals.clear();
+	regex_literal_of.assign(single_tags_list.size(), regex_literals.NONE);
+	for (auto iter : single_tags_list) {
+		if (!iter->hasRegexp() || (iter->type & T_REGEXP_LINE)) {
+			continue;
+		}
+		auto literal = iter->regexpLiteral();
+		if (!literal.empty()) {
+			regex_literal_of[iter->number] = regex_literals.add(literal);
 		}
 	}
+	regex_literals.build();
 
 	for (auto& it : parentheses) {
 		single_tags[it.first]->markUsed();
@@ -867,6 +923,18 @@ void Grammar::reindex(bool unused_sets, bool used_tags) {
 			setAdjustSets(set);
 		}
 	}
+	for (auto set : sets_list) {
+		// Tries borrowed from a mapped binary grammar are already flat, and have no trie_t to flatten
+		if (!set->trie.empty() || !set->trie_flat.borrowed()) {
+			trie_flatten(set->trie, set->trie_flat);
+			uint32Vector keys;
+			keys.reserve(set->trie.size());
+			for (size_t i = 0; i < set->trie.size(); ++i) {
+				keys.push_back(set->trie_flat[i].hash);
+			}
+			set->trie_keys.assign(std::move(keys));
+		}
+	}
 	for (auto set : sets_list) {
 		indexSets(set->number, set);
 	}
@@ -928,6 +996,24 @@ void Grammar::reindex(bool unused_sets, bool used_tags) {
 		}
 	}
 
+	for (auto rule : rule_by_number) {
+		rule->required_sets.clear();
+		// IFF acts on failed tests too
+		if (rule->type == K_IFF) {
+			continue;
+		}
+		for (auto test : rule->tests) {
+			contextRequiredSets(test, rule->required_sets);
+		}
+	}
+
+	// Binary grammars bring this along, since it takes walking every context
+	if (section_reach.empty()) {
+		for (auto rule : rule_by_number) {
+			reach_max(section_reach[rule->section], ruleReach(rule));
+		}
+	}
+
 	if (!sects.empty()) {
 		for (uint32_t i = 0; i <= sects.back(); ++i) {
 			sections.push_back(i);
@@ -935,7 +1021,9 @@ void Grammar::reindex(bool unused_sets, bool used_tags) {
 	}
 
 	if (sets_by_tag.find(tag_any) != sets_by_tag.end()) {
-		sets_any = &sets_by_tag[tag_any];
+		sets_any_bits.clear();
+		insert_ids(sets_any_bits, sets_by_tag[tag_any], sets_list.size());
+		sets_any = &sets_any_bits;
 	}
 	if (rules_by_tag.find(tag_any) != rules_by_tag.end()) {
 		rules_any = &rules_by_tag[tag_any];
@@ -1106,6 +1194,16 @@ void Grammar::reindex(bool unused_sets, bool used_tags) {
 	}
 }
 
+void Grammar::unflattenTries() {
+	for (auto set : sets_list) {
+		if (set->trie.empty() && !set->trie_flat.empty()) {
+			trie_unflatten(set->trie_flat, single_tags, set->trie);
+			set->trie_flat.clear();
+			set->trie_keys.clear();
+		}
+	}
+}
+
 inline void trie_indexToRule(const trie_t& trie, Grammar& grammar, uint32_t r) {
 	for (auto& kv : trie) {
 		grammar.indexTagToRule(kv.first->hash, r);
@@ -1120,7 +1218,9 @@ void Grammar::indexSetToRule(uint32_t r, Set* s) {
 		indexTagToRule(tag_any, r);
 	}
 
-	trie_indexToRule(s->trie, *this, r);
+	for (auto& node : s->trie_flat) {
+		indexTagToRule(node.hash, r);
+	}
 	trie_indexToRule(s->trie_special, *this, r);
 
 	for (auto i : s->sets) {
@@ -1148,7 +1248,9 @@ void Grammar::indexSets(uint32_t r, Set* s) {
 		return;
 	}
 
-	trie_indexToSet(s->trie, *this, r);
+	for (auto& node : s->trie_flat) {
+		indexTagToSet(node.hash, r);
+	}
 	trie_indexToSet(s->trie_special, *this, r);
 
 	for (auto i : s->sets) {
@@ -1158,10 +1260,7 @@ void Grammar::indexSets(uint32_t r, Set* s) {
 }
 
 void Grammar::indexTagToSet(uint32_t t, uint32_t r) {
-	if (sets_by_tag.find(t) == sets_by_tag.end()) {
-		sets_by_tag[t].resize(sets_list.size());
-	}
-	sets_by_tag[t].set(r);
+	sets_by_tag[t].insert(r);
 }
 
 void Grammar::setAdjustSets(Set* s) {
@@ -1177,6 +1276,85 @@ void Grammar::setAdjustSets(Set* s) {
 	}
 }
 
+// Collects the targets of a chain of positive tests that can only look at cohorts in the window they start from.
+// Anything that may cross windows, look at deleted or delayed readings, or be satisfied by a failed match ends the chain.
+void Grammar::contextRequiredSets(const ContextualTest* test, uint32SortedVector& sets) {
+	constexpr uint64_t unsure = POS_NEGATE | POS_NOT | POS_NONE | POS_ALL | POS_SPAN_LEFT | POS_SPAN_RIGHT | POS_SPAN_BOTH | MASK_POS_DEPREL | MASK_POS_LORR | POS_LEFT_PAR | POS_RIGHT_PAR | POS_JUMP | POS_WITH | POS_ATTACH_TO | POS_BAG_OF_TAGS | POS_LOOK_DELETED | POS_LOOK_DELAYED | POS_LOOK_IGNORED | POS_ACTIVE | POS_INACTIVE | POS_TMPL_OVERRIDE | POS_UNKNOWN | POS_NUMERIC_BRANCH;
+	for (; test; test = test->linked) {
+		if ((test->pos & unsure) || test->tmpl || !test->ors.empty()) {
+			break;
+		}
+		sets.insert(test->target);
+	}
+}
+
+// Each test of a chain starts where the previous one ended, so their reaches add up.
+// A plain position that may span stops in the next window over; scans, dependency, relations, enclosures, bags, and jumps go as far as there are windows.
+inline WindowReach context_reach(const ContextualTest* test, std::vector<const ContextualTest*>& path, bool& cyclic) {
+	constexpr uint64_t unbounded = MASK_POS_SCAN | MASK_POS_DEPREL | MASK_POS_LORR | POS_LEFT_PAR | POS_RIGHT_PAR | POS_BAG_OF_TAGS | POS_JUMP | POS_WITH | POS_ATTACH_TO;
+	WindowReach rv;
+	if (std::find(path.begin(), path.end(), test) != path.end()) {
+		cyclic = true;
+		return rv;
+	}
+	path.push_back(test);
+	for (auto t = test; t; t = t->linked) {
+		WindowReach step;
+		if (t->tmpl) {
+			step = context_reach(t->tmpl, path, cyclic);
+		}
+		for (auto o : t->ors) {
+			reach_max(step, context_reach(o, path, cyclic));
+		}
+		uint32_t dist = (t->pos & unbounded) ? WindowReach::ANY : 1;
+		if (t->pos & (POS_SPAN_LEFT | POS_SPAN_BOTH)) {
+			step.behind = std::max(step.behind, dist);
+		}
+		if (t->pos & (POS_SPAN_RIGHT | POS_SPAN_BOTH)) {
+			step.ahead = std::max(step.ahead, dist);
+		}
+		reach_add(rv, step);
+	}
+	path.pop_back();
+	return rv;
+}
+
+WindowReach Grammar::contextReach(const ContextualTest* test) const {
+	std::vector<const ContextualTest*> path;
+	bool cyclic = false;
+	auto rv = context_reach(test, path, cyclic);
+	// A template that uses itself can repeat whatever distance it covers
+	if (cyclic) {
+		rv.behind = rv.behind ? WindowReach::ANY : 0;
+		rv.ahead = rv.ahead ? WindowReach::ANY : 0;
+	}
+	return rv;
+}
+
+// Contexts may start from where other contexts of the rule ended, via jumps, dependency targets, and WITH, so all of them add up
+WindowReach Grammar::ruleReach(const Rule* rule) const {
+	WindowReach rv;
+	for (auto test : rule->tests) {
+		reach_add(rv, contextReach(test));
+	}
+	if (rule->dep_target) {
+		reach_add(rv, contextReach(rule->dep_target));
+	}
+	for (auto test : rule->dep_tests) {
+		reach_add(rv, contextReach(test));
+	}
+	WindowReach subs;
+	for (auto sub : rule->sub_rules) {
+		reach_max(subs, ruleReach(sub));
+	}
+	reach_add(rv, subs);
+	// Removing a window's last cohort hands its text to the window before it
+	if (rule->type == K_REMCOHORT) {
+		rv.behind = std::max(rv.behind, 1u);
+	}
+	return rv;
+}
+
 void Grammar::contextAdjustTarget(ContextualTest* test) {
 	if (!test->is_used) {
 		return;
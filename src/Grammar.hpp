@@ -28,10 +28,18 @@
 #include "sorted_vector.hpp"
 #include "interval_vector.hpp"
 #include "flat_unordered_set.hpp"
+#include "aho_corasick.hpp"
 
 namespace CG3 {
 class Anchor;
 
+// How many windows behind and ahead of the one being run some rules can look at or change
+struct WindowReach {
+	static constexpr uint32_t ANY = std::numeric_limits<uint32_t>::max();
+	uint32_t behind = 0;
+	uint32_t ahead = 0;
+};
+
 class Grammar {
 public:
 	std::ostream* ux_stderr = nullptr;
@@ -47,6 +55,8 @@ public:
 	bool ordered = false;
 	bool addcohort_attach = false;
 	size_t grammar_size = 0;
+	// The binary grammar that sets' flat tries are borrowed from, kept alive for as long as the grammar is
+	std::shared_ptr<const char> binary_image;
 	size_t num_tags = 0;
 	UChar mapping_prefix = '@';
 	uint32_t lines = 0;
@@ -71,10 +81,14 @@ public:
 	typedef std::vector<UString> static_sets_t;
 	static_sets_t static_sets;
 
-	typedef std::set<URegularExpression*> regex_tags_t;
+	typedef TextualRegexes regex_tags_t;
 	regex_tags_t regex_tags;
 	typedef TagSortedVector icase_tags_t;
 	icase_tags_t icase_tags;
+	// The literal text each regex tag needs in order to match, so that an input tag can be checked against all of them in one pass before ICU is asked
+	aho_corasick<UChar> regex_literals;
+	// By tag number, the tag's string in regex_literals, or aho_corasick::NONE
+	uint32Vector regex_literal_of;
 
 	typedef std::unordered_map<uint32_t, ContextualTest*> contexts_t;
 	contexts_t templates;
@@ -84,10 +98,13 @@ public:
 	rules_by_set_t rules_by_set;
 	typedef std::unordered_map<uint32_t, uint32IntervalVector> rules_by_tag_t;
 	rules_by_tag_t rules_by_tag;
-	typedef std::unordered_map<uint32_t, boost::dynamic_bitset<>> sets_by_tag_t;
+	// Most tags are in a handful of sets, so each tag lists the numbers of its sets rather than having a bit for every set
+	typedef std::unordered_map<uint32_t, uint32SortedVector> sets_by_tag_t;
 	sets_by_tag_t sets_by_tag;
 
 	uint32IntervalVector* rules_any = nullptr;
+	// The sets that any cohort might match, as bits since every cohort gets all of them
+	boost::dynamic_bitset<> sets_any_bits;
 	boost::dynamic_bitset<>* sets_any = nullptr;
 
 	Set* delimiters = nullptr;
@@ -101,6 +118,8 @@ public:
 	parentheses_t parentheses_reverse;
 
 	uint32Vector sections;
+	// By rule section, where -1 is BEFORE-SECTIONS, -2 is AFTER-SECTIONS, and -3 is NULL-SECTION
+	bc::flat_map<int32_t, WindowReach> section_reach;
 	uint32FlatHashMap anchors;
 
 	RuleVector rule_by_number;
@@ -145,6 +164,7 @@ public:
 	Tag* addTag(Tag* tag);
 	void destroyTag(Tag* tag);
 	void addTagToSet(Tag* rtag, Set* set);
+	bool addTextualPattern(Tag* tag);
 
 	Rule* allocateRule();
 	void addRule(Rule* rule);
@@ -155,6 +175,7 @@ public:
 	void addTemplate(ContextualTest* test, const UChar* name);
 
 	void reindex(bool unused_sets = false, bool used_tags = false);
+	void unflattenTries();
 
 	void indexSetToRule(uint32_t, Set*);
 	void indexTagToRule(uint32_t, uint32_t);
@@ -162,9 +183,14 @@ public:
 	void indexTagToSet(uint32_t, uint32_t);
 	void setAdjustSets(Set*);
 	void contextAdjustTarget(ContextualTest*);
+	void contextRequiredSets(const ContextualTest*, uint32SortedVector&);
+	WindowReach contextReach(const ContextualTest*) const;
+	WindowReach ruleReach(const Rule*) const;
 };
 
-inline void trie_unserialize(trie_t& trie, std::istream& input, Grammar& grammar, uint32_t num_tags) {
+template<typename S>
+inline void trie_unserialize(trie_t& trie, S& input, Grammar& grammar, uint32_t num_tags) {
+	trie.reserve(trie.size() + num_tags);
 	for (uint32_t i = 0; i < num_tags; ++i) {
 		auto u32tmp = readBE<uint32_t>(input);
 		trie_node_t& node = trie[grammar.single_tags_list[u32tmp]];
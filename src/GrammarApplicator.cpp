@@ -41,9 +41,11 @@ GrammarApplicator::GrammarApplicator(std::ostream& ux_err)
   , ci_depths(6, 0)
 {
 	gWindow.reset(new Window(this));
+	setMatchCacheSize(UI64(32) << 20);
 }
 
 GrammarApplicator::~GrammarApplicator() {
+	resetTags();
 	if (owns_grammar) {
 		delete grammar;
 	}
@@ -56,20 +58,66 @@ GrammarApplicator::~GrammarApplicator() {
 }
 
 void GrammarApplicator::resetIndexes() {
-	for (auto& sv : index_readingSet_yes) {
-		sv.clear();
+	index_readingSet.clear();
+	index_regexp.clear();
+	index_icase.clear();
+}
+
+void GrammarApplicator::setMatchCacheSize(size_t bytes) {
+	index_readingSet.set_budget(bytes / 2);
+	index_regexp.set_budget(bytes / 4);
+	index_icase.set_budget(bytes / 8);
+	index_regexpLiteral.set_budget(bytes / 8);
+}
+
+void GrammarApplicator::printMatchCacheStats() {
+	auto print = [&](const char* name, const clock_cache& cache) {
+		u_fprintf(ux_stderr, "Info: %s cache: %u hits, %u misses, %u evictions, %u KiB.\n", name, UI32(cache.hits), UI32(cache.misses), UI32(cache.evictions), UI32(cache.bytes() / 1024));
+	};
+	print("Set match", index_readingSet);
+	print("Regex match", index_regexp);
+	print("Case-insensitive match", index_icase);
+	print("Regex literal", index_regexpLiteral);
+	u_fflush(ux_stderr);
+}
+
+void GrammarApplicator::resetTags() {
+	for (auto tag : runtime_tags) {
+		delete tag;
 	}
-	for (auto& sv : index_readingSet_no) {
-		sv.clear();
+	runtime_tags.clear();
+	for (auto& rx : grammar_regexps) {
+		if (rx.second) {
+			uregex_close(rx.second);
+		}
 	}
-	index_regexp_yes.clear();
-	index_regexp_no.clear();
-	index_icase_yes.clear();
-	index_icase_no.clear();
+	grammar_regexps.clear();
+	single_tags.clear();
+	regex_tags.clear();
+	icase_tags.clear();
+	tag_trigrams.clear();
+	did_tag_trigrams = false;
+	index_regexpLiteral.clear();
 }
 
 void GrammarApplicator::setGrammar(Grammar* res) {
 	grammar = res;
+
+	resetTags();
+	single_tags = grammar->single_tags;
+	icase_tags = grammar->icase_tags;
+	grammar_regexps.resize(grammar->single_tags_list.size());
+	for (auto t : grammar->single_tags_list) {
+		if (!t->hasRegexp()) {
+			continue;
+		}
+		grammar_regexps[t->number].first = t;
+		// Only the regexes that can make new tags textual are needed up front
+		if (!is_textual(t->tag)) {
+			regex_tags.emplace(getRegexp(*t), t->regexpLiteral());
+		}
+	}
+
 	tag_begin = addTag(STR_BEGINTAG);
 	tag_end = addTag(STR_ENDTAG);
 	tag_subst = addTag(STR_DUMMY);
@@ -80,15 +128,26 @@ void GrammarApplicator::setGrammar(Grammar* res) {
 	UString mp{ grammar->mapping_prefix };
 	mprefix_key = addTag(UStringView{ u"_MPREFIX" })->hash;
 	mprefix_value = addTag(mp)->hash;
+	for (auto t : runtime_tags) {
+		t->epoch = 0;
+	}
+
+	resetIndexes();
 
-	index_readingSet_yes.clear();
-	index_readingSet_yes.resize(grammar->sets_list.size());
-	index_readingSet_no.clear();
-	index_readingSet_no.resize(grammar->sets_list.size());
+	parse_relations = grammar->has_relations;
+
+	rule_tests.clear();
+	rule_tests.resize(grammar->rule_by_number.size());
+	for (auto rule : grammar->rule_by_number) {
+		rule_tests[rule->number] = rule->tests;
+	}
+	context_memoable.clear();
+	set_memoable.clear();
+	set_memoable.resize(grammar->sets_list.size());
 
 	if (res->text_delimiters) {
 		TagList theTags;
-		trie_getTagList(res->text_delimiters->trie, theTags);
+		trie_getTagList(res->text_delimiters->trie_flat, res->single_tags, theTags);
 		trie_getTagList(res->text_delimiters->trie_special, theTags);
 		for (auto& t : theTags) {
 			UParseError pe;
@@ -144,6 +203,8 @@ void GrammarApplicator::index() {
 	if (!add_spacing) {
 		ws[2] = '\n';
 	}
+	// Options may have changed since the last run
+	indexWindowReach();
 	if (did_index) {
 		return;
 	}
@@ -226,20 +287,60 @@ void GrammarApplicator::index() {
 	did_index = true;
 }
 
+void GrammarApplicator::indexWindowReach() {
+	WindowReach reach;
+	auto add_section = [&](int32_t section) {
+		auto it = grammar->section_reach.find(section);
+		if (it != grammar->section_reach.end()) {
+			reach.behind = std::max(reach.behind, it->second.behind);
+			reach.ahead = std::max(reach.ahead, it->second.ahead);
+		}
+	};
+	if (!no_before_sections) {
+		add_section(-1);
+	}
+	if (!no_after_sections) {
+		add_section(-2);
+	}
+	add_section(-3);
+	if (!no_sections) {
+		if (sections.empty()) {
+			for (uint32_t i = 0; i < grammar->sections.size(); ++i) {
+				add_section(SI32(i));
+			}
+		}
+		else {
+			for (auto s : sections) {
+				add_section(SI32(s) - 1);
+			}
+		}
+	}
+	// Dependency and relation numbers may point at any cohort still in memory, and --always-span lets every context cross windows
+	if (always_span || grammar->has_dep || dep_delimit || grammar->has_relations || grammar->section_reach.empty()) {
+		reach.behind = reach.ahead = WindowReach::ANY;
+	}
+	windows_behind = std::min(num_windows, reach.behind);
+	windows_ahead = std::min(num_windows, reach.ahead);
+	if (verbosity_level > 0 && (windows_behind < num_windows || windows_ahead < num_windows)) {
+		u_fprintf(ux_stderr, "Info: Grammar contexts reach at most %u windows back and %u ahead - keeping that many instead of %u.\n", windows_behind, windows_ahead, num_windows);
+	}
+}
+
 Tag* GrammarApplicator::addTag(Tag* tag) {
 	uint32_t hash = tag->rehash();
 	uint32_t seed = 0;
 	for (; seed < 10000; ++seed) {
 		uint32_t ih = hash + seed;
 		Taguint32HashMap::iterator it;
-		if ((it = grammar->single_tags.find(ih)) != grammar->single_tags.end()) {
+		if ((it = single_tags.find(ih)) != single_tags.end()) {
 			Tag* t = it->second;
 			if (t == tag) {
-				return tag;
+				return touchTag(tag);
 			}
 			if (t->tag == tag->tag) {
 				hash += seed;
 				delete tag;
+				touchTag(t);
 				break;
 			}
 		}
@@ -250,18 +351,187 @@ Tag* GrammarApplicator::addTag(Tag* tag) {
 			}
 			tag->seed = seed;
 			hash = tag->rehash();
-			grammar->single_tags[hash] = tag;
+			// Grammar::reindex() has already done this for the grammar's own tags
+			if (tag->tag[0] == grammar->mapping_prefix) {
+				tag->type |= T_MAPPING;
+			}
+			tag->epoch = tag_epoch;
+			tag->cacheUTF8();
+			single_tags[hash] = tag;
+			runtime_tags.push_back(tag);
+			if (did_tag_trigrams) {
+				indexTagTrigrams(*tag);
+			}
 			break;
 		}
 	}
-	return grammar->single_tags[hash];
+	return single_tags[hash];
+}
+
+inline uint64_t trigram(const UString& str, size_t i) {
+	return (UI64(str[i]) << 32) | (UI64(str[i + 1]) << 16) | UI64(str[i + 2]);
+}
+
+void GrammarApplicator::indexTagTrigrams(const Tag& tag) {
+	if (tag.type & T_TEXTUAL) {
+		return;
+	}
+	for (size_t i = 0; i + 3 <= tag.tag.size(); ++i) {
+		tag_trigrams[trigram(tag.tag, i)].push_back(tag.hash);
+	}
+}
+
+/**
+ * Finds the tags that may contain a literal, by the rarest of its trigrams.
+ *
+ * @return The hashes of tags to check, which may include tags since reclaimed, or nullptr if all tags must be checked
+ */
+const uint32Vector* GrammarApplicator::findTagTrigrams(const UString& literal) {
+	static const uint32Vector none;
+	if (literal.size() < 3) {
+		return nullptr;
+	}
+	if (!did_tag_trigrams) {
+		for (auto& it : single_tags) {
+			indexTagTrigrams(*it.second);
+		}
+		did_tag_trigrams = true;
+	}
+	const uint32Vector* rv = nullptr;
+	for (size_t i = 0; i + 3 <= literal.size(); ++i) {
+		auto it = tag_trigrams.find(trigram(literal, i));
+		if (it == tag_trigrams.end()) {
+			return &none;
+		}
+		if (!rv || it->second.size() < rv->size()) {
+			rv = &it->second;
+		}
+	}
+	return rv;
+}
+
+URegularExpression* GrammarApplicator::openRegexp(const Tag& tag) {
+	UErrorCode status = U_ZERO_ERROR;
+	auto rx = tag.openRegexp(status);
+	if (status != U_ZERO_ERROR) {
+		u_fprintf(ux_stderr, "Error: uregex_open returned %s trying to parse tag %S - cannot continue!\n", u_errorName(status), tag.tag.data());
+		CG3Quit(1);
+	}
+	return rx;
+}
+
+// Grammar tags are shared with other applicators, so they are replaced by a private copy instead of being modified
+void GrammarApplicator::markTextual(Tag* tag) {
+	if (tag->number < grammar->single_tags_list.size() && grammar->single_tags_list[tag->number] == tag) {
+		tag = new Tag(*tag);
+		single_tags[tag->hash] = tag;
+		runtime_tags.push_back(tag);
+	}
+	tag->type |= T_TEXTUAL;
+}
+
+inline size_t getResidentSize() {
+#if defined(__linux__)
+	size_t pages = 0, rss = 0;
+	if (FILE* f = fopen("/proc/self/statm", "r")) {
+		if (fscanf(f, "%zu %zu", &pages, &rss) != 2) {
+			rss = 0;
+		}
+		fclose(f);
+	}
+	return rss * sysconf(_SC_PAGESIZE);
+#else
+	return 0;
+#endif
+}
+
+void GrammarApplicator::reclaimTags() {
+	if (!max_runtime_tags || runtime_tags.size() <= max_runtime_tags) {
+		return;
+	}
+
+	uint32FlatHashSet live;
+	auto mark_readings = [&](const ReadingList& rs) {
+		for (auto r : rs) {
+			for (; r; r = r->next) {
+				live.insert(r->tags_list.begin(), r->tags_list.end());
+				live.insert(r->baseform);
+			}
+		}
+	};
+	auto mark_window = [&](const SingleWindow* sw) {
+		for (auto& kv : sw->variables_set) {
+			live.insert(kv.first);
+			live.insert(kv.second);
+		}
+		live.insert(sw->variables_rem.begin(), sw->variables_rem.end());
+		live.insert(sw->variables_output.begin(), sw->variables_output.end());
+		live.insert(sw->bag_of_tags.tags_list.begin(), sw->bag_of_tags.tags_list.end());
+		for (auto c : sw->all_cohorts) {
+			live.insert(c->wordform->hash);
+			if (c->wread) {
+				live.insert(c->wread->tags_list.begin(), c->wread->tags_list.end());
+			}
+			mark_readings(c->readings);
+			mark_readings(c->deleted);
+			mark_readings(c->delayed);
+			mark_readings(c->ignored);
+			for (auto& rel : c->relations) {
+				live.insert(rel.first);
+			}
+			for (auto& rel : c->relations_input) {
+				live.insert(rel.first);
+			}
+		}
+	};
+	for (auto sw : gWindow->previous) {
+		mark_window(sw);
+	}
+	if (gWindow->current) {
+		mark_window(gWindow->current);
+	}
+	for (auto sw : gWindow->next) {
+		mark_window(sw);
+	}
+	for (auto& kv : variables) {
+		live.insert(kv.first);
+		live.insert(kv.second);
+	}
+
+	size_t kept = 0;
+	for (auto tag : runtime_tags) {
+		// A tag that got a hash seed must not lose the tag it collided with, or the next lookup of its text would find a free slot
+		if (tag->epoch == 0 || tag->epoch == tag_epoch || live.count(tag->hash) || single_tags.count(tag->hash + 1)) {
+			runtime_tags[kept++] = tag;
+			continue;
+		}
+		single_tags.erase(tag->hash);
+		delete tag;
+	}
+	auto reclaimed = runtime_tags.size() - kept;
+	runtime_tags.resize(kept);
+	// Erased entries leave markers that lookups have to step over until the table is rebuilt
+	single_tags.reserve(single_tags.capacity());
+	if (++tag_epoch == 0) {
+		tag_epoch = 1;
+	}
+	// A freed hash may be given to a different tag later, so nothing keyed on tag hashes may survive
+	resetIndexes();
+	tag_trigrams.clear();
+	did_tag_trigrams = false;
+	index_regexpLiteral.clear();
+
+	if (verbosity_level > 0) {
+		u_fprintf(ux_stderr, "Info: Reclaimed %u runtime tags, %u left, %u KiB resident.\n", UI32(reclaimed), UI32(kept), UI32(getResidentSize() / 1024));
+		u_fflush(ux_stderr);
+	}
 }
 
 Tag* GrammarApplicator::addTag(const UChar* txt, uint32_t type) {
 	Taguint32HashMap::iterator it;
 	uint32_t thash = hash_value(txt);
-	if ((it = grammar->single_tags.find(thash)) != grammar->single_tags.end() && !it->second->tag.empty() && it->second->tag == txt) {
-		return it->second;
+	if ((it = single_tags.find(thash)) != single_tags.end() && !it->second->tag.empty() && it->second->tag == txt) {
+		return touchTag(it->second);
 	}
 
 	Tag* tag = nullptr;
@@ -270,47 +540,67 @@ Tag* GrammarApplicator::addTag(const UChar* txt, uint32_t type) {
 	}
 	else {
 		tag = new Tag();
-		tag->parseTagRaw(txt, grammar);
+		tag->parseTagRaw(txt, *this);
 		tag = addTag(tag);
 	}
 
-	bool reflow = false;
+	// Existing tags were checked against the other patterns when they were created, so only the new pattern needs testing
+	uint32SortedVector textuals;
 	if ((tag->type & T_REGEXP) && !is_textual(tag->tag)) {
-		if (grammar->regex_tags.insert(tag->regexp).second) {
-			for (auto& titer : grammar->single_tags) {
-				if (titer.second->type & T_TEXTUAL) {
-					continue;
+		auto rx = getRegexp(*tag);
+		auto literal = tag->regexpLiteral();
+		if (regex_tags.emplace(rx, literal).second) {
+			// Runtime regex tags own the regex that is now in regex_tags
+			tag->epoch = 0;
+			auto check = [&](Tag* t) {
+				if (t->type & T_TEXTUAL) {
+					return;
+				}
+				if (!literal.empty() && t->tag.find(literal) == UString::npos) {
+					return;
+				}
+				UErrorCode status = U_ZERO_ERROR;
+				uregex_setText(rx, t->tag.data(), SI32(t->tag.size()), &status);
+				if (status == U_ZERO_ERROR) {
+					if (uregex_find(rx, -1, &status)) {
+						markTextual(t);
+						textuals.insert(t->hash);
+					}
 				}
-				for (auto iter : grammar->regex_tags) {
-					UErrorCode status = U_ZERO_ERROR;
-					uregex_setText(iter, titer.second->tag.data(), SI32(titer.second->tag.size()), &status);
-					if (status == U_ZERO_ERROR) {
-						if (uregex_find(iter, -1, &status)) {
-							titer.second->type |= T_TEXTUAL;
-							reflow = true;
-						}
+			};
+			if (auto hashes = findTagTrigrams(literal)) {
+				for (auto h : *hashes) {
+					auto it = single_tags.find(h);
+					if (it != single_tags.end()) {
+						check(it->second);
 					}
 				}
 			}
+			else {
+				for (auto& titer : single_tags) {
+					check(titer.second);
+				}
+			}
 		}
 	}
 	if ((tag->type & T_CASE_INSENSITIVE) && !is_textual(tag->tag)) {
-		if (grammar->icase_tags.insert(tag).second) {
-			for (auto& titer : grammar->single_tags) {
+		if (icase_tags.insert(tag).second) {
+			tag->epoch = 0;
+			for (auto& titer : single_tags) {
 				if (titer.second->type & T_TEXTUAL) {
 					continue;
 				}
-				for (auto iter : grammar->icase_tags) {
-					if (ux_strCaseCompare(titer.second->tag, iter->tag)) {
-						titer.second->type |= T_TEXTUAL;
-						reflow = true;
-					}
+				if (ux_strCaseCompare(titer.second->tag, tag->tag)) {
+					markTextual(titer.second);
+					textuals.insert(titer.first);
 				}
 			}
 		}
 	}
-	if (reflow) {
-		reflowTextuals();
+	if (!textuals.empty()) {
+		reflowTextuals(textuals);
+		// Tags that just became textual can make cached set and regex results wrong
+		resetIndexes();
 	}
 	return tag;
 }
@@ -328,14 +618,22 @@ void GrammarApplicator::printPlainTextLine(UStringView line, std::ostream& outpu
 	u_fprintf(output, "%S", line.data());
 }
 
+// The first tag of a set, preferring plain tags just like Set::getNonEmpty(), but without needing the mutable trie
+inline const Tag* first_tag(const Grammar& grammar, const Set& set) {
+	if (!set.trie_flat.empty()) {
+		return grammar.single_tags.find(set.trie_flat[0].hash)->second;
+	}
+	return set.trie_special.begin()->first;
+}
+
 void GrammarApplicator::printTrace(std::ostream& output, uint32_t hit_by) {
 	if (hit_by < grammar->rule_by_number.size()) {
 		const Rule* r = grammar->rule_by_number[hit_by];
 		u_fprintf(output, "%S", keywords[r->type].data());
 		if (r->type == K_ADDRELATION || r->type == K_SETRELATION || r->type == K_REMRELATION || r->type == K_ADDRELATIONS || r->type == K_SETRELATIONS || r->type == K_REMRELATIONS) {
-			u_fprintf(output, "(%S", r->maplist->getNonEmpty().begin()->first->tag.data());
+			u_fprintf(output, "(%S", first_tag(*grammar, *r->maplist)->tag.data());
 			if (r->type == K_ADDRELATIONS || r->type == K_SETRELATIONS || r->type == K_REMRELATIONS) {
-				u_fprintf(output, ",%S", r->sublist->getNonEmpty().begin()->first->tag.data());
+				u_fprintf(output, ",%S", first_tag(*grammar, *r->sublist)->tag.data());
 			}
 			u_fprintf(output, ")");
 		}
@@ -370,7 +668,7 @@ void GrammarApplicator::printReading(const Reading* reading, std::ostream& outpu
 	}
 
 	if (reading->baseform) {
-		u_fprintf(output, "%S", grammar->single_tags.find(reading->baseform)->second->tag.data());
+		single_tags.find(reading->baseform)->second->printUTF8(output);
 	}
 
 	uint32SortedVector unique;
@@ -390,7 +688,7 @@ void GrammarApplicator::printReading(const Reading* reading, std::ostream& outpu
 			}
 			unique.insert(tter);
 		}
-		auto tag = grammar->single_tags[tter];
+		auto tag = single_tags[tter];
 		if (tag->type & T_DEPENDENCY && has_dep && !dep_original) {
 			continue;
 		}
@@ -402,10 +700,12 @@ void GrammarApplicator::printReading(const Reading* reading, std::ostream& outpu
 			mappings.push_back(tag);
 			continue;
 		}
-		u_fprintf(output, " %S", tag->tag.data());
+		output.put(' ');
+		tag->printUTF8(output);
 	}
 	for (auto tag : mappings) {
-		u_fprintf(output, " %S", tag->tag.data());
+		output.put(' ');
+		tag->printUTF8(output);
 	}
 
 	if (has_dep && !(reading->parent->type & CT_REMOVED)) {
@@ -463,9 +763,9 @@ void GrammarApplicator::printReading(const Reading* reading, std::ostream& outpu
 		if (!reading->parent->relations.empty()) {
 			for (const auto& miter : reading->parent->relations) {
 				for (auto siter : miter.second) {
-					auto it = grammar->single_tags.find(miter.first);
-					if (it == grammar->single_tags.end()) {
-						it = grammar->single_tags.find(miter.first);
+					auto it = single_tags.find(miter.first);
+					if (it == single_tags.end()) {
+						it = single_tags.find(miter.first);
 					}
 					u_fprintf(output, " R:%S:%u", it->second->tag.data(), siter);
 				}
@@ -511,14 +811,15 @@ void GrammarApplicator::printCohort(Cohort* cohort, std::ostream& output, bool p
 		u_fputc(';', output);
 		u_fputc(' ', output);
 	}
-	u_fprintf(output, "%S", cohort->wordform->tag.data());
+	cohort->wordform->printUTF8(output);
 	if (cohort->wread) {
 		for (auto tter : cohort->wread->tags_list) {
 			if (tter == cohort->wordform->hash) {
 				continue;
 			}
-			const Tag* tag = grammar->single_tags[tter];
-			u_fprintf(output, " %S", tag->tag.data());
+			const Tag* tag = single_tags[tter];
+			output.put(' ');
+			tag->printUTF8(output);
 		}
 	}
 	u_fputc('\n', output);
@@ -561,12 +862,12 @@ removed:
 
 void GrammarApplicator::printSingleWindow(SingleWindow* window, std::ostream& output, bool profiling) {
 	for (auto var : window->variables_output) {
-		Tag* key = grammar->single_tags[var];
+		Tag* key = single_tags[var];
 		auto iter = window->variables_set.find(var);
 		UString cmd_buf;
 		if (iter != window->variables_set.end()) {
 			if (iter->second != grammar->tag_any) {
-				Tag* value = grammar->single_tags[iter->second];
+				Tag* value = single_tags[iter->second];
 				cmd_buf.append(STR_CMD_SETVAR).append(key->tag).append(u"=").append(value->tag).append(u">");
 			}
 			else {
@@ -597,6 +898,11 @@ void GrammarApplicator::printSingleWindow(SingleWindow* window, std::ostream& ou
 	u_fflush(output);
 }
 
+void GrammarApplicator::outputSingleWindow(SingleWindow* window, std::ostream& output) {
+	printSingleWindow(window, window_buffer);
+	window_buffer.writeTo(output);
+}
+
 void GrammarApplicator::pipeOutReading(const Reading* reading, std::ostream& output) {
 	std::ostringstream ss;
 
@@ -615,7 +921,7 @@ void GrammarApplicator::pipeOutReading(const Reading* reading, std::ostream& out
 	writeRaw(ss, flags);
 
 	if (reading->baseform) {
-		writeUTF8_Raw(ss, grammar->single_tags.find(reading->baseform)->second->tag);
+		writeUTF8_Raw(ss, single_tags.find(reading->baseform)->second->tag);
 	}
 
 	uint32_t cs = 0;
@@ -623,7 +929,7 @@ void GrammarApplicator::pipeOutReading(const Reading* reading, std::ostream& out
 		if (tter == reading->baseform || tter == reading->parent->wordform->hash) {
 			continue;
 		}
-		const Tag* tag = grammar->single_tags.find(tter)->second;
+		const Tag* tag = single_tags.find(tter)->second;
 		if (tag->type & T_DEPENDENCY && has_dep) {
 			continue;
 		}
@@ -635,7 +941,7 @@ void GrammarApplicator::pipeOutReading(const Reading* reading, std::ostream& out
 		if (tter == reading->baseform || tter == reading->parent->wordform->hash) {
 			continue;
 		}
-		const Tag* tag = grammar->single_tags.find(tter)->second;
+		const Tag* tag = single_tags.find(tter)->second;
 		if (tag->type & T_DEPENDENCY && has_dep) {
 			continue;
 		}
@@ -730,7 +1036,7 @@ void GrammarApplicator::pipeInReading(Reading* reading, Process& input, bool for
 
 	if (flags & (1 << 3)) {
 		UString str = readUTF8_Raw(ss);
-		if (str != grammar->single_tags.find(reading->baseform)->second->tag) {
+		if (str != single_tags.find(reading->baseform)->second->tag) {
 			Tag* tag = addTag(str);
 			reading->baseform = tag->hash;
 		}
@@ -1031,6 +1337,12 @@ void GrammarApplicator::setOptions(UConverter* conv) {
 	if (options[HARD_LIMIT].doesOccur) {
 		hard_limit = std::stoul(options[HARD_LIMIT].value);
 	}
+	if (options[MAX_RUNTIME_TAGS].doesOccur) {
+		max_runtime_tags = std::stoul(options[MAX_RUNTIME_TAGS].value);
+	}
+	if (options[MATCH_CACHE_SIZE].doesOccur) {
+		setMatchCacheSize(UI64(std::stoul(options[MATCH_CACHE_SIZE].value)) << 20);
+	}
 	if (options[TEXT_DELIMIT].doesOccur) {
 		UString rx{ STR_TEXTDELIM_DEFAULT };
 		if (!options[TEXT_DELIMIT].value.empty()) {
@@ -30,6 +30,8 @@
 #include "Window.hpp"
 #include "interval_vector.hpp"
 #include "flat_unordered_set.hpp"
+#include "clock_cache.hpp"
+#include "MatchMemo.hpp"
 #include "scoped_stack.hpp"
 #include "cg3.h"
 #include <deque>
@@ -138,8 +140,17 @@ public:
 	bool dep_block_crossing = false;
 
 	uint32_t num_windows = 2;
+	// How many windows to wait for before running one, and to keep after it has run, as far as the grammar can reach but at most num_windows
+	uint32_t windows_ahead = 2;
+	uint32_t windows_behind = 2;
 	uint32_t soft_limit = 300;
 	uint32_t hard_limit = 500;
+	uint32_t max_runtime_tags = 0;
+	// How often a rule could reuse a contextual test result that an earlier rule had found for the same cohort
+	uint64_t numContextHits = 0;
+	uint64_t numContextMisses = 0;
+	// How often a rule wasn't tried at all because its window lacks a set its contextual tests need
+	uint64_t numRulesSkipped = 0;
 	uint32Vector sections;
 	uint32IntervalVector valid_rules;
 	uint32IntervalVector trace_rules;
@@ -155,6 +166,7 @@ public:
 	void setGrammar(Grammar* res);
 	void setTextDelimiter(UString rx);
 	void index();
+	void indexWindowReach();
 
 	virtual void runGrammarOnText(std::istream& input, std::ostream& output);
 
@@ -165,10 +177,22 @@ public:
 	void reflowDependencyWindow(uint32_t max = 0);
 
 	bool has_relations = false;
+	bool parse_relations = false;
 	void reflowRelationWindow(uint32_t max = 0);
 
 	Grammar* grammar = nullptr;
 	Profiler* profiler = nullptr;
+	// When sampling, profiler is only pointed at sample_profiler for 1 in profile_sample windows, and is null for the rest
+	Profiler* sample_profiler = nullptr;
+	uint32_t profile_sample = 0;
+	uint32_t profile_countdown = 0;
+	// Regex answers by tag text, shared between applicators and runs
+	MatchMemo* match_memo = nullptr;
+
+	// The grammar is never modified while applying it, so tags from the input go into this per-applicator copy of the tag table instead
+	Taguint32HashMap single_tags;
+	TextualRegexes regex_tags;
+	TagSortedVector icase_tags;
 
 	Tag* addTag(Tag* tag);
 	Tag* addTag(const UChar* tag, uint32_t type = 0);
@@ -194,8 +218,13 @@ public:
 	void error(const char* str, const UChar* s, const UChar* p);
 	void error(const char* str, const char* s, const UChar* S, const UChar* p);
 	Grammar* get_grammar() { return grammar; }
+	Taguint32HashMap& get_tags() { return single_tags; }
+	TextualRegexes& get_regex_tags() { return regex_tags; }
+	TagSortedVector& get_icase_tags() { return icase_tags; }
 
 	void setOptions(UConverter* conv = nullptr);
+	void setMatchCacheSize(size_t bytes);
+	void printMatchCacheStats();
 
 protected:
 	void printTrace(std::ostream& output, uint32_t hit_by);
@@ -204,6 +233,7 @@ protected:
 	virtual void printSingleWindow(SingleWindow* window, std::ostream& output, bool profiling = false);
 	virtual void printStreamCommand(UStringView cmd, std::ostream& output);
 	virtual void printPlainTextLine(UStringView line, std::ostream& output);
+	void outputSingleWindow(SingleWindow* window, std::ostream& output);
 
 	void pipeOutReading(const Reading* reading, std::ostream& output);
 	void pipeOutCohort(const Cohort* cohort, std::ostream& output);
@@ -225,6 +255,54 @@ protected:
 	bool did_index = false;
 	sorted_vector<std::pair<uint32_t, uint32_t>> dep_deep_seen;
 
+	TagList runtime_tags;
+	std::vector<std::pair<const Tag*, URegularExpression*>> grammar_regexps;
+	std::vector<ContextList> rule_tests;
+	void resetTags();
+	void markTextual(Tag* tag);
+
+	// Plain tags by the trigrams of their text, built when the first pattern appears at runtime so later ones needn't scan all tags
+	std::unordered_map<uint64_t, uint32Vector> tag_trigrams;
+	bool did_tag_trigrams = false;
+	void indexTagTrigrams(const Tag& tag);
+	const uint32Vector* findTagTrigrams(const UString& literal);
+
+	// Whether a regex literal occurs in an input tag, keyed on literal number and tag hash; bounded like the match caches below
+	clock_cache index_regexpLiteral;
+	bool hasRegexpLiteral(const Tag& itag, const Tag& tag);
+
+	// Runtime tags remember the last epoch they were looked up in, so reclaimTags() leaves alone whatever a reader is still holding on to
+	uint32_t tag_epoch = 1;
+	Tag* touchTag(Tag* tag) {
+		if (tag->epoch) {
+			tag->epoch = tag_epoch;
+		}
+		return tag;
+	}
+	void reclaimTags();
+
+	// ICU regex objects hold match state, so each applicator matches with its own copies of the grammar's regexes, made on first use
+	bool isGrammarRegexp(const Tag& tag) const {
+		return tag.number < grammar_regexps.size() && grammar_regexps[tag.number].first == &tag;
+	}
+	URegularExpression* getRegexp(const Tag& tag) {
+		if (isGrammarRegexp(tag)) {
+			auto& rx = grammar_regexps[tag.number].second;
+			if (!rx) {
+				rx = openRegexp(tag);
+			}
+			return rx;
+		}
+		if (!tag.regexp) {
+			tag.regexp = openRegexp(tag);
+		}
+		return tag.regexp;
+	}
+	URegularExpression* openRegexp(const Tag& tag);
+
+	// Windows are printed into this first, so the output stream gets a single write per window
+	UOutputBuffer window_buffer;
+
 	uint32_t numsections = 0;
 	typedef std::map<int32_t, uint32IntervalVector> RSType;
 	RSType runsections;
@@ -232,13 +310,23 @@ protected:
 	typedef std::map<uint32_t, Process> externals_t;
 	externals_t externals;
 
+	// Iterators are handed out in order while a contextual test runs and all taken back before the next one.
+	// A deque keeps the ones in use in place as more are added, and keeps the rest around with their storage for reuse.
 	uint32Vector ci_depths;
-	std::map<uint32_t, CohortIterator> cohortIterators;
-	std::map<uint32_t, TopologyLeftIter> topologyLeftIters;
-	std::map<uint32_t, TopologyRightIter> topologyRightIters;
-	std::map<uint32_t, DepParentIter> depParentIters;
-	std::map<uint32_t, DepDescendentIter> depDescendentIters;
-	std::map<uint32_t, DepAncestorIter> depAncestorIters;
+	std::deque<CohortIterator> cohortIterators;
+	std::deque<TopologyLeftIter> topologyLeftIters;
+	std::deque<TopologyRightIter> topologyRightIters;
+	std::deque<DepParentIter> depParentIters;
+	std::deque<DepDescendentIter> depDescendentIters;
+	std::deque<DepAncestorIter> depAncestorIters;
+
+	template<typename Iter>
+	Iter& nextIterator(std::deque<Iter>& iters, uint32_t& depth) {
+		if (depth >= iters.size()) {
+			iters.resize(depth + 1);
+		}
+		return iters[depth++];
+	}
 
 	uint32_t match_single = 0, match_comp = 0, match_sub = 0;
 	uint32_t begintag = 0, endtag = 0, substtag = 0;
@@ -249,6 +337,8 @@ protected:
 	uint32_t mprefix_key = 0, mprefix_value = 0;
 
 	tmpl_context_t tmpl_cntx;
+	// Copies of templates with a test's override position, offset, and barriers applied, so the grammar's own stay untouched
+	std::map<std::pair<const ContextualTest*, const ContextualTest*>, ContextualTest> tmpl_overrides;
 
 	std::vector<regexgrps_t> regexgrps_store;
 	bc::flat_map<uint32_t, uint8_t> regexgrps_z;
@@ -288,14 +378,26 @@ protected:
 	scoped_stack<unif_tags_t> ss_utags;
 	scoped_stack<unif_sets_t> ss_usets;
 	scoped_stack<uint32SortedVector> ss_u32sv;
-
-	uint64FlatHashSet index_regexp_yes;
-	uint64FlatHashSet index_regexp_no;
-	uint64FlatHashSet index_icase_yes;
-	uint64FlatHashSet index_icase_no;
-	std::vector<uint32FlatHashSet> index_readingSet_yes;
-	std::vector<uint32FlatHashSet> index_readingSet_no;
+	// Ranges of a set's trie_flat still to visit, reused by doesSetMatchReading_flat()
+	std::vector<std::pair<uint32_t, uint32_t>> trie_walk;
+
+	// Whether a set, regex, or case-insensitive tag matched a reading or tag, keyed on both hashes.
+	// Bounded by setMatchCacheSize(), and only cleared when tag hashes may have changed meaning.
+	clock_cache index_regexp;
+	clock_cache index_icase;
+	clock_cache index_readingSet;
 	uint32FlatHashSet index_ruleCohort_no;
+	// Results of contextual tests that only look at the window's contents, keyed on test hash and position, so that many rules sharing a test only run it once per cohort.
+	// Entries from before the last time a rule acted on anything are stale; bumping the generation is cheaper than clearing the table every time.
+	flat_unordered_map<uint64_t, std::pair<uint32_t, Cohort*>> index_contextCohort;
+	uint32_t context_generation = 1;
+	uint32FlatHashMap context_memoable;
+	std::vector<uint8_t> set_memoable;
+	bool isContextMemoable(const ContextualTest* test);
+	bool isSetMemoable(uint32_t set);
+	void clearContextCohort() {
+		++context_generation;
+	}
 	void resetIndexes();
 
 	Tag* makeBaseFromWord(uint32_t tag);
@@ -322,7 +424,7 @@ protected:
 	Cohort* runSingleTest(Cohort* cohort, const ContextualTest* test, uint8_t& rvs, bool* retval, Cohort** deep = nullptr, Cohort* origin = nullptr);
 	Cohort* runSingleTest(SingleWindow* sWindow, size_t i, const ContextualTest* test, uint8_t& rvs, bool* retval, Cohort** deep = nullptr, Cohort* origin = nullptr);
 	bool posOutputHelper(const SingleWindow* sWindow, size_t position, const ContextualTest* test, const Cohort* cohort, const Cohort* cdeep);
-	Cohort* runContextualTest_tmpl(SingleWindow* sWindow, size_t position, const ContextualTest* test, ContextualTest* tmpl, Cohort*& cdeep, Cohort* origin);
+	Cohort* runContextualTest_tmpl(SingleWindow* sWindow, size_t position, const ContextualTest* test, const ContextualTest* tmpl, Cohort*& cdeep, Cohort* origin);
 	Cohort* runContextualTest(SingleWindow* sWindow, size_t position, const ContextualTest* test, Cohort** deep = nullptr, Cohort* origin = nullptr);
 	Cohort* runDependencyTest(SingleWindow* sWindow, Cohort* current, const ContextualTest* test, Cohort** deep = nullptr, Cohort* origin = nullptr, const Cohort* self = nullptr);
 	Cohort* runParenthesisTest(SingleWindow* sWindow, const Cohort* current, const ContextualTest* test, Cohort** deep = nullptr, Cohort* origin = nullptr);
@@ -335,6 +437,7 @@ protected:
 	uint32_t doesRegexpMatchReading(const Reading& reading, const Tag& tag, bool bypass_index = false);
 	uint32_t doesTagMatchReading(const Reading& reading, const Tag& tag, bool unif_mode = false, bool bypass_index = false);
 	bool doesSetMatchReading_trie(const Reading& reading, const Set& theset, const trie_t& trie, bool unif_mode = false);
+	bool doesSetMatchReading_flat(const Reading& reading, const Set& theset, uint32_t root, bool unif_mode = false);
 	bool doesSetMatchReading_tags(const Reading& reading, const Set& theset, bool unif_mode = false);
 	bool doesSetMatchReading(const Reading& reading, const uint32_t set, bool bypass_index = false, bool unif_mode = false);
 
@@ -359,10 +462,10 @@ protected:
 	bool wouldParentChildCross(const Cohort* parent, const Cohort* child);
 	bool attachParentChild(Cohort& parent, Cohort& child, bool allowloop = false, bool allowcrossing = false);
 
-	void reflowTextuals_Reading(Reading& r);
-	void reflowTextuals_Cohort(Cohort& c);
-	void reflowTextuals_SingleWindow(SingleWindow& sw);
-	void reflowTextuals();
+	void reflowTextuals_Reading(Reading& r, const uint32SortedVector& textuals);
+	void reflowTextuals_Cohort(Cohort& c, const uint32SortedVector& textuals);
+	void reflowTextuals_SingleWindow(SingleWindow& sw, const uint32SortedVector& textuals);
+	void reflowTextuals(const uint32SortedVector& textuals);
 
 	Reading* initEmptyCohort(Cohort& cohort);
 
@@ -423,15 +526,18 @@ protected:
 		item.example_window = sz;
 	}
 
-	void profileRuleContext(bool test_good, const Rule* rule, const ContextualTest* test) {
+	void profileRuleContext(bool test_good, const Rule* rule, const ContextualTest* test, Profiler::clock::time_point start = {}) {
 		if (profiler) {
 			Profiler::Key k{ ET_CONTEXT, test->hash };
 			auto pit = profiler->entries.find(k);
 			if (pit != profiler->entries.end()) {
 				auto& t = pit->second;
+				if (start != Profiler::clock::time_point()) {
+					t.time += Profiler::since(start);
+				}
 				if ((test_good && !(test->pos & POS_NEGATE)) || (!test_good && (test->pos & POS_NEGATE))) {
 					++t.num_match;
-					if (!t.example_window) {
+					if (!t.example_window && profiler->examples) {
 						addProfilingExample(t);
 					}
 					auto rc = std::make_pair(rule->number + 1, test->hash);
@@ -443,6 +549,17 @@ protected:
 			}
 		}
 	}
+
+	void profileRuleTime(const Rule& rule, Profiler::clock::time_point start) {
+		auto ns = Profiler::since(start);
+		profiler->entries[Profiler::Key{ ET_RULE, rule.number + 1 }].time += ns;
+		// Rules nested in WITH run inside their parent, whose section already has the time
+		if (!in_nested) {
+			auto& s = profiler->entries[Profiler::Key{ ET_SECTION, UI32(rule.section) }];
+			s.type = ET_SECTION;
+			s.time += ns;
+		}
+	}
 };
 }
 
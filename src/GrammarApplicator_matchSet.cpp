@@ -26,9 +26,65 @@
 #include "Reading.hpp"
 #include "ContextualTest.hpp"
 #include "MathParser.hpp"
+#include <bitset>
+#if defined(__AVX2__)
+	#include <immintrin.h>
+#elif defined(__SSE2__)
+	#include <emmintrin.h>
+#endif
 
 namespace CG3 {
 
+/**
+ * Finds the first of keys[from..n) that isn't less than v, for sorted keys.
+ *
+ * Gallops from the previous position since the next tag of a reading is usually close by, then counts the keys
+ * below v in the last short stretch several at a time where the CPU allows it.
+ */
+inline size_t gallop_lower_bound(const uint32_t* keys, size_t from, size_t n, uint32_t v) {
+	size_t hi = from;
+	for (size_t step = 1; hi < n && keys[hi] < v; step <<= 1) {
+		from = hi + 1;
+		hi += step;
+	}
+	hi = std::min(hi, n);
+	while (hi - from > 8) {
+		size_t mid = from + (hi - from) / 2;
+		if (keys[mid] < v) {
+			from = mid + 1;
+		}
+		else {
+			hi = mid;
+		}
+	}
+	// Signed comparisons only, so flip the top bit to compare unsigned
+#if defined(__AVX2__)
+	const __m256i flip8 = _mm256_set1_epi32(INT32_MIN);
+	const __m256i v8 = _mm256_xor_si256(_mm256_set1_epi32(static_cast<int32_t>(v)), flip8);
+	for (; hi - from >= 8; from += 8) {
+		__m256i k = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + from)), flip8);
+		auto less = static_cast<uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(v8, k))));
+		if (less != 0xFF) {
+			return from + std::bitset<8>(less).count();
+		}
+	}
+#endif
+#if defined(__SSE2__)
+	const __m128i flip4 = _mm_set1_epi32(INT32_MIN);
+	const __m128i v4 = _mm_xor_si128(_mm_set1_epi32(static_cast<int32_t>(v)), flip4);
+	for (; hi - from >= 4; from += 4) {
+		__m128i k = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + from)), flip4);
+		auto less = static_cast<uint32_t>(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmplt_epi32(k, v4))));
+		if (less != 0xF) {
+			return from + std::bitset<8>(less).count();
+		}
+	}
+#endif
+	for (; from < hi && keys[from] < v; ++from) {
+	}
+	return from;
+}
+
 /**
  * Tests whether one set is a subset of another set, specialized for TagSet.
  *
@@ -57,8 +113,8 @@ inline bool TagSet_SubsetOf_TSet(const TagSortedVector& a, const T& b) {
 	return true;
 }
 
-template<typename RXGS, typename Tag>
-inline void captureRegex(int32_t gc, uint8_t& regexgrp_ct, RXGS* regexgrps, Tag& tag) {
+template<typename RXGS>
+inline void captureRegex(int32_t gc, uint8_t& regexgrp_ct, RXGS* regexgrps, URegularExpression* rx) {
 	constexpr auto BUFSIZE = 1024;
 	UErrorCode status = U_ZERO_ERROR;
 	UChar _tmp[BUFSIZE];
@@ -66,12 +122,12 @@ inline void captureRegex(int32_t gc, uint8_t& regexgrp_ct, RXGS* regexgrps, Tag&
 	UChar* tmp = _tmp;
 	for (int i = 1; i <= gc; ++i) {
 		tmp[0] = 0;
-		int32_t len = uregex_group(tag.regexp, i, tmp, BUFSIZE, &status);
+		int32_t len = uregex_group(rx, i, tmp, BUFSIZE, &status);
 		if (len >= BUFSIZE) {
 			status = U_ZERO_ERROR;
 			_stmp.resize(len + 1);
 			tmp = &_stmp[0];
-			uregex_group(tag.regexp, i, tmp, len + 1, &status);
+			uregex_group(rx, i, tmp, len + 1, &status);
 		}
 		regexgrps->resize(std::max(static_cast<size_t>(regexgrp_ct) + 1, regexgrps->size()));
 		UnicodeString& ucstr = (*regexgrps)[regexgrp_ct];
@@ -211,6 +267,36 @@ uint32_t test_tag_numerical(const Reading& reading, const Tag& tag, const Tag& i
 	return match;
 }
 
+/**
+* Tells whether an input tag contains the literal text that a grammar regex tag needs in order to match, so that certain misses needn't go to ICU.
+* An input tag is scanned for all of the grammar's literals at once whenever the answer isn't cached, and every literal found is cached.
+*
+* @param[in] itag The input tag
+* @param[in] tag The regex tag
+*/
+bool GrammarApplicator::hasRegexpLiteral(const Tag& itag, const Tag& tag) {
+	if (!isGrammarRegexp(tag) || tag.number >= grammar->regex_literal_of.size()) {
+		return true;
+	}
+	auto literal = grammar->regex_literal_of[tag.number];
+	if (literal == grammar->regex_literals.NONE) {
+		return true;
+	}
+	auto known = index_regexpLiteral.find((UI64(literal) << 32) | itag.hash);
+	if (known != clock_cache::UNKNOWN) {
+		return known != 0;
+	}
+	bool found = false;
+	grammar->regex_literals.find(itag.tag, [&](uint32_t s) {
+		index_regexpLiteral.insert((UI64(s) << 32) | itag.hash, true);
+		found |= (s == literal);
+	});
+	if (!found) {
+		index_regexpLiteral.insert((UI64(literal) << 32) | itag.hash, false);
+	}
+	return found;
+}
+
 /**
 * Tests whether a given input tag matches a given tag's stored regular expression.
 *
@@ -219,24 +305,39 @@ uint32_t test_tag_numerical(const Reading& reading, const Tag& tag, const Tag& i
 */
 uint32_t GrammarApplicator::doesTagMatchRegexp(uint32_t test, const Tag& tag, bool bypass_index) {
 	UErrorCode status = U_ZERO_ERROR;
-	int32_t gc = uregex_groupCount(tag.regexp, &status);
+	auto rx = getRegexp(tag);
+	int32_t gc = uregex_groupCount(rx, &status);
 	uint32_t match = 0;
 	auto ih = (UI64(tag.hash) << 32) | test;
-	if (!bypass_index && index_regexp_no.contains(ih)) {
+	auto known = bypass_index ? clock_cache::UNKNOWN : index_regexp.find(ih);
+	if (known == 0) {
 		match = 0;
 	}
-	else if (!bypass_index && gc == 0 && index_regexp_yes.contains(ih)) {
+	else if (gc == 0 && known == 1) {
 		match = test;
 	}
+	else if (!hasRegexpLiteral(*(single_tags.find(test)->second), tag)) {
+		match = 0;
+	}
 	else {
-		const Tag& itag = *(grammar->single_tags.find(test)->second);
-		uregex_setText(tag.regexp, itag.tag.data(), SI32(itag.tag.size()), &status);
+		const Tag& itag = *(single_tags.find(test)->second);
+		bool captures = gc > 0 && !context_stack.empty() && context_stack.back().regexgrps != 0;
+		bool memo = match_memo && isGrammarRegexp(tag);
+		// The memo can say no, but a yes that has to fill in capture groups must still be asked of ICU
+		auto memo_known = memo ? match_memo->find(itag.tag, tag.hash) : MatchMemo::UNKNOWN;
+		if (memo_known == 0 || (memo_known == 1 && !captures && !bypass_index)) {
+			match = memo_known ? itag.hash : 0;
+			index_regexp.insert(ih, memo_known == 1);
+			return match;
+		}
+
+		uregex_setText(rx, itag.tag.data(), SI32(itag.tag.size()), &status);
 		if (status != U_ZERO_ERROR) {
 			u_fprintf(ux_stderr, "Error: uregex_setText(MatchTag) returned %s for tag %S before input line %u - cannot continue!\n", u_errorName(status), tag.tag.data(), numLines);
 			CG3Quit(1);
 		}
 		status = U_ZERO_ERROR;
-		if (uregex_find(tag.regexp, -1, &status)) {
+		if (uregex_find(rx, -1, &status)) {
 			match = itag.hash;
 		}
 		if (status != U_ZERO_ERROR) {
@@ -244,15 +345,18 @@ uint32_t GrammarApplicator::doesTagMatchRegexp(uint32_t test, const Tag& tag, bo
 			CG3Quit(1);
 		}
 		if (match) {
-			if (gc > 0 && !context_stack.empty() && context_stack.back().regexgrps != 0) {
-				captureRegex(gc, context_stack.back().regexgrp_ct, context_stack.back().regexgrps, tag);
+			if (captures) {
+				captureRegex(gc, context_stack.back().regexgrp_ct, context_stack.back().regexgrps, rx);
 			}
 			else {
-				index_regexp_yes.insert(ih);
+				index_regexp.insert(ih, true);
 			}
 		}
 		else {
-			index_regexp_no.insert(ih);
+			index_regexp.insert(ih, false);
+		}
+		if (memo && memo_known == MatchMemo::UNKNOWN) {
+			match_memo->insert(itag.tag, tag.hash, match != 0);
 		}
 	}
 	return match;
@@ -261,22 +365,23 @@ uint32_t GrammarApplicator::doesTagMatchRegexp(uint32_t test, const Tag& tag, bo
 uint32_t GrammarApplicator::doesTagMatchIcase(uint32_t test, const Tag& tag, bool bypass_index) {
 	uint32_t match = 0;
 	auto ih = (UI64(tag.hash) << 32) | test;
-	if (!bypass_index && index_icase_no.contains(ih)) {
+	auto known = bypass_index ? clock_cache::UNKNOWN : index_icase.find(ih);
+	if (known == 0) {
 		match = 0;
 	}
-	else if (!bypass_index && index_icase_yes.contains(ih)) {
+	else if (known == 1) {
 		match = test;
 	}
 	else {
-		const Tag& itag = *(grammar->single_tags.find(test)->second);
+		const Tag& itag = *(single_tags.find(test)->second);
 		if (ux_strCaseCompare(tag.tag, itag.tag)) {
 			match = itag.hash;
 		}
 		if (match) {
-			index_icase_yes.insert(ih);
+			index_icase.insert(ih, true);
 		}
 		else {
-			index_icase_no.insert(ih);
+			index_icase.insert(ih, false);
 		}
 	}
 	return match;
@@ -285,23 +390,25 @@ uint32_t GrammarApplicator::doesTagMatchIcase(uint32_t test, const Tag& tag, boo
 // ToDo: Remove for real ordered mode
 uint32_t GrammarApplicator::doesRegexpMatchLine(const Reading& reading, const Tag& tag, bool bypass_index) {
 	UErrorCode status = U_ZERO_ERROR;
-	int32_t gc = uregex_groupCount(tag.regexp, &status);
+	auto rx = getRegexp(tag);
+	int32_t gc = uregex_groupCount(rx, &status);
 	uint32_t match = 0;
 	auto ih = (UI64(reading.tags_string_hash) << 32) | tag.hash;
-	if (!bypass_index && index_regexp_no.contains(ih)) {
+	auto known = bypass_index ? clock_cache::UNKNOWN : index_regexp.find(ih);
+	if (known == 0) {
 		match = 0;
 	}
-	else if (!bypass_index && gc == 0 && index_regexp_yes.contains(ih)) {
+	else if (gc == 0 && known == 1) {
 		match = reading.tags_string_hash;
 	}
 	else {
-		uregex_setText(tag.regexp, reading.tags_string.data(), SI32(reading.tags_string.size()), &status);
+		uregex_setText(rx, reading.tags_string.data(), SI32(reading.tags_string.size()), &status);
 		if (status != U_ZERO_ERROR) {
 			u_fprintf(ux_stderr, "Error: uregex_setText(MatchLine) returned %s for tag %S before input line %u - cannot continue!\n", u_errorName(status), tag.tag.data(), numLines);
 			CG3Quit(1);
 		}
 		status = U_ZERO_ERROR;
-		if (uregex_find(tag.regexp, -1, &status)) {
+		if (uregex_find(rx, -1, &status)) {
 			match = reading.tags_string_hash;
 		}
 		if (status != U_ZERO_ERROR) {
@@ -311,14 +418,14 @@ uint32_t GrammarApplicator::doesRegexpMatchLine(const Reading& reading, const Ta
 		if (match) {
 			// ToDo: Allow regex captures from dependency target contexts without any captures in normal target contexts
 			if (gc > 0 && !context_stack.empty() && context_stack.back().regexgrps != 0) {
-				captureRegex(gc, context_stack.back().regexgrp_ct, context_stack.back().regexgrps, tag);
+				captureRegex(gc, context_stack.back().regexgrp_ct, context_stack.back().regexgrps, rx);
 			}
 			else {
-				index_regexp_yes.insert(ih);
+				index_regexp.insert(ih, true);
 			}
 		}
 		else {
-			index_regexp_no.insert(ih);
+			index_regexp.insert(ih, false);
 		}
 	}
 	return match;
@@ -365,12 +472,13 @@ uint32_t GrammarApplicator::doesTagMatchReading(const Reading& reading, const Ta
 
 	if (!(tag.type & T_SPECIAL) || tag.type & T_FAILFAST) {
 		uint32SortedVector::const_iterator itf, ite = reading.tags_plain.end();
-		bool raw_in = reading.tags_plain_bloom.matches(tag.hash);
+		bool raw_in = false;
 		if (tag.type & T_FAILFAST) {
 			itf = reading.tags_plain.find(tag.plain_hash);
 			raw_in = (itf != ite);
 		}
-		else if (raw_in) {
+		// Most tags asked about aren't in the reading, and the bloom filter can tell without a search
+		else if (reading.tags_plain_bloom.matches(tag.hash)) {
 			itf = reading.tags_plain.find(tag.hash);
 			raw_in = (itf != ite);
 		}
@@ -388,15 +496,16 @@ uint32_t GrammarApplicator::doesTagMatchReading(const Reading& reading, const Ta
 		match = doesTagMatchReading(reading, *nt, unif_mode, bypass_index);
 	}
 	else if (tag.type & T_META) {
-		if (tag.regexp && !reading.parent->text.empty()) {
+		if (tag.hasRegexp() && !reading.parent->text.empty()) {
+			auto rx = getRegexp(tag);
 			UErrorCode status = U_ZERO_ERROR;
-			uregex_setText(tag.regexp, reading.parent->text.data(), SI32(reading.parent->text.size()), &status);
+			uregex_setText(rx, reading.parent->text.data(), SI32(reading.parent->text.size()), &status);
 			if (status != U_ZERO_ERROR) {
 				u_fprintf(ux_stderr, "Error: uregex_setText(MatchSet) returned %s for tag %S before input line %u - cannot continue!\n", u_errorName(status), tag.tag.data(), numLines);
 				CG3Quit(1);
 			}
 			status = U_ZERO_ERROR;
-			if (uregex_find(tag.regexp, -1, &status)) {
+			if (uregex_find(rx, -1, &status)) {
 				match = tag.hash;
 			}
 			if (status != U_ZERO_ERROR) {
@@ -404,14 +513,14 @@ uint32_t GrammarApplicator::doesTagMatchReading(const Reading& reading, const Ta
 				CG3Quit(1);
 			}
 			if (match) {
-				int32_t gc = uregex_groupCount(tag.regexp, &status);
+				int32_t gc = uregex_groupCount(rx, &status);
 				if (gc > 0 && !context_stack.empty() && context_stack.back().regexgrps != 0) {
-					captureRegex(gc, context_stack.back().regexgrp_ct, context_stack.back().regexgrps, tag);
+					captureRegex(gc, context_stack.back().regexgrp_ct, context_stack.back().regexgrps, rx);
 				}
 			}
 		}
 	}
-	else if (tag.regexp) {
+	else if (tag.hasRegexp()) {
 		match = doesRegexpMatchReading(reading, tag, bypass_index);
 	}
 	else if (tag.type & T_CASE_INSENSITIVE) {
@@ -451,7 +560,7 @@ uint32_t GrammarApplicator::doesTagMatchReading(const Reading& reading, const Ta
 		}
 		else {
 			for (auto mter : reading.tags_textual) {
-				const Tag& itag = *(grammar->single_tags.find(mter)->second);
+				const Tag& itag = *(single_tags.find(mter)->second);
 				if (!(itag.type & (T_BASEFORM | T_WORDFORM))) {
 					match = itag.hash;
 					if (unif_mode) {
@@ -489,8 +598,8 @@ uint32_t GrammarApplicator::doesTagMatchReading(const Reading& reading, const Ta
 			return reading.parent->parent->variables_set;
 		}();
 
-		auto kit = grammar->single_tags.find(tag.comparison_hash);
-		if (kit != grammar->single_tags.end()) {
+		auto kit = single_tags.find(tag.comparison_hash);
+		if (kit != single_tags.end()) {
 			auto key = kit->second;
 			auto it = vars.begin();
 			if (key->type & T_REGEXP) {
@@ -507,7 +616,7 @@ uint32_t GrammarApplicator::doesTagMatchReading(const Reading& reading, const Ta
 					match = tag.hash;
 				}
 				else {
-					auto comp = grammar->single_tags.find(tag.variable_hash)->second;
+					auto comp = single_tags.find(tag.variable_hash)->second;
 					if (comp->type & T_REGEXP) {
 						if (doesTagMatchRegexp(it->second, *comp, bypass_index)) {
 							match = tag.hash;
@@ -587,9 +696,9 @@ void GrammarApplicator::getTagsMatching(const Reading& reading, TagList& theTags
 		auto& tag = *_tag;
 		for (auto tt : reading.tags_list) {
 			uint32_t match = 0;
-			auto itag = grammar->single_tags.find(tt)->second;
+			auto itag = single_tags.find(tt)->second;
 
-			if (tag.regexp) {
+			if (tag.hasRegexp()) {
 				match = doesTagMatchRegexp(tt, tag);
 			}
 			else if (tag.type & T_CASE_INSENSITIVE) {
@@ -646,6 +755,39 @@ bool GrammarApplicator::doesSetMatchReading_trie(const Reading& reading, const S
 	return false;
 }
 
+/**
+ * Tests whether a reading has all the tags along some path below a first-level record of a set's flattened trie.
+ *
+ * Walks the records with a stack of sibling ranges rather than recursing, visiting them in the same order as the
+ * trie itself so unification settles on the same tags. The plain trie holds no special tags, so a hash lookup suffices.
+ */
+bool GrammarApplicator::doesSetMatchReading_flat(const Reading& reading, const Set& theset, uint32_t root, bool unif_mode) {
+	auto& flat = theset.trie_flat;
+	trie_walk.clear();
+	trie_walk.emplace_back(flat[root].first, flat[root].first + flat[root].count);
+	while (!trie_walk.empty()) {
+		auto& range = trie_walk.back();
+		if (range.first == range.second) {
+			trie_walk.pop_back();
+			continue;
+		}
+		auto& node = flat[range.first++];
+		if (!reading.tags_plain_bloom.matches(node.hash) || reading.tags_plain.find(node.hash) == reading.tags_plain.end()) {
+			continue;
+		}
+		if (node.terminal) {
+			if (unif_mode && !check_unif_tags(theset.number, &node)) {
+				continue;
+			}
+			return true;
+		}
+		if (node.count) {
+			trie_walk.emplace_back(node.first, node.first + node.count);
+		}
+	}
+	return false;
+}
+
 /**
  * Tests whether a given reading matches a given LIST set.
  *
@@ -668,30 +810,29 @@ bool GrammarApplicator::doesSetMatchReading_tags(const Reading& reading, const S
 
 	// If there are no special circumstances the first test boils down to finding whether the tag stores intersect
 	// 80% of calls try this first.
-	if (!theset.trie.empty() && !reading.tags_plain.empty()) {
-		auto iiter = theset.trie.lower_bound(grammar->single_tags.find(reading.tags_plain.front())->second);
-		auto oiter = reading.tags_plain.lower_bound(theset.trie.begin()->first->hash);
-		while (oiter != reading.tags_plain.end() && iiter != theset.trie.end()) {
-			if (*oiter == iiter->first->hash) {
-				if (iiter->second.terminal) {
-					if (unif_mode && !check_unif_tags(theset.number, &*iiter)) {
-						++iiter;
-						continue;
-					}
-					retval = true;
-					break;
-				}
-				if (iiter->second.trie && doesSetMatchReading_trie(reading, theset, *iiter->second.trie, unif_mode)) {
-					retval = true;
-					break;
-				}
-				++iiter;
+	if (!theset.trie_keys.empty() && !reading.tags_plain.empty()) {
+		const uint32_t* keys = theset.trie_keys.data();
+		const size_t nkeys = theset.trie_keys.size();
+		size_t k = 0;
+		for (auto oiter = reading.tags_plain.lower_bound(keys[0]); oiter != reading.tags_plain.end(); ++oiter) {
+			k = gallop_lower_bound(keys, k, nkeys, *oiter);
+			if (k == nkeys) {
+				break;
+			}
+			if (keys[k] != *oiter) {
+				continue;
 			}
-			while (oiter != reading.tags_plain.end() && iiter != theset.trie.end() && *oiter < iiter->first->hash) {
-				++oiter;
+			auto& node = theset.trie_flat[k];
+			if (node.terminal) {
+				if (unif_mode && !check_unif_tags(theset.number, &node)) {
+					continue;
+				}
+				retval = true;
+				break;
 			}
-			while (oiter != reading.tags_plain.end() && iiter != theset.trie.end() && iiter->first->hash < *oiter) {
-				++iiter;
+			if (node.count && doesSetMatchReading_flat(reading, theset, UI32(k), unif_mode)) {
+				retval = true;
+				break;
 			}
 		}
 	}
@@ -716,15 +857,15 @@ bool GrammarApplicator::doesSetMatchReading_tags(const Reading& reading, const S
  */
 bool GrammarApplicator::doesSetMatchReading(const Reading& reading, const uint32_t set, bool bypass_index, bool unif_mode) {
 	// Check whether we have previously seen that this set matches or doesn't match this reading.
-	// These indexes are cleared every ((num_windows+4)*2+1) windows to avoid memory ballooning.
+	// The cache is bounded and evicts the answers that are asked for least, so it is never cleared wholesale.
 	// Only 30% of tests get past this.
 	// ToDo: This is not good enough...while numeric tags are special, their failures can be indexed.
+	// Reading hashes collide often enough to matter over a long run, so the key also carries an unrelated hash of the tags
+	auto rsh = (UI64(hash_value(set, reading.hash_check)) << 32) | reading.hash;
 	if (!bypass_index && !unif_mode) {
-		if (index_readingSet_no[set].contains(reading.hash)) {
-			return false;
-		}
-		if (index_readingSet_yes[set].contains(reading.hash)) {
-			return true;
+		auto known = index_readingSet.find(rsh);
+		if (known != clock_cache::UNKNOWN) {
+			return known == 1;
 		}
 	}
 
@@ -834,11 +975,11 @@ bool GrammarApplicator::doesSetMatchReading(const Reading& reading, const uint32
 
 	// Store the result in the indexes in hopes that later runs can pull it directly from them.
 	if (retval) {
-		index_readingSet_yes[set].insert(reading.hash);
+		index_readingSet.insert(rsh, true);
 	}
 	else {
 		if (!(theset.type & ST_TAG_UNIFY) && !unif_mode) {
-			index_readingSet_no[set].insert(reading.hash);
+			index_readingSet.insert(rsh, false);
 		}
 	}
 
@@ -28,7 +28,7 @@
 namespace CG3 {
 
 Tag* GrammarApplicator::makeBaseFromWord(uint32_t tag) {
-	return makeBaseFromWord(grammar->single_tags.find(tag)->second);
+	return makeBaseFromWord(single_tags.find(tag)->second);
 }
 
 Tag* GrammarApplicator::makeBaseFromWord(Tag* tag) {
@@ -335,8 +335,6 @@ void GrammarApplicator::reflowReading(Reading& reading) {
 	reading.tags_plain.clear();
 	reading.tags_textual.clear();
 	reading.tags_numerical.clear();
-	reading.tags_bloom.clear();
-	reading.tags_textual_bloom.clear();
 	reading.tags_plain_bloom.clear();
 	reading.mapping = nullptr;
 	reading.tags_string.clear();
@@ -460,7 +458,7 @@ Tag* GrammarApplicator::generateVarstringTag(const Tag* tag) {
 }
 
 uint32_t GrammarApplicator::addTagToReading(Reading& reading, uint32_t utag, bool rehash) {
-	Tag* tag = grammar->single_tags.find(utag)->second;
+	Tag* tag = single_tags.find(utag)->second;
 	return addTagToReading(reading, tag, rehash);
 }
 
@@ -471,12 +469,13 @@ uint32_t GrammarApplicator::addTagToReading(Reading& reading, Tag* tag, bool reh
 
 	auto it = grammar->sets_by_tag.find(tag->hash);
 	if (it != grammar->sets_by_tag.end()) {
-		reading.parent->possible_sets.resize(std::max(reading.parent->possible_sets.size(), it->second.size()));
-		reading.parent->possible_sets |= it->second;
+		insert_ids(reading.parent->possible_sets, it->second, grammar->sets_list.size());
+		if (reading.parent->parent) {
+			insert_ids(reading.parent->parent->possible_sets, it->second, grammar->sets_list.size());
+		}
 	}
 	reading.tags.insert(tag->hash);
 	reading.tags_list.push_back(tag->hash);
-	reading.tags_bloom.insert(tag->hash);
 	// ToDo: Remove for real ordered mode
 	if (ordered) {
 		if (!reading.tags_string.empty()) {
@@ -492,8 +491,7 @@ uint32_t GrammarApplicator::addTagToReading(Reading& reading, Tag* tag, bool reh
 		reading.parent->is_pright = tag->hash;
 	}
 
-	if (tag->type & T_MAPPING || tag->tag[0] == grammar->mapping_prefix) {
-		tag->type |= T_MAPPING;
+	if (tag->type & T_MAPPING) {
 		if (reading.mapping && reading.mapping != tag) {
 			u_fprintf(ux_stderr, "Error: addTagToReading() cannot add a mapping tag to a reading which already is mapped!\n");
 			CG3Quit(1);
@@ -502,7 +500,6 @@ uint32_t GrammarApplicator::addTagToReading(Reading& reading, Tag* tag, bool reh
 	}
 	if (tag->type & (T_TEXTUAL | T_WORDFORM | T_BASEFORM)) {
 		reading.tags_textual.insert(tag->hash);
-		reading.tags_textual_bloom.insert(tag->hash);
 	}
 	if (tag->type & T_NUMERICAL) {
 		reading.tags_numerical[tag->hash] = tag;
@@ -519,7 +516,7 @@ uint32_t GrammarApplicator::addTagToReading(Reading& reading, Tag* tag, bool reh
 		}
 		has_dep = true;
 	}
-	if (grammar->has_relations && (tag->type & T_RELATION)) {
+	if (parse_relations && (tag->type & T_RELATION)) {
 		if (tag->dep_parent && tag->comparison_hash) {
 			reading.parent->relations_input[tag->comparison_hash].insert(tag->dep_parent);
 		}
@@ -541,11 +538,9 @@ uint32_t GrammarApplicator::addTagToReading(Reading& reading, Tag* tag, bool reh
 		Reading& bot = reading.parent->parent->bag_of_tags;
 		bot.tags.insert(tag->hash);
 		bot.tags_list.push_back(tag->hash);
-		bot.tags_bloom.insert(tag->hash);
 
 		if (tag->type & (T_TEXTUAL | T_WORDFORM | T_BASEFORM)) {
 			bot.tags_textual.insert(tag->hash);
-			bot.tags_textual_bloom.insert(tag->hash);
 		}
 		if (tag->type & T_NUMERICAL) {
 			bot.tags_numerical[tag->hash] = tag;
@@ -642,7 +637,7 @@ void GrammarApplicator::splitMappings(TagList& mappings, Cohort& cohort, Reading
 		nr->number = UI32(reading.number - i--);
 		uint32_t mp = addTagToReading(*nr, ttag);
 		if (mp != ttag->hash) {
-			nr->mapping = grammar->single_tags.find(mp)->second;
+			nr->mapping = single_tags.find(mp)->second;
 		}
 		else {
 			nr->mapping = ttag;
@@ -654,7 +649,7 @@ void GrammarApplicator::splitMappings(TagList& mappings, Cohort& cohort, Reading
 	reading.mapped = mapped;
 	uint32_t mp = addTagToReading(reading, tag);
 	if (mp != tag->hash) {
-		reading.mapping = grammar->single_tags.find(mp)->second;
+		reading.mapping = single_tags.find(mp)->second;
 	}
 	else {
 		reading.mapping = tag;
@@ -842,47 +837,46 @@ Cohort* GrammarApplicator::delimitAt(SingleWindow& current, Cohort* cohort) {
 	return cohort;
 }
 
-void GrammarApplicator::reflowTextuals_Reading(Reading& r) {
+void GrammarApplicator::reflowTextuals_Reading(Reading& r, const uint32SortedVector& textuals) {
 	if (r.next) {
-		reflowTextuals_Reading(*r.next);
+		reflowTextuals_Reading(*r.next, textuals);
 	}
-	for (auto it : r.tags) {
-		Tag* tag = grammar->single_tags.find(it)->second;
-		if (tag->type & T_TEXTUAL) {
+	for (auto it : textuals) {
+		if (r.tags.count(it)) {
 			r.tags_textual.insert(it);
-			r.tags_textual_bloom.insert(it);
 		}
 	}
 }
 
-void GrammarApplicator::reflowTextuals_Cohort(Cohort& c) {
+void GrammarApplicator::reflowTextuals_Cohort(Cohort& c, const uint32SortedVector& textuals) {
 	for (auto it : c.readings) {
-		reflowTextuals_Reading(*it);
+		reflowTextuals_Reading(*it, textuals);
 	}
 	for (auto it : c.deleted) {
-		reflowTextuals_Reading(*it);
+		reflowTextuals_Reading(*it, textuals);
 	}
 	for (auto it : c.ignored) {
-		reflowTextuals_Reading(*it);
+		reflowTextuals_Reading(*it, textuals);
 	}
 	for (auto it : c.delayed) {
-		reflowTextuals_Reading(*it);
+		reflowTextuals_Reading(*it, textuals);
 	}
 }
 
-void GrammarApplicator::reflowTextuals_SingleWindow(SingleWindow& sw) {
+void GrammarApplicator::reflowTextuals_SingleWindow(SingleWindow& sw, const uint32SortedVector& textuals) {
 	for (auto it : sw.all_cohorts) {
-		reflowTextuals_Cohort(*it);
+		reflowTextuals_Cohort(*it, textuals);
 	}
 }
 
-void GrammarApplicator::reflowTextuals() {
+// Adds tags that just became textual to the tags_textual of the readings that have them
+void GrammarApplicator::reflowTextuals(const uint32SortedVector& textuals) {
 	for (auto swit : gWindow->previous) {
-		reflowTextuals_SingleWindow(*swit);
+		reflowTextuals_SingleWindow(*swit, textuals);
 	}
-	reflowTextuals_SingleWindow(*gWindow->current);
+	reflowTextuals_SingleWindow(*gWindow->current, textuals);
 	for (auto swit : gWindow->next) {
-		reflowTextuals_SingleWindow(*swit);
+		reflowTextuals_SingleWindow(*swit, textuals);
 	}
 }
 }
@@ -223,7 +223,7 @@ bool GrammarApplicator::posOutputHelper(const SingleWindow* sWindow, size_t posi
 	return good;
 }
 
-Cohort* GrammarApplicator::runContextualTest_tmpl(SingleWindow* sWindow, size_t position, const ContextualTest* test, ContextualTest* tmpl, Cohort*& cdeep, Cohort* origin) {
+Cohort* GrammarApplicator::runContextualTest_tmpl(SingleWindow* sWindow, size_t position, const ContextualTest* test, const ContextualTest* tmpl, Cohort*& cdeep, Cohort* origin) {
 	Cohort* min = tmpl_cntx.min;
 	Cohort* max = tmpl_cntx.max;
 	bool in_template = tmpl_cntx.in_template;
@@ -232,30 +232,30 @@ Cohort* GrammarApplicator::runContextualTest_tmpl(SingleWindow* sWindow, size_t
 		tmpl_cntx.linked.push_back(test->linked);
 	}
 
-	uint64_t orgpos = tmpl->pos;
-	int32_t orgoffset = tmpl->offset;
-	uint32_t orgcbar = tmpl->cbarrier;
-	uint32_t orgbar = tmpl->barrier;
 	if (test->pos & POS_TMPL_OVERRIDE) {
-		tmpl->pos = test->pos;
-		tmpl->pos &= ~(POS_NEGATE | POS_NOT | POS_JUMP);
-		tmpl->offset = test->offset;
-		if (test->offset != 0 && !(test->pos & (POS_SCANFIRST | POS_SCANALL | POS_ABSOLUTE))) {
-			tmpl->pos |= POS_SCANALL;
-		}
-		if (test->cbarrier) {
-			tmpl->cbarrier = test->cbarrier;
-		}
-		if (test->barrier) {
-			tmpl->barrier = test->barrier;
+		auto it = tmpl_overrides.find(std::make_pair(test, tmpl));
+		if (it == tmpl_overrides.end()) {
+			ContextualTest over;
+			copy_cntx(tmpl, &over);
+			over.ors = tmpl->ors;
+			over.pos = test->pos;
+			over.pos &= ~(POS_NEGATE | POS_NOT | POS_JUMP);
+			over.offset = test->offset;
+			if (test->offset != 0 && !(test->pos & (POS_SCANFIRST | POS_SCANALL | POS_ABSOLUTE))) {
+				over.pos |= POS_SCANALL;
+			}
+			if (test->cbarrier) {
+				over.cbarrier = test->cbarrier;
+			}
+			if (test->barrier) {
+				over.barrier = test->barrier;
+			}
+			it = tmpl_overrides.emplace(std::make_pair(test, tmpl), std::move(over)).first;
 		}
+		tmpl = &it->second;
 	}
 	Cohort* cohort = runContextualTest(sWindow, position, tmpl, &cdeep, origin);
 	if (test->pos & POS_TMPL_OVERRIDE) {
-		tmpl->pos = orgpos;
-		tmpl->offset = orgoffset;
-		tmpl->cbarrier = orgcbar;
-		tmpl->barrier = orgbar;
 		if (cohort && cdeep && test->offset != 0 && !posOutputHelper(sWindow, position, test, cohort, cdeep)) {
 			cohort = nullptr;
 		}
@@ -378,13 +378,13 @@ Cohort* GrammarApplicator::runContextualTest(SingleWindow* sWindow, size_t posit
 
 		CohortIterator* it = nullptr;
 		if ((test->pos & POS_DEP_PARENT) && (test->pos & POS_DEP_GLOB)) {
-			it = &depAncestorIters[ci_depths[5]++];
+			it = &nextIterator(depAncestorIters, ci_depths[5]);
 		}
 		else if (test->pos & POS_DEP_PARENT) {
-			it = &depParentIters[ci_depths[3]++];
+			it = &nextIterator(depParentIters, ci_depths[3]);
 		}
 		else if (test->pos & POS_DEP_GLOB) {
-			it = &depDescendentIters[ci_depths[4]++];
+			it = &nextIterator(depDescendentIters, ci_depths[4]);
 		}
 		else if (test->pos & (POS_DEP_CHILD | POS_DEP_SIBLING)) {
 			Cohort* nc = runDependencyTest(sWindow, cohort, test, deep, origin, 0);
@@ -527,13 +527,13 @@ Cohort* GrammarApplicator::runContextualTest(SingleWindow* sWindow, size_t posit
 			}
 		}
 		else if (test->offset < 0) {
-			it = &topologyLeftIters[ci_depths[1]++];
+			it = &nextIterator(topologyLeftIters, ci_depths[1]);
 		}
 		else if (test->offset > 0) {
-			it = &topologyRightIters[ci_depths[2]++];
+			it = &nextIterator(topologyRightIters, ci_depths[2]);
 		}
 		else {
-			it = &cohortIterators[ci_depths[0]++];
+			it = &nextIterator(cohortIterators, ci_depths[0]);
 		}
 
 		if (it) {
@@ -810,7 +810,7 @@ Cohort* GrammarApplicator::runRelationTest(SingleWindow* sWindow, Cohort* curren
 	CohortSet rels;
 	uint8_t regexgrpz = context_stack.back().regexgrp_ct;
 
-	auto rtag = grammar->single_tags[test->relation];
+	auto rtag = single_tags[test->relation];
 	while (rtag->type & T_VARSTRING) {
 		rtag = generateVarstringTag(rtag);
 	}
@@ -827,7 +827,7 @@ Cohort* GrammarApplicator::runRelationTest(SingleWindow* sWindow, Cohort* curren
 	}
 	else if (rtag->type & T_REGEXP) {
 		UErrorCode status = U_ZERO_ERROR;
-		auto caps = uregex_groupCount(rtag->regexp, &status);
+		auto caps = uregex_groupCount(getRegexp(*rtag), &status);
 		for (const auto& riter : current->relations) {
 			for (auto citer : riter.second) {
 				auto it = sWindow->parent->cohort_map.find(citer);
@@ -900,4 +900,81 @@ Cohort* GrammarApplicator::runRelationTest(SingleWindow* sWindow, Cohort* curren
 	}
 	return rv;
 }
+
+bool GrammarApplicator::isSetMemoable(uint32_t set) {
+	if (set_memoable[set]) {
+		return (set_memoable[set] == 1);
+	}
+	set_memoable[set] = 1;
+
+	const Set& theset = *grammar->sets_list[set];
+	bool ok = !(theset.type & MASK_ST_UNIFY);
+	for (auto s : theset.sets) {
+		if (!ok) {
+			break;
+		}
+		ok = isSetMemoable(s);
+	}
+	if (ok) {
+		TagList tags;
+		trie_getTagList(theset.trie_flat, grammar->single_tags, tags);
+		trie_getTagList(theset.trie_special, tags);
+		for (auto tag : tags) {
+			// These either depend on the rule being run, or capture something the rule may use later
+			if (tag->type & (T_TARGET | T_MARK | T_ATTACHTO | T_SAME_BASIC | T_CONTEXT | T_VARIABLE | T_LOCAL_VARIABLE | T_VARSTRING | T_SET)) {
+				ok = false;
+				break;
+			}
+			if (tag->hasRegexp()) {
+				UErrorCode status = U_ZERO_ERROR;
+				if (uregex_groupCount(getRegexp(*tag), &status) > 0) {
+					ok = false;
+					break;
+				}
+			}
+		}
+	}
+
+	set_memoable[set] = ok ? 1 : 2;
+	return ok;
+}
+
+/**
+ * Whether a contextual test's result only depends on the contents of the window, so that it can be shared between rules.
+ * Tests that jump, set the mark, attach, or merge, and tests whose sets refer to the rule's state or capture anything, can not.
+ */
+bool GrammarApplicator::isContextMemoable(const ContextualTest* test) {
+	auto it = context_memoable.find(test->hash);
+	if (it != context_memoable.end()) {
+		return (it->second == 1);
+	}
+	// A template may refer back to itself, which doesn't make it any less memoable
+	context_memoable[test->hash] = 1;
+
+	bool ok = !(test->pos & (POS_JUMP | POS_MARK_SET | POS_ATTACH_TO | POS_WITH | POS_ACTIVE | POS_INACTIVE | POS_UNKNOWN));
+	if (ok && test->target) {
+		ok = isSetMemoable(test->target);
+	}
+	if (ok && test->barrier) {
+		ok = isSetMemoable(test->barrier);
+	}
+	if (ok && test->cbarrier) {
+		ok = isSetMemoable(test->cbarrier);
+	}
+	if (ok && test->tmpl) {
+		ok = isContextMemoable(test->tmpl);
+	}
+	for (auto o : test->ors) {
+		if (!ok) {
+			break;
+		}
+		ok = isContextMemoable(o);
+	}
+	if (ok && test->linked) {
+		ok = isContextMemoable(test->linked);
+	}
+
+	context_memoable[test->hash] = ok ? 1 : 2;
+	return ok;
+}
 }
@@ -114,6 +114,8 @@ void GrammarApplicator::runGrammarOnText(std::istream& input, std::ostream& outp
 		}
 	}
 
+	input_eof = false;
+
 	UString line(1024, 0);
 	UString cleaned(line.size() + 1, 0);
 	bool ignoreinput = false;
@@ -144,6 +146,7 @@ void GrammarApplicator::runGrammarOnText(std::istream& input, std::ostream& outp
 	all_mappings_t all_mappings;
 
 	ux_stripBOM(input);
+	UStreamReader reader(input);
 
 	auto adopt_variables = [&]() {
 		cSWindow->variables_set.insert(variables_set.begin(), variables_set.end());
@@ -165,7 +168,7 @@ void GrammarApplicator::runGrammarOnText(std::istream& input, std::ostream& outp
 
 	while (!input.eof()) {
 		++lines;
-		auto packoff = get_line_clean(line, cleaned, input);
+		auto packoff = get_line_clean(line, cleaned, reader);
 
 		// Trim trailing whitespace
 		while (cleaned[0] && ISSPACE(cleaned[packoff - 1])) {
@@ -265,11 +268,11 @@ void GrammarApplicator::runGrammarOnText(std::istream& input, std::ostream& outp
 				splitAllMappings(all_mappings, *cCohort, true);
 				cSWindow->appendCohort(cCohort);
 			}
-			if (gWindow->next.size() > num_windows + 1) {
+			if (gWindow->next.size() > windows_ahead + 1) {
 				gWindow->shuffleWindowsDown();
 				runGrammarOnWindow();
 				if (numWindows % resetAfter == 0) {
-					resetIndexes();
+					reclaimTags();
 				}
 				if (verbosity_level > 0) {
 					u_fprintf(ux_stderr, "Progress: L:%u, W:%u, C:%u, R:%u\r", lines, numWindows, numCohorts, numReadings);
@@ -376,8 +379,7 @@ void GrammarApplicator::runGrammarOnText(std::istream& input, std::ostream& outp
 				++space;
 				if (base && base[0]) {
 					Tag* tag = addTag(base);
-					if (tag->type & T_MAPPING || tag->tag[0] == grammar->mapping_prefix) {
-						tag->type |= T_MAPPING;
+					if (tag->type & T_MAPPING) {
 						all_mappings[cReading].push_back(tag);
 					}
 					else {
@@ -392,8 +394,7 @@ void GrammarApplicator::runGrammarOnText(std::istream& input, std::ostream& outp
 			}
 			if (base && base[0]) {
 				Tag* tag = addTag(base);
-				if (tag->type & T_MAPPING || tag->tag[0] == grammar->mapping_prefix) {
-					tag->type |= T_MAPPING;
+				if (tag->type & T_MAPPING) {
 					all_mappings[cReading].push_back(tag);
 				}
 				else {
@@ -500,7 +501,7 @@ void GrammarApplicator::runGrammarOnText(std::istream& input, std::ostream& outp
 						gWindow->shuffleWindowsDown();
 						runGrammarOnWindow();
 						if (numWindows % resetAfter == 0) {
-							resetIndexes();
+							reclaimTags();
 						}
 						if (verbosity_level > 0) {
 							u_fprintf(ux_stderr, "Progress: L:%u, W:%u, C:%u, R:%u\r", lines, numWindows, numCohorts, numReadings);
@@ -510,7 +511,7 @@ void GrammarApplicator::runGrammarOnText(std::istream& input, std::ostream& outp
 					gWindow->shuffleWindowsDown();
 					while (!gWindow->previous.empty()) {
 						SingleWindow* tmp = gWindow->previous.front();
-						printSingleWindow(tmp, output);
+						outputSingleWindow(tmp, output);
 						free_swindow(tmp);
 						gWindow->previous.erase(gWindow->previous.begin());
 					}
@@ -726,7 +727,7 @@ void GrammarApplicator::runGrammarOnText(std::istream& input, std::ostream& outp
 	gWindow->shuffleWindowsDown();
 	while (!gWindow->previous.empty()) {
 		SingleWindow* tmp = gWindow->previous.front();
-		printSingleWindow(tmp, output);
+		outputSingleWindow(tmp, output);
 		free_swindow(tmp);
 		gWindow->previous.erase(gWindow->previous.begin());
 	}
@@ -734,12 +735,12 @@ void GrammarApplicator::runGrammarOnText(std::istream& input, std::ostream& outp
 	u_fflush(output);
 
 	for (auto var : variables_output) {
-		Tag* key = grammar->single_tags[var];
+		Tag* key = single_tags[var];
 		auto iter = variables_set.find(var);
 		UString cmd_buf;
 		if (iter != variables_set.end()) {
 			if (iter->second != grammar->tag_any) {
-				Tag* value = grammar->single_tags[iter->second];
+				Tag* value = single_tags[iter->second];
 				cmd_buf.append(STR_CMD_SETVAR).append(key->tag).append(u"=").append(value->tag).append(u">");
 			}
 			else {
@@ -126,12 +126,15 @@ void GrammarApplicator::indexSingleWindow(SingleWindow& current) {
 		cs.clear();
 	}
 
+	current.possible_sets.clear();
+	insert_if_exists(current.possible_sets, grammar->sets_any);
+	for (auto c : current.all_cohorts) {
+		insert_if_exists(current.possible_sets, &c->possible_sets);
+	}
+
 	for (auto c : current.cohorts) {
-		for (uint32_t psit = 0; psit < c->possible_sets.size(); ++psit) {
-			if (c->possible_sets.test(psit) == false) {
-				continue;
-			}
-			auto rules_it = grammar->rules_by_set.find(psit);
+		for (auto psit = c->possible_sets.find_first(); psit != boost::dynamic_bitset<>::npos; psit = c->possible_sets.find_next(psit)) {
+			auto rules_it = grammar->rules_by_set.find(UI32(psit));
 			if (rules_it == grammar->rules_by_set.end()) {
 				continue;
 			}
@@ -172,12 +175,12 @@ void GrammarApplicator::getTagList(const Set& theSet, TagList& theTags, bool uni
 		auto unif_tags = context_stack.back().unif_tags;
 		auto iter = unif_tags->find(theSet.number);
 		if (iter != unif_tags->end()) {
-			trie_getTagList(theSet.trie, theTags, iter->second);
+			trie_getTagList(theSet.trie_flat, grammar->single_tags, theTags, iter->second);
 			trie_getTagList(theSet.trie_special, theTags, iter->second);
 		}
 	}
 	else {
-		trie_getTagList(theSet.trie, theTags);
+		trie_getTagList(theSet.trie_flat, grammar->single_tags, theTags);
 		trie_getTagList(theSet.trie_special, theTags);
 	}
 	// Eliminate consecutive duplicates. Not all duplicates, since AddCohort and Append may have multiple readings with repeated tags
@@ -216,7 +219,6 @@ Reading* GrammarApplicator::get_sub_reading(Reading* tr, int sub_reading) {
 			reading->tags_list.insert(reading->tags_list.end(), tr->tags_list.begin(), tr->tags_list.end());
 			for (auto tag : tr->tags) {
 				reading->tags.insert(tag);
-				reading->tags_bloom.insert(tag);
 			}
 			for (auto tag : tr->tags_plain) {
 				reading->tags_plain.insert(tag);
@@ -224,7 +226,6 @@ Reading* GrammarApplicator::get_sub_reading(Reading* tr, int sub_reading) {
 			}
 			for (auto tag : tr->tags_textual) {
 				reading->tags_textual.insert(tag);
-				reading->tags_textual_bloom.insert(tag);
 			}
 			reading->tags_numerical.insert(tr->tags_numerical.begin(), tr->tags_numerical.end());
 			if (tr->mapped) {
@@ -287,7 +288,7 @@ Reading* GrammarApplicator::get_sub_reading(Reading* tr, int sub_reading) {
 					}                                                               \
 					auto stag = doesTagMatchReading(reading, *tt, false, true);     \
 					if (stag) {                                                     \
-						(taglist)->insert(it, grammar->single_tags.find(stag)->second); \
+						(taglist)->insert(it, single_tags.find(stag)->second); \
 					}                                                               \
 				}                                                                   \
 				continue;                                                           \
@@ -306,7 +307,7 @@ Reading* GrammarApplicator::get_sub_reading(Reading* tr, int sub_reading) {
 				}                                                               	\
 				auto stag = doesTagMatchReading(reading, *tt, false, true);     	\
 				if (stag) {                                                     	\
-					tt = grammar->single_tags.find(stag)->second;               	\
+					tt = single_tags.find(stag)->second;               	\
 				}                                                               	\
 			}                                                                   	\
 		}                                                                       	\
@@ -666,7 +667,8 @@ bool GrammarApplicator::runSingleRule(SingleWindow& current, const Rule& rule, R
 				// If we didn't already run the contextual tests, run them now.
 				if (!did_test) {
 					context_stack.back().context.clear();
-					foreach (it, rule.tests) {
+					auto& tests = rule_tests[rule.number];
+					foreach (it, tests) {
 						ContextualTest* test = *it;
 						if (rule.flags & RF_RESETX || !(rule.flags & RF_REMEMBERX)) {
 							set_mark(cohort);
@@ -678,6 +680,7 @@ bool GrammarApplicator::runSingleRule(SingleWindow& current, const Rule& rule, R
 						std::fill(ci_depths.begin(), ci_depths.end(), UI32(0));
 						tmpl_cntx.clear();
 						// Run the contextual test...
+						auto test_start = profiler ? Profiler::clock::now() : Profiler::clock::time_point();
 						Cohort* next_test = nullptr;
 						Cohort* result = nullptr;
 						Cohort** deep = nullptr;
@@ -685,22 +688,40 @@ bool GrammarApplicator::runSingleRule(SingleWindow& current, const Rule& rule, R
 							deep = &result;
 							merge_with = nullptr;
 						}
-						if (!(test->pos & POS_PASS_ORIGIN) && (no_pass_origin || (test->pos & POS_NO_PASS_ORIGIN))) {
-							next_test = runContextualTest(&current, c, test, deep, cohort);
+						auto run_test = [&]() {
+							if (!(test->pos & POS_PASS_ORIGIN) && (no_pass_origin || (test->pos & POS_NO_PASS_ORIGIN))) {
+								return runContextualTest(&current, c, test, deep, cohort);
+							}
+							return runContextualTest(&current, c, test, deep);
+						};
+						if (!deep && isContextMemoable(test)) {
+							// The table spreads keys by their low bits, and the cohort number alone would put every test for a cohort on one probe chain
+							auto ck = (UI64(c) << 32) | test->hash;
+							auto& cc = index_contextCohort[ck];
+							if (cc.first == context_generation) {
+								next_test = cc.second;
+								++numContextHits;
+							}
+							else {
+								next_test = run_test();
+								// The test may have grown the table, so cc can't be trusted anymore
+								index_contextCohort[ck] = std::make_pair(context_generation, next_test);
+								++numContextMisses;
+							}
 						}
 						else {
-							next_test = runContextualTest(&current, c, test, deep);
+							next_test = run_test();
 						}
 						context_stack.back().context.push_back(merge_with ? merge_with : result);
 						test_good = (next_test != nullptr);
 
-						profileRuleContext(test_good, &rule, test);
+						profileRuleContext(test_good, &rule, test, test_start);
 
 						if (!test_good) {
 							good = test_good;
-							if (it != rule.tests.begin() && !(rule.flags & RF_KEEPORDER)) {
-								rule.tests.erase(it);
-								rule.tests.push_front(test);
+							if (it != tests.begin() && !(rule.flags & RF_KEEPORDER)) {
+								tests.erase(it);
+								tests.push_front(test);
 							}
 							break;
 						}
@@ -732,7 +753,7 @@ bool GrammarApplicator::runSingleRule(SingleWindow& current, const Rule& rule, R
 						Profiler::Key k{ET_RULE, rule.number + 1 };
 						auto& r = profiler->entries[k];
 						++r.num_match;
-						if (!r.example_window) {
+						if (!r.example_window && profiler->examples) {
 							addProfilingExample(r);
 						}
 					}
@@ -877,6 +898,7 @@ uint32_t GrammarApplicator::runRulesOnSingleWindow(SingleWindow& current, const
 	uint32IntervalVector intersects = current.valid_rules.intersect(rules);
 	ReadingList removed;
 	ReadingList selected;
+	uint32_t rules_skipped = 0;
 
 	if (debug_level > 1) {
 		std::cerr << "DEBUG: Trying window " << current.number << std::endl;
@@ -936,6 +958,21 @@ uint32_t GrammarApplicator::runRulesOnSingleWindow(SingleWindow& current, const
 				continue;
 			}
 		}
+		// Profiling wants every rule to be tried, so that contexts get their counts
+		if (!always_span && !profiler && !rule->required_sets.empty()) {
+			bool possible = true;
+			for (auto s : rule->required_sets) {
+				if (s >= current.possible_sets.size() || !current.possible_sets.test(s)) {
+					possible = false;
+					break;
+				}
+			}
+			if (!possible) {
+				++numRulesSkipped;
+				++rules_skipped;
+				continue;
+			}
+		}
 
 		bool readings_changed = false;
 		bool should_repeat = false;
@@ -1029,12 +1066,12 @@ uint32_t GrammarApplicator::runRulesOnSingleWindow(SingleWindow& current, const
 							continue;
 						}
 						tags.reserve(tags.size() + nt.size() - 2);
-						tags[i] = grammar->single_tags[nt[2]];
+						tags[i] = single_tags[nt[2]];
 						for (size_t j = 3, k = 1; j < nt.size(); ++j) {
-							if (grammar->single_tags[nt[j]]->type & T_DEPENDENCY) {
+							if (single_tags[nt[j]]->type & T_DEPENDENCY) {
 								continue;
 							}
-							tags.insert(tags.begin() + i + k, grammar->single_tags[nt[j]]);
+							tags.insert(tags.begin() + i + k, single_tags[nt[j]]);
 							++k;
 						}
 					}
@@ -1113,7 +1150,10 @@ uint32_t GrammarApplicator::runRulesOnSingleWindow(SingleWindow& current, const
 					}
 				}
 				else {
-					attachParentChild(*current.parent->cohort_map[c->dep_parent], *cCohort);
+					auto it = current.parent->cohort_map.find(c->dep_parent);
+					if (it != current.parent->cohort_map.end()) {
+						attachParentChild(*it->second, *cCohort);
+					}
 				}
 
 				std::set<uint32_t> ps;
@@ -1188,11 +1228,10 @@ uint32_t GrammarApplicator::runRulesOnSingleWindow(SingleWindow& current, const
 			// ToDo: Named relations must be erased
 			while (!cohort->dep_children.empty()) {
 				uint32_t ch = cohort->dep_children.back();
-				if (cohort->dep_parent == DEP_NO_PARENT) {
-					attachParentChild(*gWindow->cohort_map[0], *gWindow->cohort_map[ch], true, true);
-				}
-				else {
-					attachParentChild(*gWindow->cohort_map[cohort->dep_parent], *gWindow->cohort_map[ch], true, true);
+				auto cit = gWindow->cohort_map.find(ch);
+				auto pit = gWindow->cohort_map.find((cohort->dep_parent == DEP_NO_PARENT) ? 0 : cohort->dep_parent);
+				if (cit != gWindow->cohort_map.end() && pit != gWindow->cohort_map.end()) {
+					attachParentChild(*pit->second, *cit->second, true, true);
 				}
 				cohort->dep_children.erase(ch);
 			}
@@ -1285,7 +1324,7 @@ uint32_t GrammarApplicator::runRulesOnSingleWindow(SingleWindow& current, const
 			auto nt = make_relation_rtag(tag, id);
 			for (auto& r : cohort->readings) {
 				for (auto it = r->tags_list.begin(); it != r->tags_list.end();) {
-					const auto& utag = grammar->single_tags[*it]->tag;
+					const auto& utag = single_tags[*it]->tag;
 					if (utag[0] == 'R' && utag[1] == ':' && utag.size() > 2 + tag->tag.size() && utag[2 + tag->tag.size()] == ':' && utag.compare(2, tag->tag.size(), tag->tag) == 0) {
 						r->tags.erase(*it);
 						r->tags_textual.erase(*it);
@@ -1331,7 +1370,9 @@ uint32_t GrammarApplicator::runRulesOnSingleWindow(SingleWindow& current, const
 			reflowReading(reading);
 		};
 
+		// Whatever a callback does may change the outcome of any contextual test
 		auto cohort_cb = [&]() {
+			clearContextCohort();
 			if (rule->type == K_SELECT || (rule->type == K_IFF && !selected.empty())) {
 				Cohort* target = get_apply_to().cohort;
 				if (selected.size() < target->readings.size() && !selected.empty()) {
@@ -1463,13 +1504,16 @@ uint32_t GrammarApplicator::runRulesOnSingleWindow(SingleWindow& current, const
 
 				auto ei = externals.find(rule->varname);
 				if (ei == externals.end()) {
-					Tag* ext = grammar->single_tags.find(rule->varname)->second;
+					Tag* ext = single_tags.find(rule->varname)->second;
+					std::string cmd(ext->tag.size() * 4, 0);
+					int32_t olen = 0;
 					UErrorCode err = U_ZERO_ERROR;
-					u_strToUTF8(&cbuffers[0][0], SI32(CG3_BUFFER_SIZE - 1), nullptr, ext->tag.data(), SI32(ext->tag.size()), &err);
+					u_strToUTF8(&cmd[0], SI32(cmd.size()), &olen, ext->tag.data(), SI32(ext->tag.size()), &err);
+					cmd.resize(olen);
 
 					Process& es = externals[rule->varname];
 					try {
-						es.start(&cbuffers[0][0]);
+						es.start(cmd);
 						writeRaw(es, CG3_EXTERNAL_PROTOCOL);
 					}
 					catch (std::exception& e) {
@@ -1522,6 +1566,7 @@ uint32_t GrammarApplicator::runRulesOnSingleWindow(SingleWindow& current, const
 		};
 
 		RuleCallback reading_cb = [&]() {
+			clearContextCohort();
 			if (rule->type == K_SELECT || (rule->type == K_IFF && get_apply_to().subreading->matched_tests)) {
 				selected.push_back(get_apply_to().reading);
 				index_ruleCohort_no.clear();
@@ -1689,12 +1734,12 @@ uint32_t GrammarApplicator::runRulesOnSingleWindow(SingleWindow& current, const
 									continue;
 								}
 								tags.reserve(tags.size() + nt.size() - 2);
-								tags[i] = grammar->single_tags[nt[2]];
+								tags[i] = single_tags[nt[2]];
 								for (size_t j = 3, k = 1; j < nt.size(); ++j) {
-									if (grammar->single_tags[nt[j]]->type & T_DEPENDENCY) {
+									if (single_tags[nt[j]]->type & T_DEPENDENCY) {
 										continue;
 									}
-									tags.insert(tags.begin() + i + k, grammar->single_tags[nt[j]]);
+									tags.insert(tags.begin() + i + k, single_tags[nt[j]]);
 									++k;
 								}
 							}
@@ -1740,14 +1785,18 @@ uint32_t GrammarApplicator::runRulesOnSingleWindow(SingleWindow& current, const
 					if (cohort_dep[i].first == DEP_NO_PARENT) {
 						while (!get_apply_to().cohort->dep_children.empty()) {
 							uint32_t ch = get_apply_to().cohort->dep_children.back();
-							attachParentChild(*cCohort, *current.parent->cohort_map[ch], true, true);
+							auto it = current.parent->cohort_map.find(ch);
+							if (it != current.parent->cohort_map.end()) {
+								attachParentChild(*cCohort, *it->second, true, true);
+							}
 							get_apply_to().cohort->dep_children.erase(ch); // Just in case the attachment can't be made for some reason
 						}
 					}
 
 					if (cohort_dep[i].second == DEP_NO_PARENT) {
-						if (current.parent->cohort_map.count(get_apply_to().cohort->dep_parent)) {
-							attachParentChild(*current.parent->cohort_map[get_apply_to().cohort->dep_parent], *cCohort, true, true);
+						auto it = current.parent->cohort_map.find(get_apply_to().cohort->dep_parent);
+						if (it != current.parent->cohort_map.end()) {
+							attachParentChild(*it->second, *cCohort, true, true);
 						}
 					}
 					else {
@@ -2359,7 +2408,7 @@ uint32_t GrammarApplicator::runRulesOnSingleWindow(SingleWindow& current, const
 							cReading->noprint = false;
 							TagList mappings;
 							for (auto hash : r->tags_list) {
-								auto tter = grammar->single_tags[hash];
+								auto tter = single_tags[hash];
 								if (tter->type & T_MAPPING || tter->tag[0] == grammar->mapping_prefix) {
 									mappings.push_back(tter);
 								}
@@ -2574,7 +2623,9 @@ uint32_t GrammarApplicator::runRulesOnSingleWindow(SingleWindow& current, const
 					}
 					return true;
 				};
-				int32_t orgoffset = rule->dep_target->offset;
+				// Onward searches step from the last attachment point, which takes a copy of the test with its offset cut to +/- 1
+				const ContextualTest* dep_target = rule->dep_target;
+				ContextualTest dep_onward;
 				auto seen_targets = ss_u32sv.get();
 
 				ReadingSpec orgtarget = context_stack.back().target;
@@ -2593,8 +2644,8 @@ uint32_t GrammarApplicator::runRulesOnSingleWindow(SingleWindow& current, const
 					context_stack.back().attach_to.reading = nullptr;
 					context_stack.back().attach_to.subreading = nullptr;
 					seen_barrier = false;
-					if (runContextualTest(target->parent, target->local_number, rule->dep_target, &attach) && attach) {
-						profileRuleContext(true, rule, rule->dep_target);
+					if (runContextualTest(target->parent, target->local_number, dep_target, &attach) && attach) {
+						profileRuleContext(true, rule, dep_target);
 
 						bool break_after = seen_barrier || (rule->flags & RF_NEAREST);
 						if (get_attach_to().cohort) {
@@ -2642,16 +2693,17 @@ uint32_t GrammarApplicator::runRulesOnSingleWindow(SingleWindow& current, const
 						context_stack.back().target = context_stack.back().attach_to;
 						context_stack.back().unif_tags->swap(utags);
 						context_stack.back().unif_sets->swap(usets);
-						if (rule->dep_target->offset != 0) {
-							// Temporarily set offset to +/- 1
-							rule->dep_target->offset = ((rule->dep_target->offset < 0) ? -1 : 1);
+						if (dep_target->offset != 0 && dep_target != &dep_onward) {
+							copy_cntx(dep_target, &dep_onward);
+							dep_onward.ors = dep_target->ors;
+							dep_onward.offset = ((dep_target->offset < 0) ? -1 : 1);
+							dep_target = &dep_onward;
 						}
 					}
 					else {
 						break;
 					}
 				}
-				rule->dep_target->offset = orgoffset;
 				finish_reading_loop = false;
 			}
 			else if (rule->type == K_REMPARENT) {
@@ -2667,30 +2719,34 @@ uint32_t GrammarApplicator::runRulesOnSingleWindow(SingleWindow& current, const
 
 				// collect cohorts
 				Cohort* child = get_apply_to().cohort;
-				Cohort* parent = current.parent->cohort_map[child->dep_parent];
-				auto grandparent_number = parent->dep_parent;
-				CohortSet siblings;
-				for (auto iter : current.cohorts) {
-					if (iter->dep_parent == parent->global_number && doesSetMatchCohortNormal(*iter, rule->childset1)) {
-						siblings.insert(iter);
+				auto pit = current.parent->cohort_map.find(child->dep_parent);
+				// A cohort whose parent is out of reach has nothing to switch places with
+				if (pit != current.parent->cohort_map.end()) {
+					Cohort* parent = pit->second;
+					auto grandparent_number = parent->dep_parent;
+					CohortSet siblings;
+					for (auto iter : current.cohorts) {
+						if (iter->dep_parent == parent->global_number && doesSetMatchCohortNormal(*iter, rule->childset1)) {
+							siblings.insert(iter);
+						}
 					}
-				}
 
-				// clear dependencies
-				child->dep_parent = DEP_NO_PARENT;
-				parent->dep_parent = DEP_NO_PARENT;
-				for (auto s : siblings) {
-					s->dep_parent = DEP_NO_PARENT;
-				}
+					// clear dependencies
+					child->dep_parent = DEP_NO_PARENT;
+					parent->dep_parent = DEP_NO_PARENT;
+					for (auto s : siblings) {
+						s->dep_parent = DEP_NO_PARENT;
+					}
 
-				// reattach
-				auto it = current.parent->cohort_map.find(grandparent_number);
-				if (it != current.parent->cohort_map.end()) {
-					attachParentChild(*(it->second), *child);
-				}
-				attachParentChild(*child, *parent);
-				for (auto s : siblings) {
-					attachParentChild(*child, *s);
+					// reattach
+					auto it = current.parent->cohort_map.find(grandparent_number);
+					if (it != current.parent->cohort_map.end()) {
+						attachParentChild(*(it->second), *child);
+					}
+					attachParentChild(*child, *parent);
+					for (auto s : siblings) {
+						attachParentChild(*child, *s);
+					}
 				}
 			}
 			else if (rule->type == K_MOVE_AFTER || rule->type == K_MOVE_BEFORE || rule->type == K_SWITCH) {
@@ -2872,7 +2928,11 @@ uint32_t GrammarApplicator::runRulesOnSingleWindow(SingleWindow& current, const
 					bool result = false;
 					do {
 						readings_changed = false;
+						auto rule_start = profiler ? Profiler::clock::now() : Profiler::clock::time_point();
 						result = runSingleRule(current, *rule, reading_cb, cohort_cb);
+						if (profiler) {
+							profileRuleTime(*rule, rule_start);
+						}
 						any_readings_changed = any_readings_changed || result || readings_changed;
 					} while ((result || readings_changed) && (rule->flags & RF_REPEAT) != 0) ;
 					current_rule = cur_was;
@@ -2889,7 +2949,11 @@ uint32_t GrammarApplicator::runRulesOnSingleWindow(SingleWindow& current, const
 
 		removed.resize(0);
 		selected.resize(0);
+		auto rule_start = profiler ? Profiler::clock::now() : Profiler::clock::time_point();
 		bool rv = runSingleRule(current, *rule, reading_cb, cohort_cb);
+		if (profiler) {
+			profileRuleTime(*rule, rule_start);
+		}
 		if (rv || readings_changed) {
 			if (!(rule->flags & RF_NOITERATE) && section_max_count != 1) {
 				section_did_something = true;
@@ -2935,6 +2999,10 @@ uint32_t GrammarApplicator::runRulesOnSingleWindow(SingleWindow& current, const
 	if (delimited) {
 		retval |= RV_DELIMITED;
 	}
+	if (verbosity_level > 1 && rules_skipped) {
+		u_fprintf(ux_stderr, "Info: Skipped %u rules in window %u, which lacks sets their contexts need.\n", rules_skipped, current.number);
+		u_fflush(ux_stderr);
+	}
 	return retval;
 }
 
@@ -2998,6 +3066,12 @@ void GrammarApplicator::runGrammarOnWindow() {
 	SingleWindow* current = gWindow->current;
 	did_final_enclosure = false;
 
+	if (sample_profiler) {
+		sample_profiler->checkpoint();
+		profiler = (profile_countdown == 0) ? sample_profiler : nullptr;
+		profile_countdown = (profile_countdown + 1) % profile_sample;
+	}
+
 	for (const auto& vit : current->variables_set) {
 		variables[vit.first] = vit.second;
 	}
@@ -3075,15 +3149,16 @@ void GrammarApplicator::runGrammarOnWindow() {
 	uint32_t pass = 0;
 
 label_runGrammarOnWindow_begin:
-	while (!gWindow->previous.empty() && gWindow->previous.size() > num_windows) {
+	while (!gWindow->previous.empty() && gWindow->previous.size() > windows_behind) {
 		SingleWindow* tmp = gWindow->previous.front();
-		printSingleWindow(tmp, *ux_stdout);
+		outputSingleWindow(tmp, *ux_stdout);
 		free_swindow(tmp);
 		gWindow->previous.erase(gWindow->previous.begin());
 	}
 
 	rule_hits.clear();
 	index_ruleCohort_no.clear();
+	index_contextCohort.clear();
 	current = gWindow->current;
 	indexSingleWindow(*current);
 	current->hit_external.clear();
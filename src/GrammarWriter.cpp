@@ -48,7 +48,12 @@ void GrammarWriter::printSet(std::ostream& output, const Set& curset) {
 			u_fprintf(output, "O");
 		}
 		u_fprintf(output, "LIST %S = ", curset.name.data());
-		TagVectorSet tagsets[] = { trie_getTagsOrdered(curset.trie), trie_getTagsOrdered(curset.trie_special) };
+		// Sets of a mapped binary grammar only have their flat trie, so rebuild the plain one to print from
+		trie_t unflat;
+		if (curset.trie.empty() && !curset.trie_flat.empty()) {
+			trie_unflatten(curset.trie_flat, grammar->single_tags, unflat);
+		}
+		TagVectorSet tagsets[] = { trie_getTagsOrdered(unflat.empty() ? curset.trie : unflat), trie_getTagsOrdered(curset.trie_special) };
 		for (auto& tvs : tagsets) {
 			for (auto& tags : tvs) {
 				if (tags.size() > 1) {
@@ -36,6 +36,9 @@ namespace json = rapidjson;
 
 namespace CG3 {
 
+// The parser's stack comes from a pool too, since the default one is freed and allocated anew for every document
+typedef json::GenericDocument<json::UTF8<>, json::MemoryPoolAllocator<>, json::MemoryPoolAllocator<>> PooledDocument;
+
 std::string ustring_to_utf8(UStringView ustr) {
 	std::string utf8_str;
 	UErrorCode status = U_ZERO_ERROR;
@@ -59,17 +62,35 @@ JsonlApplicator::~JsonlApplicator() {
 	// Empty destructor body
 }
 
+// Helper to safely append a string from JSON to a UString, converting straight into the UString's own storage
+void json_append_ustring(const json::Value& val, UString& out) {
+	if (!val.IsString()) {
+		return;
+	}
+	auto len = val.GetStringLength();
+	auto at = out.size();
+	// UTF-16 never needs more code units than UTF-8 needs bytes
+	out.resize(at + len);
+	int32_t olen = 0;
+	UErrorCode status = U_ZERO_ERROR;
+	u_strFromUTF8WithSub(&out[at], SI32(len), &olen, val.GetString(), SI32(len), 0xFFFD, nullptr, &status);
+	out.resize(U_SUCCESS(status) ? at + olen : at);
+}
+
 // Helper to safely get string from JSON, converting to UString
 UString json_to_ustring(const json::Value& val) {
-	if (val.IsString()) {
-		auto utf8_str = val.GetString();
-		auto len = val.GetStringLength();
-		// Use ICU's fromUTF8 to correctly handle UTF-8 encoding
-		icu::UnicodeString unicode_str = icu::UnicodeString::fromUTF8(icu::StringPiece(utf8_str, SI32(len)));
-		UString result(unicode_str.getBuffer(), unicode_str.length());
-		return result;
-	}
-	return UString();
+	UString result;
+	json_append_ustring(val, result);
+	return result;
+}
+
+// Looks a member up once, instead of once to check for it and again to get it
+inline const json::Value* json_member(const json::Value& obj, const char* name) {
+	auto it = obj.FindMember(name);
+	if (it == obj.MemberEnd()) {
+		return nullptr;
+	}
+	return &it->value;
 }
 
 // Helper function to parse a single reading (and its potential subreadings) from JSON
@@ -82,15 +103,12 @@ Reading* JsonlApplicator::parseJsonReading(const json::Value& reading_obj, Cohor
 	addTagToReading(*cReading, parentCohort->wordform);
 
 	// Parse baseform ("l")
-	if (reading_obj.HasMember("l")) {
-		auto& l_val = reading_obj["l"];
-		auto base_str = json_to_ustring(l_val);
-		if (!base_str.empty()) {
-			UString base_tag;
-			base_tag += '"';
-			base_tag += base_str;
-			base_tag += '"';
-			addTagToReading(*cReading, addTag(base_tag));
+	if (auto l_val = json_member(reading_obj, "l")) {
+		json_tag.assign(1, '"');
+		json_append_ustring(*l_val, json_tag);
+		if (json_tag.size() > 1) {
+			json_tag += '"';
+			addTagToReading(*cReading, addTag(json_tag));
 		}
 		else {
 			u_fprintf(ux_stderr, "Warning: Empty 'l' (baseform) in reading on line %u.\n", numLines);
@@ -101,14 +119,15 @@ Reading* JsonlApplicator::parseJsonReading(const json::Value& reading_obj, Cohor
 	}
 
 	// Parse tags ("ts")
-	if (reading_obj.HasMember("ts") && reading_obj["ts"].IsArray()) {
-		auto& tags_arr = reading_obj["ts"];
+	auto tags_arr = json_member(reading_obj, "ts");
+	if (tags_arr && tags_arr->IsArray()) {
 		TagList mappings;
-		for (auto& tag_val : tags_arr.GetArray()) {
-			auto tag_str = json_to_ustring(tag_val);
-			if (!tag_str.empty()) {
-				auto tag = addTag(tag_str);
-				if (tag->type & T_MAPPING || (!tag_str.empty() && tag_str[0] == grammar->mapping_prefix)) {
+		for (auto& tag_val : tags_arr->GetArray()) {
+			json_tag.clear();
+			json_append_ustring(tag_val, json_tag);
+			if (!json_tag.empty()) {
+				auto tag = addTag(json_tag);
+				if (tag->type & T_MAPPING || json_tag[0] == grammar->mapping_prefix) {
 					mappings.push_back(tag);
 				}
 				else {
@@ -122,10 +141,9 @@ Reading* JsonlApplicator::parseJsonReading(const json::Value& reading_obj, Cohor
 	}
 
 	// Parse subreading ("s") recursively
-	if (reading_obj.HasMember("s")) {
-		auto& sub_reading_val = reading_obj["s"];
-		if (sub_reading_val.IsObject()) {
-			auto subReading = parseJsonReading(sub_reading_val, parentCohort);
+	if (auto sub_reading_val = json_member(reading_obj, "s")) {
+		if (sub_reading_val->IsObject()) {
+			auto subReading = parseJsonReading(*sub_reading_val, parentCohort);
 			if (subReading) {
 				cReading->next = subReading;
 			}
@@ -152,43 +170,43 @@ void JsonlApplicator::parseJsonCohort(const json::Value& obj, SingleWindow* cSWi
 	cCohort->global_number = gWindow->cohort_counter++;
 	++numCohorts;
 
-	UString wform_str;
-	if (obj.HasMember("w")) {
-		wform_str = json_to_ustring(obj["w"]);
+	json_tag.assign(u"\"<");
+	if (auto w_val = json_member(obj, "w")) {
+		json_append_ustring(*w_val, json_tag);
 	}
 	else {
 		u_fprintf(ux_stderr, "Warning: JSON cohort on line %u missing 'w' (wordform). Using empty.\n", numLines);
 	}
-	UString wform_tag;
-	wform_tag.append(u"\"<");
-	wform_tag += wform_str;
-	wform_tag.append(u">\"");
-	cCohort->wordform = addTag(wform_tag);
+	json_tag.append(u">\"");
+	cCohort->wordform = addTag(json_tag);
 
 	cCohort->wblank.clear();
-	if (obj.HasMember("z")) {
-		cCohort->text = json_to_ustring(obj["z"]);
+	if (auto z_val = json_member(obj, "z")) {
+		cCohort->text.clear();
+		json_append_ustring(*z_val, cCohort->text);
 	}
 
 	// handle static tags ("sts")
-	if (obj.HasMember("sts") && obj["sts"].IsArray()) {
+	auto sts_arr = json_member(obj, "sts");
+	if (sts_arr && sts_arr->IsArray()) {
 		if (!cCohort->wread) {
 			cCohort->wread = alloc_reading(cCohort);
 			addTagToReading(*cCohort->wread, cCohort->wordform);
 			cCohort->wread->baseform = cCohort->wordform->hash;
 		}
-		for (auto& tag_val : obj["sts"].GetArray()) {
-			auto tag_str = json_to_ustring(tag_val);
-			if (!tag_str.empty()) {
-				auto tag = addTag(tag_str);
+		for (auto& tag_val : sts_arr->GetArray()) {
+			json_tag.clear();
+			json_append_ustring(tag_val, json_tag);
+			if (!json_tag.empty()) {
+				auto tag = addTag(json_tag);
 				cCohort->wread->tags_list.push_back(tag->hash);
 			}
 		}
 	}
 
-	if (obj.HasMember("rs") && obj["rs"].IsArray()) {
-		auto& readings_arr = obj["rs"];
-		for (auto& reading_val : readings_arr.GetArray()) {
+	auto readings_arr = json_member(obj, "rs");
+	if (readings_arr && readings_arr->IsArray()) {
+		for (auto& reading_val : readings_arr->GetArray()) {
 			if (!reading_val.IsObject()) {
 				u_fprintf(ux_stderr, "Warning: Non-object found in 'rs' (readings) array on line %u. Skipping.\n", numLines);
 				continue;
@@ -209,16 +227,19 @@ void JsonlApplicator::parseJsonCohort(const json::Value& obj, SingleWindow* cSWi
 	}
 	insert_if_exists(cCohort->possible_sets, grammar->sets_any);
 
-	if (obj.HasMember("ds") && obj["ds"].IsUint()) {
-		cCohort->dep_self = obj["ds"].GetUint();
+	auto ds_val = json_member(obj, "ds");
+	if (ds_val && ds_val->IsUint()) {
+		cCohort->dep_self = ds_val->GetUint();
 	}
-	if (obj.HasMember("dp") && obj["dp"].IsUint()) {
-		cCohort->dep_parent = obj["dp"].GetUint();
+	auto dp_val = json_member(obj, "dp");
+	if (dp_val && dp_val->IsUint()) {
+		cCohort->dep_parent = dp_val->GetUint();
 	}
 
 	// parse deleted readings ("drs")
-	if (obj.HasMember("drs") && obj["drs"].IsArray()) {
-		for (auto& dr_val : obj["drs"].GetArray()) {
+	auto drs_arr = json_member(obj, "drs");
+	if (drs_arr && drs_arr->IsArray()) {
+		for (auto& dr_val : drs_arr->GetArray()) {
 			if (!dr_val.IsObject()) {
 				continue;
 			}
@@ -283,6 +304,13 @@ void JsonlApplicator::runGrammarOnText(std::istream& input, std::ostream& output
 
 	ux_stripBOM(input);
 
+	// Each line is parsed in place, into pools that are emptied before the next line.
+	// The first chunk of each pool is ours and survives that, so only lines that outgrow it allocate.
+	std::vector<char> value_chunk(UI64(1) << 16);
+	std::vector<char> stack_chunk(UI64(1) << 14);
+	json::MemoryPoolAllocator<> value_pool(value_chunk.data(), value_chunk.size());
+	json::MemoryPoolAllocator<> stack_pool(stack_chunk.data(), stack_chunk.size());
+
 	std::string line_str;
 	while (std::getline(input, line_str)) {
 		++numLines; // Keep track for warnings
@@ -292,8 +320,10 @@ void JsonlApplicator::runGrammarOnText(std::istream& input, std::ostream& output
 			continue;
 		}
 
-		json::Document doc;
-		json::ParseResult ok = doc.Parse(line_str.c_str());
+		value_pool.Clear();
+		stack_pool.Clear();
+		PooledDocument doc(&value_pool, 1024, &stack_pool);
+		json::ParseResult ok = doc.ParseInsitu(&line_str[0]);
 
 		if (!ok) {
 			u_fprintf(ux_stderr, "Warning: Failed to parse JSON on line %u: %s (offset %zu). Skipping line.\n", numLines, json::GetParseError_En(ok.Code()), ok.Offset());
@@ -333,7 +363,7 @@ void JsonlApplicator::runGrammarOnText(std::istream& input, std::ostream& output
 						gWindow->shuffleWindowsDown();
 						runGrammarOnWindow();
 						if (numWindows % resetAfter == 0) {
-							resetIndexes();
+							reclaimTags();
 						}
 						if (verbosity_level > 0) {
 							u_fprintf(ux_stderr, "Progress: L:%u, W:%u, C:%u, R:%u\r", numLines, numWindows, numCohorts, numReadings);
@@ -343,7 +373,7 @@ void JsonlApplicator::runGrammarOnText(std::istream& input, std::ostream& output
 					gWindow->shuffleWindowsDown();
 					while (!gWindow->previous.empty()) {
 						auto tmp = gWindow->previous.front();
-						printSingleWindow(tmp, output);
+						outputSingleWindow(tmp, output);
 						free_swindow(tmp);
 						gWindow->previous.erase(gWindow->previous.begin());
 					}
@@ -484,11 +514,11 @@ void JsonlApplicator::runGrammarOnText(std::istream& input, std::ostream& output
 				did_delim = true;
 			}
 
-			if (did_delim || gWindow->next.size() > num_windows) {
+			if (did_delim || gWindow->next.size() > windows_ahead + 1) {
 				gWindow->shuffleWindowsDown();
 				runGrammarOnWindow();
 				if (numWindows % resetAfter == 0) {
-					resetIndexes();
+					reclaimTags();
 				}
 				if (verbosity_level > 0) {
 					u_fprintf(ux_stderr, "Progress: L:%u, W:%u, C:%u, R:%u\r", numLines, numWindows, numCohorts, numReadings);
@@ -517,7 +547,7 @@ void JsonlApplicator::runGrammarOnText(std::istream& input, std::ostream& output
 	gWindow->shuffleWindowsDown();
 	while (!gWindow->previous.empty()) {
 		auto tmp = gWindow->previous.front();
-		printSingleWindow(tmp, output);
+		outputSingleWindow(tmp, output);
 		free_swindow(tmp);
 		gWindow->previous.erase(gWindow->previous.begin());
 	}
@@ -526,12 +556,12 @@ void JsonlApplicator::runGrammarOnText(std::istream& input, std::ostream& output
 
 	// Print any remaining 'global' variables that were set/rem'd after the last window was finalized
 	for (auto var : variables_output) {
-		auto key = grammar->single_tags[var];
+		auto key = single_tags[var];
 		auto iter = variables_set.find(var);
 		UString cmd_buf;
 		if (iter != variables_set.end()) {
 			if (iter->second != grammar->tag_any) {
-				auto value = grammar->single_tags[iter->second];
+				auto value = single_tags[iter->second];
 				cmd_buf.append(STR_CMD_SETVAR).append(key->tag).append(u"=").append(value->tag).append(u">");
 			}
 			else {
@@ -571,7 +601,7 @@ void JsonlApplicator::buildJsonTags(const Reading* reading, json::Value& tags_js
 			unique.insert(tter);
 		}
 
-		auto tag = grammar->single_tags[tter];
+		auto tag = single_tags[tter];
 
 		if (tag->type & T_DEPENDENCY && has_dep && !dep_original) {
 			continue;
@@ -580,8 +610,7 @@ void JsonlApplicator::buildJsonTags(const Reading* reading, json::Value& tags_js
 			continue;
 		}
 
-		auto utf8_tag = ustring_to_utf8(tag->tag);
-		json::Value tag_val(utf8_tag.c_str(), allocator);
+		json::Value tag_val(tag->tag_u8.data(), json::SizeType(tag->tag_u8.size()), allocator);
 		tags_json.PushBack(tag_val, allocator);
 	}
 }
@@ -589,20 +618,17 @@ void JsonlApplicator::buildJsonTags(const Reading* reading, json::Value& tags_js
 void JsonlApplicator::buildJsonReading(const Reading* reading, json::Value& reading_json, json::Document::AllocatorType& allocator) {
 	assert(reading_json.IsObject());
 
-	std::string baseform_utf8;
+	std::string_view baseform_utf8;
 	if (reading->baseform) {
-		auto it = grammar->single_tags.find(reading->baseform);
-		if (it != grammar->single_tags.end()) {
-			auto& tag = it->second->tag;
-			if (tag.size() >= 2 && tag.front() == '"' && tag.back() == '"') {
-				baseform_utf8 = ustring_to_utf8(tag.substr(1, tag.size() - 2));
-			}
-			else {
-				baseform_utf8 = ustring_to_utf8(tag);
+		auto it = single_tags.find(reading->baseform);
+		if (it != single_tags.end()) {
+			baseform_utf8 = it->second->tag_u8;
+			if (baseform_utf8.size() >= 2 && baseform_utf8.front() == '"' && baseform_utf8.back() == '"') {
+				baseform_utf8 = baseform_utf8.substr(1, baseform_utf8.size() - 2);
 			}
 		}
 	}
-	json::Value l_val(baseform_utf8.c_str(), allocator);
+	json::Value l_val(baseform_utf8.data(), json::SizeType(baseform_utf8.size()), allocator);
 	reading_json.AddMember("l", l_val, allocator);
 
 	json::Value tags_json(json::kArrayType);
@@ -633,15 +659,11 @@ void JsonlApplicator::printCohort(Cohort* cohort, std::ostream& output, bool pro
 	doc.SetObject();
 	auto& allocator = doc.GetAllocator();
 
-	auto& wform_tag = cohort->wordform->tag;
-	std::string wform_utf8;
-	if (wform_tag.size() >= 4 && wform_tag.substr(0, 2) == u"\"<" && wform_tag.substr(wform_tag.size() - 2) == u">\"") {
-		wform_utf8 = ustring_to_utf8(wform_tag.substr(2, wform_tag.size() - 4));
-	}
-	else {
-		wform_utf8 = ustring_to_utf8(wform_tag);
+	std::string_view wform_utf8 = cohort->wordform->tag_u8;
+	if (wform_utf8.size() >= 4 && wform_utf8.substr(0, 2) == "\"<" && wform_utf8.substr(wform_utf8.size() - 2) == ">\"") {
+		wform_utf8 = wform_utf8.substr(2, wform_utf8.size() - 4);
 	}
-	json::Value w_val(wform_utf8.c_str(), allocator);
+	json::Value w_val(wform_utf8.data(), json::SizeType(wform_utf8.size()), allocator);
 	doc.AddMember("w", w_val, allocator);
 
 	if (cohort->wread && !cohort->wread->tags_list.empty()) {
@@ -658,12 +680,11 @@ void JsonlApplicator::printCohort(Cohort* cohort, std::ostream& output, bool pro
 				unique_sts.insert(tag_hash);
 			}
 
-			auto it = grammar->single_tags.find(tag_hash);
-			if (it != grammar->single_tags.end()) {
+			auto it = single_tags.find(tag_hash);
+			if (it != single_tags.end()) {
 				auto tag_ptr = it->second;
 				if (tag_ptr) {
-					auto sts_tag_utf8 = ustring_to_utf8(tag_ptr->tag);
-					json::Value sts_tag_val(sts_tag_utf8.c_str(), allocator);
+					json::Value sts_tag_val(tag_ptr->tag_u8.data(), json::SizeType(tag_ptr->tag_u8.size()), allocator);
 					static_tags_json.PushBack(sts_tag_val, allocator);
 				}
 			}
@@ -744,12 +765,12 @@ void JsonlApplicator::printCohort(Cohort* cohort, std::ostream& output, bool pro
 void JsonlApplicator::printSingleWindow(SingleWindow* window, std::ostream& output, bool profiling) {
 	// Print variables as commands first
 	for (auto var : window->variables_output) {
-		auto key = grammar->single_tags[var];
+		auto key = single_tags[var];
 		auto iter = window->variables_set.find(var);
 		UString cmd_buf;
 		if (iter != window->variables_set.end()) {
 			if (iter->second != grammar->tag_any) {
-				auto value = grammar->single_tags[iter->second];
+				auto value = single_tags[iter->second];
 				cmd_buf.append(STR_CMD_SETVAR).append(key->tag).append(u"=").append(value->tag).append(u">");
 			}
 			else {
@@ -43,6 +43,9 @@ private:
 	Reading* parseJsonReading(const rapidjson::Value& reading_obj, Cohort* parentCohort);
 	void buildJsonReading(const Reading* reading, rapidjson::Value& reading_json, rapidjson::Document::AllocatorType& allocator);
 	void buildJsonTags(const Reading* reading, rapidjson::Value& tags_json, rapidjson::Document::AllocatorType& allocator);
+
+	// Scratch space for building tags from JSON strings
+	UString json_tag;
 };
 
 }
@@ -0,0 +1,255 @@
+/*
+* Copyright (C) 2007-2025, GrammarSoft ApS
+* Developed by Tino Didriksen <mail@tinodidriksen.com>
+* Design by Eckhard Bick <eckhard.bick@mail.dk>, Tino Didriksen <mail@tinodidriksen.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this progam.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "MatchMemo.hpp"
+#include "Grammar.hpp"
+
+namespace CG3 {
+
+constexpr char MEMO_MAGIC[4] = { 'C', 'G', 'M', 'M' };
+constexpr uint32_t MEMO_VERSION = 1;
+
+typedef std::pair<uint32_t, uint8_t> memo_answer;
+
+inline bool answer_less(const memo_answer& a, uint32_t regex) {
+	return a.first < regex;
+}
+
+MatchMemo::MatchMemo(const Grammar& grammar, size_t budget)
+  : budget(budget / SHARDS)
+{
+	// Answers only carry over to a grammar with the very same patterns under the very same tag hashes
+	for (auto t : grammar.single_tags_list) {
+		if (!t->hasRegexp()) {
+			continue;
+		}
+		grammar_hash = hash_value(t->hash, grammar_hash);
+		grammar_hash = hash_value(t->type & T_CASE_INSENSITIVE, grammar_hash);
+		grammar_hash = hash_value(t->regexpPattern(), grammar_hash);
+	}
+}
+
+bool MatchMemo::load(std::istream& input) {
+	char magic[sizeof(MEMO_MAGIC)]{};
+	input.read(magic, sizeof(magic));
+	if (!input || memcmp(magic, MEMO_MAGIC, sizeof(magic)) != 0) {
+		return false;
+	}
+	auto version = readBE<uint32_t>(input);
+	auto ghash = readBE<uint32_t>(input);
+	if (!input || version != MEMO_VERSION || ghash != grammar_hash) {
+		return false;
+	}
+
+	auto num_texts = readBE<uint32_t>(input);
+	// A truncated file still gives all the entries before the cut
+	for (uint32_t i = 0; i < num_texts && input; ++i) {
+		Entry entry;
+		entry.hits = readBE<uint32_t>(input);
+		auto len = readBE<uint32_t>(input);
+		if (!input || len > (1u << 20)) {
+			break;
+		}
+		entry.text.resize(len);
+		for (auto& c : entry.text) {
+			c = static_cast<UChar>(readBE<uint16_t>(input));
+		}
+		auto num_answers = readBE<uint32_t>(input);
+		if (!input || num_answers > (1u << 20)) {
+			break;
+		}
+		entry.answers.resize(num_answers);
+		for (auto& a : entry.answers) {
+			a.first = readBE<uint32_t>(input);
+			a.second = readBE<uint8_t>(input);
+		}
+		if (!input) {
+			break;
+		}
+		// Texts come most asked first, so a text that doesn't fit its shard is rarer than all that are already in
+		auto& sh = shard(entry.text);
+		std::lock_guard<std::mutex> lock(sh.mutex);
+		auto sz = entryBytes(entry.text) + num_answers * sizeof(memo_answer);
+		if (sh.used + sz > budget || sh.index.count(entry.text)) {
+			continue;
+		}
+		sh.used += sz;
+		sh.index.emplace(entry.text, UI32(sh.entries.size()));
+		sh.entries.push_back(std::move(entry));
+	}
+	return true;
+}
+
+void MatchMemo::save(std::ostream& output) {
+	std::vector<std::unique_lock<std::mutex>> locks;
+	std::vector<const Entry*> order;
+	for (auto& sh : shards) {
+		locks.emplace_back(sh.mutex);
+		for (auto& e : sh.entries) {
+			order.push_back(&e);
+		}
+	}
+	std::stable_sort(order.begin(), order.end(), [](auto a, auto b) {
+		return a->hits > b->hits;
+	});
+
+	output.write(MEMO_MAGIC, sizeof(MEMO_MAGIC));
+	writeBE<uint32_t>(output, MEMO_VERSION);
+	writeBE<uint32_t>(output, grammar_hash);
+	writeBE<uint32_t>(output, UI32(order.size()));
+	for (auto e : order) {
+		writeBE<uint32_t>(output, e->hits / 2);
+		writeBE<uint32_t>(output, UI32(e->text.size()));
+		for (auto c : e->text) {
+			writeBE<uint16_t>(output, static_cast<uint16_t>(c));
+		}
+		writeBE<uint32_t>(output, UI32(e->answers.size()));
+		for (auto& a : e->answers) {
+			writeBE<uint32_t>(output, a.first);
+			writeBE<uint8_t>(output, a.second);
+		}
+	}
+}
+
+int MatchMemo::find(const UString& text, uint32_t regex) {
+	auto& sh = shard(text);
+	std::lock_guard<std::mutex> lock(sh.mutex);
+	auto it = sh.index.find(text);
+	if (it != sh.index.end()) {
+		auto& e = sh.entries[it->second];
+		auto ait = std::lower_bound(e.answers.begin(), e.answers.end(), regex, answer_less);
+		if (ait != e.answers.end() && ait->first == regex) {
+			++e.hits;
+			e.ref = true;
+			++sh.hits;
+			return ait->second;
+		}
+	}
+	++sh.misses;
+	return UNKNOWN;
+}
+
+// Evicts texts until sz more bytes fit, never the one at keep; returns false if that can't be done
+bool MatchMemo::makeRoom(Shard& sh, size_t sz, size_t keep) {
+	if (sz > budget) {
+		return false;
+	}
+	while (sh.used + sz > budget) {
+		if (sh.entries.size() <= (keep < sh.entries.size() ? 1u : 0u)) {
+			return false;
+		}
+		if (sh.hand >= sh.entries.size()) {
+			sh.hand = 0;
+		}
+		auto& e = sh.entries[sh.hand];
+		if (e.ref || sh.hand == keep) {
+			e.ref = false;
+			++sh.hand;
+			continue;
+		}
+		sh.used -= entryBytes(e.text) + e.answers.size() * sizeof(memo_answer);
+		sh.index.erase(e.text);
+		++sh.evictions;
+		// The last entry takes the evicted one's place, and is looked at next
+		auto last = sh.entries.size() - 1;
+		if (sh.hand != last) {
+			e = std::move(sh.entries.back());
+			sh.index[e.text] = UI32(sh.hand);
+			if (keep == last) {
+				keep = sh.hand;
+			}
+		}
+		sh.entries.pop_back();
+	}
+	return true;
+}
+
+void MatchMemo::insert(const UString& text, uint32_t regex, bool yes) {
+	auto& sh = shard(text);
+	std::lock_guard<std::mutex> lock(sh.mutex);
+	auto it = sh.index.find(text);
+	if (it == sh.index.end()) {
+		if (!makeRoom(sh, entryBytes(text) + sizeof(memo_answer), std::numeric_limits<size_t>::max())) {
+			return;
+		}
+		sh.used += entryBytes(text);
+		it = sh.index.emplace(text, UI32(sh.entries.size())).first;
+		sh.entries.emplace_back();
+		sh.entries.back().text = text;
+	}
+	auto at = it->second;
+	auto* e = &sh.entries[at];
+	auto ait = std::lower_bound(e->answers.begin(), e->answers.end(), regex, answer_less);
+	if (ait != e->answers.end() && ait->first == regex) {
+		ait->second = yes;
+		return;
+	}
+	if (sh.used + sizeof(memo_answer) > budget) {
+		if (!makeRoom(sh, sizeof(memo_answer), at)) {
+			return;
+		}
+		// Eviction may have moved the entry
+		e = &sh.entries[sh.index.find(text)->second];
+		ait = std::lower_bound(e->answers.begin(), e->answers.end(), regex, answer_less);
+	}
+	sh.used += sizeof(memo_answer);
+	e->answers.insert(ait, memo_answer(regex, yes));
+}
+
+uint64_t MatchMemo::hits() const {
+	uint64_t n = 0;
+	for (auto& sh : shards) {
+		n += sh.hits;
+	}
+	return n;
+}
+
+uint64_t MatchMemo::misses() const {
+	uint64_t n = 0;
+	for (auto& sh : shards) {
+		n += sh.misses;
+	}
+	return n;
+}
+
+uint64_t MatchMemo::evictions() const {
+	uint64_t n = 0;
+	for (auto& sh : shards) {
+		n += sh.evictions;
+	}
+	return n;
+}
+
+size_t MatchMemo::size() const {
+	size_t n = 0;
+	for (auto& sh : shards) {
+		n += sh.entries.size();
+	}
+	return n;
+}
+
+size_t MatchMemo::bytes() const {
+	size_t n = 0;
+	for (auto& sh : shards) {
+		n += sh.used;
+	}
+	return n;
+}
+
+}
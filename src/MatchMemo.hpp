@@ -0,0 +1,100 @@
+/*
+* Copyright (C) 2007-2025, GrammarSoft ApS
+* Developed by Tino Didriksen <mail@tinodidriksen.com>
+* Design by Eckhard Bick <eckhard.bick@mail.dk>, Tino Didriksen <mail@tinodidriksen.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this progam.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#ifndef c6d28b7452ec699b_MATCHMEMO_HPP
+#define c6d28b7452ec699b_MATCHMEMO_HPP
+
+#include "stdafx.hpp"
+#include <unordered_map>
+#include <mutex>
+
+namespace CG3 {
+class Grammar;
+
+/**
+ * Remembers which input tags matched which of the grammar's regex tags, by the text of the input tag rather than its
+ * hash, so that answers stay valid across runs and can be kept in a file. Shared by all applicators of a grammar.
+ *
+ * Texts are spread over shards by hash, each with its own lock and an equal part of the budget, so that --threads
+ * workers seldom wait on each other. A full shard makes room by CLOCK: texts asked about since the hand last passed
+ * them get another round. When saving, the texts asked about most often are written first, so they are the ones that
+ * survive loading under a smaller budget, and counts are halved so old vocabulary fades.
+ */
+class MatchMemo {
+public:
+	static constexpr int UNKNOWN = -1;
+
+	MatchMemo(const Grammar& grammar, size_t budget);
+
+	// Returns false if the stream isn't a memo for this grammar
+	bool load(std::istream& input);
+	void save(std::ostream& output);
+
+	// Returns 1 or 0 for a known answer, UNKNOWN otherwise
+	int find(const UString& text, uint32_t regex);
+	void insert(const UString& text, uint32_t regex, bool yes);
+
+	uint64_t hits() const;
+	uint64_t misses() const;
+	uint64_t evictions() const;
+	size_t size() const;
+	size_t bytes() const;
+
+private:
+	static constexpr size_t SHARDS = 16;
+
+	struct Entry {
+		UString text;
+		uint32_t hits = 0;
+		bool ref = false;
+		// Sorted by regex tag hash
+		std::vector<std::pair<uint32_t, uint8_t>> answers;
+	};
+
+	struct Shard {
+		std::mutex mutex;
+		std::unordered_map<UString, uint32_t, hash_ustring> index;
+		std::vector<Entry> entries;
+		size_t hand = 0;
+		size_t used = 0;
+		uint64_t hits = 0;
+		uint64_t misses = 0;
+		uint64_t evictions = 0;
+	};
+
+	Shard shards[SHARDS];
+	uint32_t grammar_hash = 0;
+	// Per shard
+	size_t budget = 0;
+
+	Shard& shard(const UString& text) {
+		return shards[hash_ustring()(text) % SHARDS];
+	}
+
+	static size_t entryBytes(const UString& text) {
+		return sizeof(Entry) + sizeof(UString) + text.size() * sizeof(UChar) * 2 + 32;
+	}
+
+	bool makeRoom(Shard& sh, size_t sz, size_t keep);
+};
+
+}
+
+#endif
@@ -224,11 +224,11 @@ void MatxinApplicator::runGrammarOnText(std::istream& input, std::ostream& outpu
 			if (cCohort && cSWindow) {
 				cSWindow->appendCohort(cCohort);
 			}
-			if (gWindow->next.size() > num_windows) {
+			if (gWindow->next.size() > windows_ahead + 1) {
 				gWindow->shuffleWindowsDown();
 				runGrammarOnWindow();
 				if (numWindows % resetAfter == 0) {
-					resetIndexes();
+					reclaimTags();
 				}
 			}
 			cCohort = alloc_cohort(cSWindow);
@@ -385,7 +385,7 @@ void MatxinApplicator::runGrammarOnText(std::istream& input, std::ostream& outpu
 	gWindow->shuffleWindowsDown();
 	while (!gWindow->previous.empty()) {
 		SingleWindow* tmp = gWindow->previous.front();
-		printSingleWindow(tmp, output);
+		outputSingleWindow(tmp, output);
 		free_swindow(tmp);
 		gWindow->previous.erase(gWindow->previous.begin());
 	}
@@ -614,7 +614,7 @@ void MatxinApplicator::printReading(Reading* reading, Node& node, std::ostream&
 	}
 
 	// Lop off the initial and final '"' characters
-	UnicodeString bf(grammar->single_tags[reading->baseform]->tag.data() + 1, SI32(grammar->single_tags[reading->baseform]->tag.size() - 2));
+	UnicodeString bf(single_tags[reading->baseform]->tag.data() + 1, SI32(single_tags[reading->baseform]->tag.size() - 2));
 
 	node.lemma = bf.getTerminatedBuffer();
 
@@ -626,7 +626,7 @@ void MatxinApplicator::printReading(Reading* reading, Node& node, std::ostream&
 	bool multi = false;
 	bool first = true;
 	for (auto tter : reading->tags_list) {
-		const Tag* tag = grammar->single_tags[tter];
+		const Tag* tag = single_tags[tter];
 		if (tag->tag[0] == '+') {
 			multi = true;
 		}
@@ -656,10 +656,10 @@ void MatxinApplicator::printReading(Reading* reading, Node& node, std::ostream&
 		if (tter == endtag || tter == begintag) {
 			continue;
 		}
-		const Tag* tag = grammar->single_tags[tter];
+		const Tag* tag = single_tags[tter];
 		if (!(tag->type & T_BASEFORM) && !(tag->type & T_WORDFORM)) {
 			if (tag->tag[0] == '+') {
-				u_fprintf(output, "%S", tag->tag.data());
+				tag->printUTF8(output);
 			}
 			else if (tag->tag[0] == '@') {
 				//u_fprintf(output, "<%S>", tag->tag.data());
@@ -732,13 +732,13 @@ void MatxinApplicator::printSingleWindow(SingleWindow* window, std::ostream& out
 				if (tter == cohort->wordform->hash) {
 					continue;
 				}
-				const Tag *tag = grammar->single_tags[tter];
+				const Tag *tag = single_tags[tter];
 				u_fprintf(output, "<%S>", tag->tag.data());
 			}
 		}
 //*/
 
-		//Tag::printTagRaw(output, grammar->single_tags[cohort->wordform]);
+		//Tag::printTagRaw(output, single_tags[cohort->wordform]);
 		Reading* reading = cohort->readings[0];
 
 		printReading(reading, n, output);
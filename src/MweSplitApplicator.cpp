@@ -47,7 +47,7 @@ const Tag* MweSplitApplicator::maybeWfTag(const Reading* r) {
 		if (tter == r->baseform || tter == r->parent->wordform->hash) {
 			continue;
 		}
-		const Tag* tag = grammar->single_tags[tter];
+		const Tag* tag = single_tags[tter];
 		// If we are to split, there has to be at least one wordform on a head (not-sub) reading
 		if (tag->type & T_WORDFORM) {
 			return tag;
@@ -154,11 +154,11 @@ std::vector<Cohort*> MweSplitApplicator::splitMwe(Cohort* cohort) {
 
 void MweSplitApplicator::printSingleWindow(SingleWindow* window, std::ostream& output, bool profiling) {
 	for (auto var : window->variables_output) {
-		Tag* key = grammar->single_tags[var];
+		Tag* key = single_tags[var];
 		auto iter = window->variables_set.find(var);
 		if (iter != window->variables_set.end()) {
 			if (iter->second != grammar->tag_any) {
-				Tag* value = grammar->single_tags[iter->second];
+				Tag* value = single_tags[iter->second];
 				u_fprintf(output, "%S%S=%S>\n", STR_CMD_SETVAR.data(), key->tag.data(), value->tag.data());
 			}
 			else {
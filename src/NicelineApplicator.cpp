@@ -82,10 +82,11 @@ void NicelineApplicator::runGrammarOnText(std::istream& input, std::ostream& out
 	gWindow->window_span = num_windows;
 
 	ux_stripBOM(input);
+	UStreamReader reader(input);
 
 	while (!input.eof()) {
 		++lines;
-		auto packoff = get_line_clean(line, cleaned, input, true);
+		auto packoff = get_line_clean(line, cleaned, reader, true);
 
 		// Trim trailing whitespace
 		while (cleaned[0] && ISSPACE(cleaned[packoff - 1])) {
@@ -169,11 +170,11 @@ void NicelineApplicator::runGrammarOnText(std::istream& input, std::ostream& out
 			if (cCohort && cSWindow) {
 				cSWindow->appendCohort(cCohort);
 			}
-			if (gWindow->next.size() > num_windows) {
+			if (gWindow->next.size() > windows_ahead + 1) {
 				gWindow->shuffleWindowsDown();
 				runGrammarOnWindow();
 				if (numWindows % resetAfter == 0) {
-					resetIndexes();
+					reclaimTags();
 				}
 				if (verbosity_level > 0) {
 					u_fprintf(ux_stderr, "Progress: L:%u, W:%u, C:%u, R:%u\r", lines, numWindows, numCohorts, numReadings);
@@ -305,7 +306,7 @@ void NicelineApplicator::runGrammarOnText(std::istream& input, std::ostream& out
 	gWindow->shuffleWindowsDown();
 	while (!gWindow->previous.empty()) {
 		SingleWindow* tmp = gWindow->previous.front();
-		printSingleWindow(tmp, output);
+		outputSingleWindow(tmp, output);
 		free_swindow(tmp);
 		gWindow->previous.erase(gWindow->previous.begin());
 	}
@@ -322,7 +323,9 @@ void NicelineApplicator::printReading(const Reading* reading, std::ostream& outp
 	}
 	u_fputc('\t', output);
 	if (reading->baseform) {
-		u_fprintf(output, "[%.*S]", grammar->single_tags.find(reading->baseform)->second->tag.size() - 2, grammar->single_tags.find(reading->baseform)->second->tag.data() + 1);
+		output.put('[');
+		single_tags.find(reading->baseform)->second->printUTF8(output, 1, 1);
+		output.put(']');
 	}
 
 	uint32SortedVector unique;
@@ -339,14 +342,15 @@ void NicelineApplicator::printReading(const Reading* reading, std::ostream& outp
 			}
 			unique.insert(tter);
 		}
-		const Tag* tag = grammar->single_tags[tter];
+		const Tag* tag = single_tags[tter];
 		if (tag->type & T_DEPENDENCY && has_dep && !dep_original) {
 			continue;
 		}
 		if (tag->type & T_RELATION && has_relations) {
 			continue;
 		}
-		u_fprintf(output, " %S", tag->tag.data());
+		output.put(' ');
+		tag->printUTF8(output);
 	}
 
 	if (has_dep && !(reading->parent->type & CT_REMOVED)) {
@@ -397,7 +401,7 @@ void NicelineApplicator::printReading(const Reading* reading, std::ostream& outp
 		if (!reading->parent->relations.empty()) {
 			for (const auto& miter : reading->parent->relations) {
 				for (auto siter : miter.second) {
-					u_fprintf(output, " R:%S:%u", grammar->single_tags.find(miter.first)->second->tag.data(), siter);
+					u_fprintf(output, " R:%S:%u", single_tags.find(miter.first)->second->tag.data(), siter);
 				}
 			}
 		}
@@ -432,7 +436,7 @@ void NicelineApplicator::printCohort(Cohort* cohort, std::ostream& output, bool
 		}
 	}
 
-	u_fprintf(output, "%.*S", cohort->wordform->tag.size() - 4, cohort->wordform->tag.data() + 2);
+	cohort->wordform->printUTF8(output, 2, 2);
 	if (cohort->wread && !did_warn_statictags) {
 		u_fprintf(ux_stderr, "Warning: Niceline CG format cannot output static tags! You are losing information!\n");
 		u_fflush(ux_stderr);
@@ -0,0 +1,317 @@
+/*
+* Copyright (C) 2007-2025, GrammarSoft ApS
+* Developed by Tino Didriksen <mail@tinodidriksen.com>
+* Design by Eckhard Bick <eckhard.bick@mail.dk>, Tino Didriksen <mail@tinodidriksen.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this progam.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "ParallelApplicator.hpp"
+#include "ContextualTest.hpp"
+#include "Rule.hpp"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+
+namespace CG3 {
+
+// Delimiters only end a chunk once it holds at least this much input, so that per-chunk overhead stays negligible
+constexpr size_t PARALLEL_CHUNK_SIZE = 1 << 20;
+
+ParallelApplicator::ParallelApplicator(std::ostream& ux_err, Grammar& grammar, size_t num_threads, setup_applicator_t setup_applicator)
+  : ux_stderr(&ux_err)
+  , grammar(&grammar)
+{
+	workers.emplace_back(new FormatConverter(ux_err));
+	setup_applicator(*workers.front());
+
+	analyzeGrammar(grammar, *workers.front());
+	if (!can_split) {
+		return;
+	}
+
+	// Applicators keep their runtime tags to themselves, so all workers can share the one grammar
+	for (size_t i = 1; i < num_threads; ++i) {
+		workers.emplace_back(new FormatConverter(ux_err));
+		setup_applicator(*workers.back());
+	}
+}
+
+inline bool test_spans(const ContextualTest* test) {
+	return (test->pos & (POS_SPAN_BOTH | POS_SPAN_LEFT | POS_SPAN_RIGHT)) != 0;
+}
+
+inline bool collect_wordforms(const Grammar& grammar, const Set& set, std::vector<std::string>& wfs) {
+	if (!set.sets.empty()) {
+		for (auto op : set.set_ops) {
+			if (op != S_OR) {
+				return false;
+			}
+		}
+		for (auto s : set.sets) {
+			if (!collect_wordforms(grammar, *grammar.sets_list[s], wfs)) {
+				return false;
+			}
+		}
+		return true;
+	}
+	if (!set.trie_special.empty() || set.trie_keys.empty()) {
+		return false;
+	}
+	for (size_t i = 0; i < set.trie_keys.size(); ++i) {
+		auto& node = set.trie_flat[i];
+		auto tag = grammar.single_tags.find(node.hash)->second;
+		if (!node.terminal || node.count || !(tag->type & T_WORDFORM) || (tag->type & MASK_TAG_SPECIAL)) {
+			return false;
+		}
+		// The stream reader collapses whitespace and honours escapes, so such wordforms can't be compared verbatim
+		for (auto c : tag->tag) {
+			if (ISSPACE(c) || c == '\\') {
+				return false;
+			}
+		}
+		std::string wf(tag->tag.size() * 4, 0);
+		int32_t olen = 0;
+		UErrorCode status = U_ZERO_ERROR;
+		u_strToUTF8(&wf[0], SI32(wf.size()), &olen, tag->tag.data(), SI32(tag->tag.size()), &status);
+		if (U_FAILURE(status)) {
+			return false;
+		}
+		wf.resize(olen);
+		wfs.push_back(std::move(wf));
+	}
+	return true;
+}
+
+void ParallelApplicator::analyzeGrammar(const Grammar& grammar, const FormatConverter& applicator) {
+	if (applicator.fmt_input != CG3SF_CG || applicator.fmt_output == CG3SF_BINARY) {
+		u_fprintf(ux_stderr, "Warning: --threads only works with CG input and non-binary output - running single-threaded.\n");
+		return;
+	}
+	if (applicator.profiler || applicator.sample_profiler) {
+		u_fprintf(ux_stderr, "Warning: --threads cannot be combined with --profile - running single-threaded.\n");
+		return;
+	}
+	// Absolute cohort numbers and IDs continue across FLUSH, so they would differ if chunks were run separately
+	if (applicator.print_ids || applicator.dep_absolute || applicator.has_relations) {
+		u_fprintf(ux_stderr, "Warning: --threads cannot be used with cohort IDs or relations - running single-threaded.\n");
+		return;
+	}
+
+	bool has_vars = false;
+	for (auto rule : grammar.rule_by_number) {
+		if (rule->type == K_EXTERNAL || rule->type == K_EXTERNAL_ONCE || rule->type == K_EXTERNAL_ALWAYS) {
+			u_fprintf(ux_stderr, "Warning: --threads cannot be used with EXTERNAL rules - running single-threaded.\n");
+			return;
+		}
+		if (rule->type == K_SETVARIABLE || rule->type == K_REMVARIABLE) {
+			has_vars = true;
+		}
+	}
+	can_split = true;
+
+	if (has_vars || applicator.has_dep || applicator.dep_delimit || applicator.always_span || grammar.has_bag_of_tags) {
+		return;
+	}
+	for (auto& it : grammar.contexts) {
+		if (test_spans(it.second)) {
+			return;
+		}
+	}
+	if (!grammar.delimiters || !collect_wordforms(grammar, *grammar.delimiters, delimiters)) {
+		delimiters.clear();
+		return;
+	}
+	std::sort(delimiters.begin(), delimiters.end());
+	can_split_delimiters = true;
+}
+
+bool ParallelApplicator::isDelimiter(std::string_view line) const {
+	auto e = line.find_first_of(" \t");
+	auto wf = line.substr(0, e);
+	return std::binary_search(delimiters.begin(), delimiters.end(), wf);
+}
+
+void ParallelApplicator::runGrammarOnText(std::istream& input, std::ostream& output) {
+	if (workers.size() == 1) {
+		workers.front()->runGrammarOnText(input, output);
+		return;
+	}
+	if (!can_split_delimiters && grammar->verbosity_level > 0) {
+		u_fprintf(ux_stderr, "Info: Grammar can look across windows, so input will only be split at <STREAMCMD:FLUSH>.\n");
+	}
+
+	struct Chunk {
+		std::string input;
+		std::string output;
+		bool done = false;
+	};
+
+	std::mutex mtx;
+	std::condition_variable cv_work, cv_done;
+	std::deque<Chunk*> todo;
+	std::deque<std::unique_ptr<Chunk>> chunks;
+	bool input_done = false;
+
+	std::vector<std::thread> threads;
+	for (auto& w : workers) {
+		auto applicator = w.get();
+		threads.emplace_back([&, applicator]() {
+			for (;;) {
+				Chunk* chunk = nullptr;
+				{
+					std::unique_lock<std::mutex> lock(mtx);
+					cv_work.wait(lock, [&]() { return input_done || !todo.empty(); });
+					if (todo.empty()) {
+						return;
+					}
+					chunk = todo.front();
+					todo.pop_front();
+				}
+
+				std::istringstream in(chunk->input);
+				std::ostringstream out;
+				applicator->runGrammarOnText(in, out);
+
+				{
+					std::lock_guard<std::mutex> lock(mtx);
+					chunk->input.clear();
+					chunk->output = out.str();
+					chunk->done = true;
+				}
+				cv_done.notify_all();
+			}
+		});
+	}
+
+	// Writes finished chunks in input order, blocking while more than max_pending chunks are unwritten
+	auto write_chunks = [&](size_t max_pending) {
+		for (;;) {
+			std::unique_ptr<Chunk> chunk;
+			{
+				std::unique_lock<std::mutex> lock(mtx);
+				cv_done.wait(lock, [&]() { return chunks.size() <= max_pending || chunks.front()->done; });
+				if (chunks.empty() || !chunks.front()->done) {
+					return;
+				}
+				chunk = std::move(chunks.front());
+				chunks.pop_front();
+			}
+			output.write(chunk->output.data(), chunk->output.size());
+			output.flush();
+		}
+	};
+
+	auto submit = [&](std::string& buf) {
+		if (buf.empty()) {
+			return;
+		}
+		std::unique_ptr<Chunk> chunk(new Chunk);
+		chunk->input.swap(buf);
+		{
+			std::lock_guard<std::mutex> lock(mtx);
+			todo.push_back(chunk.get());
+			chunks.push_back(std::move(chunk));
+		}
+		cv_work.notify_one();
+		write_chunks(workers.size() * 2);
+	};
+
+	constexpr std::string_view cmd_flush{ "<STREAMCMD:FLUSH>" };
+	constexpr std::string_view cmd_exit{ "<STREAMCMD:EXIT>" };
+	constexpr std::string_view cmd_ignore{ "<STREAMCMD:IGNORE>" };
+	constexpr std::string_view cmd_resume{ "<STREAMCMD:RESUME>" };
+	constexpr std::string_view cmd_setvar{ "<STREAMCMD:SETVAR:" };
+	constexpr std::string_view cmd_remvar{ "<STREAMCMD:REMVAR:" };
+	// Vertical tab, form feed, NEL, LS, and PS also end lines for the stream reader
+	constexpr std::string_view other_nl[] = { "\x0B", "\x0C", "\xC2\x85", "\xE2\x80\xA8", "\xE2\x80\xA9" };
+
+	std::string buf;
+	std::string line;
+	bool split_delimiters = can_split_delimiters;
+	bool ignoring = false;
+	bool pending_vars = false;
+	bool last_delimiter = false;
+
+	while (std::getline(input, line)) {
+		std::string_view trimmed(line);
+		while (!trimmed.empty() && (trimmed.back() == ' ' || trimmed.back() == '\t' || trimmed.back() == '\r')) {
+			trimmed.remove_suffix(1);
+		}
+
+		bool split_after = false;
+		bool stop = false;
+		if (!ignoring && trimmed.size() > 1 && trimmed[0] == '"' && trimmed[1] == '<') {
+			if (split_delimiters && last_delimiter && !pending_vars && buf.size() >= PARALLEL_CHUNK_SIZE) {
+				submit(buf);
+			}
+			last_delimiter = split_delimiters && isDelimiter(trimmed);
+			pending_vars = false;
+		}
+		else if (trimmed == cmd_flush) {
+			split_after = !ignoring && !pending_vars;
+			last_delimiter = false;
+		}
+		else if (trimmed == cmd_exit) {
+			split_after = stop = true;
+		}
+		else if (trimmed == cmd_ignore) {
+			ignoring = true;
+			last_delimiter = false;
+		}
+		else if (trimmed == cmd_resume) {
+			ignoring = false;
+		}
+		else if (trimmed.substr(0, cmd_setvar.size()) == cmd_setvar || trimmed.substr(0, cmd_remvar.size()) == cmd_remvar) {
+			// Variables carry over to following windows
+			pending_vars = true;
+			split_delimiters = false;
+			last_delimiter = false;
+		}
+		if (last_delimiter) {
+			for (auto nl : other_nl) {
+				if (trimmed.find(nl) != std::string_view::npos) {
+					last_delimiter = false;
+					break;
+				}
+			}
+		}
+
+		buf += line;
+		if (!input.eof()) {
+			buf += '\n';
+		}
+		if (split_after) {
+			submit(buf);
+		}
+		if (stop) {
+			break;
+		}
+	}
+	submit(buf);
+
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		input_done = true;
+	}
+	cv_work.notify_all();
+	write_chunks(0);
+
+	for (auto& t : threads) {
+		t.join();
+	}
+}
+
+}
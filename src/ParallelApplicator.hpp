@@ -0,0 +1,64 @@
+/*
+* Copyright (C) 2007-2025, GrammarSoft ApS
+* Developed by Tino Didriksen <mail@tinodidriksen.com>
+* Design by Eckhard Bick <eckhard.bick@mail.dk>, Tino Didriksen <mail@tinodidriksen.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this progam.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#ifndef c6d28b7452ec699b_PARALLELAPPLICATOR_HPP
+#define c6d28b7452ec699b_PARALLELAPPLICATOR_HPP
+
+#include "FormatConverter.hpp"
+#include <functional>
+
+namespace CG3 {
+
+/**
+ * Runs a grammar over CG formatted input in several threads at once.
+ *
+ * The input is cut into chunks at points where no window can see across, each chunk is run by one of the workers,
+ * and the output is written in input order. A chunk always ends at <STREAMCMD:FLUSH> or EXIT. If the grammar cannot
+ * look across window boundaries (no spanning contexts, dependency, relations, or variables), chunks may also end
+ * after a cohort that matches DELIMITERS, provided that set is a plain list of wordforms.
+ */
+class ParallelApplicator {
+public:
+	typedef std::function<void(FormatConverter&)> setup_applicator_t;
+
+	/**
+	 * @param grammar The loaded grammar, shared by all workers
+	 * @param num_threads Number of workers to run
+	 * @param setup_applicator Sets the grammar, formats, and options on each worker's applicator
+	 */
+	ParallelApplicator(std::ostream& ux_err, Grammar& grammar, size_t num_threads, setup_applicator_t setup_applicator);
+
+	void runGrammarOnText(std::istream& input, std::ostream& output);
+
+private:
+	std::ostream* ux_stderr = nullptr;
+	Grammar* grammar = nullptr;
+	std::vector<std::unique_ptr<FormatConverter>> workers;
+	bool can_split = false;
+	bool can_split_delimiters = false;
+	std::vector<std::string> delimiters;
+
+	void analyzeGrammar(const Grammar& grammar, const FormatConverter& applicator);
+	bool isDelimiter(std::string_view line) const;
+};
+
+}
+
+#endif
@@ -83,10 +83,11 @@ void PlaintextApplicator::runGrammarOnText(std::istream& input, std::ostream& ou
 	gWindow->window_span = num_windows;
 
 	ux_stripBOM(input);
+	UStreamReader reader(input);
 
 	while (!input.eof()) {
 		++lines;
-		auto packoff = get_line_clean(line, cleaned, input);
+		auto packoff = get_line_clean(line, cleaned, reader);
 
 		// Trim trailing whitespace
 		while (cleaned[0] && ISSPACE(cleaned[packoff - 1])) {
@@ -160,11 +161,11 @@ void PlaintextApplicator::runGrammarOnText(std::istream& input, std::ostream& ou
 				++numWindows;
 				did_soft_lookback = false;
 			}
-			if (gWindow->next.size() > num_windows) {
+			if (gWindow->next.size() > windows_ahead + 1) {
 				gWindow->shuffleWindowsDown();
 				runGrammarOnWindow();
 				if (numWindows % resetAfter == 0) {
-					resetIndexes();
+					reclaimTags();
 				}
 				if (verbosity_level > 0) {
 					u_fprintf(ux_stderr, "Progress: L:%u, W:%u, C:%u, R:%u\r", lines, numWindows, numCohorts, numReadings);
@@ -300,7 +301,7 @@ void PlaintextApplicator::runGrammarOnText(std::istream& input, std::ostream& ou
 	gWindow->shuffleWindowsDown();
 	while (!gWindow->previous.empty()) {
 		SingleWindow* tmp = gWindow->previous.front();
-		printSingleWindow(tmp, output);
+		outputSingleWindow(tmp, output);
 		free_swindow(tmp);
 		gWindow->previous.erase(gWindow->previous.begin());
 	}
@@ -31,6 +31,10 @@ void Profiler::read(const char* fname) {
 	throw std::runtime_error("Profiling disabled");
 }
 
+void Profiler::writeCheckpoint() {
+	throw std::runtime_error("Profiling disabled");
+}
+
 }
 
 #else
@@ -62,7 +66,7 @@ void Profiler::write(const char* fname) {
 		"PRAGMA synchronous = OFF",
 		"CREATE TABLE strings (key INTEGER PRIMARY KEY NOT NULL, value TEXT NOT NULL)",
 		"CREATE TABLE grammars (fname INTEGER PRIMARY KEY NOT NULL, grammar INTEGER NOT NULL)",
-		"CREATE TABLE entries (type INTEGER NOT NULL, id INTEGER NOT NULL, grammar INTEGER NOT NULL, b INTEGER NOT NULL, e INTEGER NOT NULL, num_match INTEGER NOT NULL, num_fail INTEGER NOT NULL, example_window INTEGER NOT NULL, PRIMARY KEY (type, id))",
+		"CREATE TABLE entries (type INTEGER NOT NULL, id INTEGER NOT NULL, grammar INTEGER NOT NULL, b INTEGER NOT NULL, e INTEGER NOT NULL, num_match INTEGER NOT NULL, num_fail INTEGER NOT NULL, example_window INTEGER NOT NULL, time INTEGER NOT NULL DEFAULT 0, line INTEGER NOT NULL DEFAULT 0, PRIMARY KEY (type, id))",
 		"CREATE TABLE rule_contexts (rule INTEGER NOT NULL, context INTEGER NOT NULL, num_match INTEGER NOT NULL, PRIMARY KEY (rule, context))",
 		"BEGIN",
 	};
@@ -113,7 +117,7 @@ void Profiler::write(const char* fname) {
 	sqlite3_finalize(s);
 
 	// Entries
-	if (sqlite3_prepare_v2(db, "INSERT INTO entries (type, id, grammar, b, e, num_match, num_fail, example_window) VALUES(:type, :id, :grammar, :b, :e, :num_match, :num_fail, :example_window)", -1, &s, nullptr) != SQLITE_OK) {
+	if (sqlite3_prepare_v2(db, "INSERT INTO entries (type, id, grammar, b, e, num_match, num_fail, example_window, time, line) VALUES(:type, :id, :grammar, :b, :e, :num_match, :num_fail, :example_window, :time, :line)", -1, &s, nullptr) != SQLITE_OK) {
 		throw std::runtime_error(concat("sqlite3 error preparing insert into entries table: ", sqlite3_errmsg(db)));
 	}
 	for (auto& it : entries) {
@@ -142,6 +146,12 @@ void Profiler::write(const char* fname) {
 		if (sqlite3_bind_int64(s, 8, it.second.example_window) != SQLITE_OK) {
 			throw std::runtime_error(concat("sqlite3 error trying to bind int64 for example_window: ", sqlite3_errmsg(db)));
 		}
+		if (sqlite3_bind_int64(s, 9, SI64(it.second.time)) != SQLITE_OK) {
+			throw std::runtime_error(concat("sqlite3 error trying to bind int64 for time: ", sqlite3_errmsg(db)));
+		}
+		if (sqlite3_bind_int64(s, 10, it.second.line) != SQLITE_OK) {
+			throw std::runtime_error(concat("sqlite3 error trying to bind int64 for line: ", sqlite3_errmsg(db)));
+		}
 		if (sqlite3_step(s) != SQLITE_DONE) {
 			throw std::runtime_error(concat("sqlite3 error inserting into entries table: ", sqlite3_errmsg(db)));
 		}
@@ -172,7 +182,7 @@ void Profiler::write(const char* fname) {
 	// Erase contexts that only exist as linked part of a larger context
 	// Such contexts are currently irrelevant and just get in the way
 	for (int i = 0; i < 10; ++i) {
-		if (sqlite3_exec(db, "DELETE FROM entries WHERE type = 1 AND id IN (SELECT id FROM entries as et INNER JOIN (SELECT max(b) as b, e FROM entries WHERE type = 1 GROUP BY e HAVING count(b) > 1) as jt ON (et.b = jt.b AND et.e = jt.e))") != SQLITE_OK) {
+		if (sqlite3_exec(db, "DELETE FROM entries WHERE type = 1 AND id IN (SELECT id FROM entries as et INNER JOIN (SELECT max(b) as b, e FROM entries WHERE type = 1 AND e > 0 GROUP BY e HAVING count(b) > 1) as jt ON (et.b = jt.b AND et.e = jt.e))") != SQLITE_OK) {
 			throw std::runtime_error(concat("sqlite3 error while deleting overlapping contexts: ", sqlite3_errmsg(db)));
 		}
 	}
@@ -180,6 +190,20 @@ void Profiler::write(const char* fname) {
 	if (sqlite3_exec(db, "COMMIT") != SQLITE_OK) {
 		throw std::runtime_error(concat("sqlite3 error while committing: ", sqlite3_errmsg(db)));
 	}
+	// Checkpoints write the database many times over, so the handle must not linger
+	sqlite3_close(db);
+}
+
+void Profiler::writeCheckpoint() {
+	// Readers never see a half-written database
+	auto tmp = checkpoint_fname + ".tmp";
+	write(tmp.c_str());
+#ifdef _WIN32
+	remove(checkpoint_fname.c_str());
+#endif
+	if (rename(tmp.c_str(), checkpoint_fname.c_str()) != 0) {
+		throw std::runtime_error(concat("Could not rename ", tmp, " to ", checkpoint_fname));
+	}
 }
 
 void Profiler::read(const char* fname) {
@@ -232,6 +256,13 @@ void Profiler::read(const char* fname) {
 		e.num_match = UIZ(sqlite3_column_int64(s, 5));
 		e.num_fail = UIZ(sqlite3_column_int64(s, 6));
 		e.example_window = UIZ(sqlite3_column_int64(s, 7));
+		// Databases from before timing was added have no time column, and those from before sampling have no line column
+		if (sqlite3_column_count(s) > 8) {
+			e.time = UI64(sqlite3_column_int64(s, 8));
+		}
+		if (sqlite3_column_count(s) > 9) {
+			e.line = UI32(sqlite3_column_int64(s, 9));
+		}
 	}
 	sqlite3_finalize(s);
 
@@ -245,6 +276,7 @@ void Profiler::read(const char* fname) {
 		rule_contexts[std::pair(r,c)] = UIZ(sqlite3_column_int64(s, 2));
 	}
 	sqlite3_finalize(s);
+	sqlite3_close(db);
 }
 
 }
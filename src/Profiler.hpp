@@ -25,15 +25,19 @@
 #include <string_view>
 #include <map>
 #include <sstream>
+#include <chrono>
 
 namespace CG3 {
 
 enum : uint8_t {
 	ET_RULE = 0,
 	ET_CONTEXT = 1,
+	ET_SECTION = 2,
 };
 
 struct Profiler {
+	typedef std::chrono::steady_clock clock;
+
 	std::map<std::string, size_t, std::less<>> strings;
 	std::map<size_t, size_t> grammars;
 	size_t grammar_ast = 0;
@@ -59,6 +63,9 @@ struct Profiler {
 		size_t num_match = 0;
 		size_t num_fail = 0;
 		size_t example_window = 0;
+		// Nanoseconds spent, including whatever ran nested inside
+		uint64_t time = 0;
+		uint32_t line = 0;
 	};
 	std::map<Key, Entry> entries;
 	std::map<std::pair<uint32_t, uint32_t>, size_t> rule_contexts;
@@ -92,6 +99,22 @@ struct Profiler {
 		}
 	}
 
+	// Sampling keeps no example windows, and rewrites the database now and then so a long-running process can be looked at any time
+	bool examples = true;
+	std::string checkpoint_fname;
+	clock::time_point last_checkpoint = clock::now();
+	void checkpoint() {
+		if (!checkpoint_fname.empty() && since(last_checkpoint) >= UI64(60) * 1000000000) {
+			writeCheckpoint();
+			last_checkpoint = clock::now();
+		}
+	}
+	void writeCheckpoint();
+
+	static uint64_t since(clock::time_point start) {
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count());
+	}
+
 	void write(const char* fname);
 
 	void read(const char* fname);
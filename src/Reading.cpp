@@ -53,10 +53,9 @@ Reading* alloc_reading(const Reading& o) {
 		r->baseform = o.baseform;
 		r->hash = o.hash;
 		r->hash_plain = o.hash_plain;
+		r->hash_check = o.hash_check;
 		r->number = o.number + 100;
-		r->tags_bloom = o.tags_bloom;
 		r->tags_plain_bloom = o.tags_plain_bloom;
-		r->tags_textual_bloom = o.tags_textual_bloom;
 		r->mapping = o.mapping;
 		r->parent = o.parent;
 		r->next = o.next;
@@ -110,10 +109,9 @@ Reading::Reading(const Reading& r)
   , baseform(r.baseform)
   , hash(r.hash)
   , hash_plain(r.hash_plain)
+  , hash_check(r.hash_check)
   , number(r.number + 100)
-  , tags_bloom(r.tags_bloom)
   , tags_plain_bloom(r.tags_plain_bloom)
-  , tags_textual_bloom(r.tags_textual_bloom)
   , mapping(r.mapping)
   , parent(r.parent)
   , next(r.next)
@@ -154,10 +152,9 @@ void Reading::clear() {
 	baseform = 0;
 	hash = 0;
 	hash_plain = 0;
+	hash_check = 0;
 	number = 0;
-	tags_bloom.clear();
 	tags_plain_bloom.clear();
-	tags_textual_bloom.clear();
 	mapping = nullptr;
 	parent = nullptr;
 	free_reading(next);
@@ -183,10 +180,9 @@ Reading& Reading::operator=(const Reading& r) {
 	baseform = r.baseform;
 	hash = r.hash;
 	hash_plain = r.hash_plain;
+	hash_check = r.hash_check;
 	number = r.number;
-	tags_bloom = r.tags_bloom;
 	tags_plain_bloom = r.tags_plain_bloom;
-	tags_textual_bloom = r.tags_textual_bloom;
 	mapping = r.mapping;
 	parent = r.parent;
 	next = r.next;
@@ -212,10 +208,12 @@ Reading* Reading::allocateReading(const Reading& r) {
 uint32_t Reading::rehash() {
 	hash = 0;
 	hash_plain = 0;
+	hash_check = 0;
 	for (auto iter : tags) {
 		if (!mapping || mapping->hash != iter) {
 			hash = hash_value(iter, hash);
 		}
+		hash_check = hash_value((UI64(hash_check) << 32) | iter);
 	}
 	hash_plain = hash;
 	if (mapping) {
@@ -224,6 +222,7 @@ uint32_t Reading::rehash() {
 	if (next) {
 		next->rehash();
 		hash = hash_value(next->hash, hash);
+		hash_check = hash_value((UI64(hash_check) << 32) | next->hash_check);
 	}
 	return hash;
 }
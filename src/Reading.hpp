@@ -45,10 +45,10 @@ public:
 	uint32_t baseform = 0;
 	uint32_t hash = 0;
 	uint32_t hash_plain = 0;
+	// The same tags through an unrelated hash function, so caches keyed on hash can tell apart readings it collides for
+	uint32_t hash_check = 0;
 	uint32_t number = 0;
-	uint32Bloomish tags_bloom;
 	uint32Bloomish tags_plain_bloom;
-	uint32Bloomish tags_textual_bloom;
 	Tag* mapping = nullptr;
 	Cohort* parent = nullptr;
 	Reading* next = nullptr;
@@ -114,9 +114,11 @@ public:
 	Set* sublist = nullptr;
 	RuleVector sub_rules;
 
-	mutable ContextList tests;
-	mutable ContextList dep_tests;
-	mutable ContextualTest* dep_target = nullptr;
+	ContextList tests;
+	// Sets that some cohort in the target's window must be able to match for the tests to have any chance
+	uint32SortedVector required_sets;
+	ContextList dep_tests;
+	ContextualTest* dep_target = nullptr;
 
 	Rule() = default;
 	~Rule() = default;
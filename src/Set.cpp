@@ -26,7 +26,7 @@ namespace CG3 {
 std::ostream* Set::dump_hashes_out = nullptr;
 
 bool Set::empty() const {
-	return (ff_tags.empty() && trie.empty() && trie_special.empty() && sets.empty());
+	return (ff_tags.empty() && trie.empty() && trie_flat.empty() && trie_special.empty() && sets.empty());
 }
 
 void Set::setName(uint32_t to) {
@@ -54,6 +54,9 @@ public:
 
 	trie_t trie;
 	trie_t trie_special;
+	// Read-only copy of trie for matching, and the hashes of its first level so matching can intersect two plain arrays; both filled by Grammar::reindex(), or borrowed from a mapped binary grammar which then leaves trie empty
+	flat_trie_t trie_flat;
+	frozen_array<uint32_t> trie_keys;
 	TagSortedVector ff_tags;
 
 	uint32Vector set_ops;
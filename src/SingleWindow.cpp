@@ -129,6 +129,7 @@ void SingleWindow::clear() {
 	for (auto& cs : rule_to_cohorts) {
 		cs.clear();
 	}
+	possible_sets.clear();
 	variables_set.clear();
 	variables_rem.clear();
 	variables_output.clear();
@@ -44,6 +44,8 @@ public:
 	uint32IntervalVector valid_rules;
 	uint32SortedVector hit_external;
 	std::vector<CohortSet> rule_to_cohorts;
+	// Union of the cohorts' possible_sets, possibly with a few more that no longer apply
+	boost::dynamic_bitset<> possible_sets;
 	// Used by GrammarApplicator::runSingleRule so that it doesn't need to allocate a new one or edit a rule's actual list when applying a subrule of WITH
 	std::unique_ptr<CohortSet> nested_rule_to_cohorts;
 	uint32FlatHashMap variables_set;
@@ -20,6 +20,7 @@
 #include "Tag.hpp"
 #include "Set.hpp"
 #include "Grammar.hpp"
+#include "GrammarApplicator.hpp"
 #include "Strings.hpp"
 #include "MathParser.hpp"
 
@@ -39,6 +40,7 @@ Tag::Tag(const Tag& o)
   , number(o.number)
   , seed(o.seed)
   , tag(o.tag)
+  , tag_u8(o.tag_u8)
   , regexp(nullptr)
 {
 	#ifdef CG_TRACE_OBJECTS
@@ -53,6 +55,9 @@ Tag::Tag(const Tag& o)
 		allocateVsSets();
 		*vs_sets.get() = *o.vs_sets.get();
 	}
+	if (o.regexp_src) {
+		regexp_src.reset(new UString(*o.regexp_src));
+	}
 	if (o.regexp) {
 		UErrorCode status = U_ZERO_ERROR;
 		regexp = uregex_clone(o.regexp, &status);
@@ -70,7 +75,253 @@ Tag::~Tag() {
 	}
 }
 
+UStringView Tag::regexpPattern() const {
+	if (regexp_src) {
+		return *regexp_src;
+	}
+	int32_t len = 0;
+	UErrorCode status = U_ZERO_ERROR;
+	const UChar* p = uregex_pattern(regexp, &len, &status);
+	return UStringView(p, len);
+}
+
+// Returns a new regex object for this tag, cloned from the compiled one if there is one, so that callers can match independently
+URegularExpression* Tag::openRegexp(UErrorCode& status) const {
+	if (regexp) {
+		return uregex_clone(regexp, &status);
+	}
+	UParseError pe;
+	return uregex_open(regexp_src->data(), SI32(regexp_src->size()), (type & T_CASE_INSENSITIVE) ? UREGEX_CASE_INSENSITIVE : 0, &pe, &status);
+}
+
+// Not thread-safe, so grammar tags must only be compiled before applicators share the grammar
+void Tag::compileRegexp(UErrorCode& status) const {
+	if (!regexp && regexp_src) {
+		regexp = openRegexp(status);
+	}
+}
+
+/**
+ * Finds the longest run of characters that any text matched by the tag's regex must contain, for prefiltering.
+ *
+ * Groups, classes, and escapes other than escaped punctuation end a run, and alternation or inline flags give up,
+ * so the result is empty rather than wrong for anything not understood. Case-insensitive regexes also give nothing.
+ */
+UString Tag::regexpLiteral() const {
+	UString best;
+	if (!hasRegexp() || (type & T_CASE_INSENSITIVE)) {
+		return best;
+	}
+	auto rx = regexpPattern();
+	const size_t n = rx.size();
+	UString cur;
+	auto end_run = [&]() {
+		if (cur.size() > best.size()) {
+			best = cur;
+		}
+		cur.clear();
+	};
+	// Return the position just past the class or group starting at i, or npos if it isn't closed
+	auto skip_class = [&](size_t i) {
+		size_t depth = 1;
+		++i;
+		if (i < n && rx[i] == '^') {
+			++i;
+		}
+		if (i < n && rx[i] == ']') {
+			++i;
+		}
+		for (; i < n; ++i) {
+			if (rx[i] == '\\') {
+				++i;
+			}
+			else if (rx[i] == '[') {
+				++depth;
+			}
+			else if (rx[i] == ']' && --depth == 0) {
+				return i + 1;
+			}
+		}
+		return UString::npos;
+	};
+	auto skip_group = [&](size_t i) {
+		size_t depth = 1;
+		for (++i; i < n; ++i) {
+			if (rx[i] == '\\') {
+				++i;
+			}
+			else if (rx[i] == '[') {
+				i = skip_class(i);
+				if (i == UString::npos) {
+					return i;
+				}
+				--i;
+			}
+			else if (rx[i] == '(') {
+				++depth;
+			}
+			else if (rx[i] == ')' && --depth == 0) {
+				return i + 1;
+			}
+		}
+		return UString::npos;
+	};
+
+	for (size_t i = 0; i < n;) {
+		UChar c = rx[i];
+		size_t len = 1;
+		bool literal = false;
+		UStringView atom;
+		if (c == '|' || c == ')' || c == '*' || c == '+' || c == '?' || c == '{') {
+			return UString();
+		}
+		else if (c == '\\') {
+			if (i + 1 >= n) {
+				return UString();
+			}
+			UChar e = rx[i + 1];
+			len = 2;
+			if (!u_isalnum(e)) {
+				literal = true;
+				atom = rx.substr(i + 1, 1);
+			}
+			else if (e == 'Q') {
+				auto q = rx.find(u"\\E", i + 2);
+				if (q == UString::npos) {
+					return UString();
+				}
+				len = q + 2 - i;
+			}
+			else if ((e == 'p' || e == 'P' || e == 'N' || e == 'x') && i + 2 < n && rx[i + 2] == '{') {
+				auto q = rx.find('}', i + 2);
+				if (q == UString::npos) {
+					return UString();
+				}
+				len = q + 1 - i;
+			}
+			else if (e == 'k' && i + 2 < n && rx[i + 2] == '<') {
+				auto q = rx.find('>', i + 2);
+				if (q == UString::npos) {
+					return UString();
+				}
+				len = q + 1 - i;
+			}
+			else if (e == 'p' || e == 'P' || e == 'c') {
+				len = 3;
+			}
+			else if (e == 'x') {
+				len = 4;
+			}
+			else if (e == 'u') {
+				len = 6;
+			}
+			else if (e == 'U') {
+				len = 10;
+			}
+			else if (u_isdigit(e)) {
+				while (i + len < n && u_isdigit(rx[i + len])) {
+					++len;
+				}
+			}
+		}
+		else if (c == '[') {
+			auto q = skip_class(i);
+			if (q == UString::npos) {
+				return UString();
+			}
+			len = q - i;
+		}
+		else if (c == '(') {
+			if (i + 2 < n && rx[i + 1] == '?' && (u_isalpha(rx[i + 2]) || rx[i + 2] == '-')) {
+				return UString();
+			}
+			auto q = skip_group(i);
+			if (q == UString::npos) {
+				return UString();
+			}
+			len = q - i;
+		}
+		else if (c != '.' && c != '^' && c != '$') {
+			literal = true;
+			if (U16_IS_LEAD(c) && i + 1 < n && U16_IS_TRAIL(rx[i + 1])) {
+				len = 2;
+			}
+			atom = rx.substr(i, len);
+		}
+		i += len;
+
+		size_t min = 1;
+		if (i < n && (rx[i] == '*' || rx[i] == '?')) {
+			min = 0;
+			++i;
+		}
+		else if (i < n && rx[i] == '+') {
+			min = 2;
+			++i;
+		}
+		else if (i < n && rx[i] == '{') {
+			min = (i + 1 < n && rx[i + 1] == '0') ? 0 : 2;
+			auto q = rx.find('}', i);
+			if (q == UString::npos) {
+				return UString();
+			}
+			i = q + 1;
+		}
+		if (min != 1 && i < n && (rx[i] == '?' || rx[i] == '+')) {
+			++i;
+		}
+
+		if (!literal || min == 0) {
+			end_run();
+		}
+		else {
+			cur.append(atom);
+			// Repeated, so whatever follows isn't necessarily adjacent
+			if (min > 1) {
+				end_run();
+			}
+		}
+	}
+	end_run();
+	return best;
+}
+
+template<typename RX, typename IC>
+inline bool matchesTextual(const UString& tag, const RX& regex_tags, const IC& icase_tags) {
+	for (auto& iter : regex_tags) {
+		if (!iter.second.empty() && tag.find(iter.second) == UString::npos) {
+			continue;
+		}
+		UErrorCode status = U_ZERO_ERROR;
+		uregex_setText(iter.first, tag.data(), SI32(tag.size()), &status);
+		if (status == U_ZERO_ERROR) {
+			if (uregex_find(iter.first, -1, &status)) {
+				return true;
+			}
+		}
+	}
+	for (auto iter : icase_tags) {
+		if (ux_strCaseCompare(tag, iter->tag)) {
+			return true;
+		}
+	}
+	return false;
+}
+
 void Tag::parseTagRaw(const UChar* to, Grammar* grammar) {
+	parseTagRaw(to,
+		[&](const UString& str) { return matchesTextual(str, grammar->regex_tags, grammar->icase_tags); },
+		[&](const UChar* txt) { return grammar->allocateTag(txt); });
+}
+
+void Tag::parseTagRaw(const UChar* to, GrammarApplicator& applicator) {
+	parseTagRaw(to,
+		[&](const UString& str) { return matchesTextual(str, applicator.regex_tags, applicator.icase_tags); },
+		[&](const UChar* txt) { return applicator.addTag(txt); });
+}
+
+template<typename IsTextual, typename AllocTag>
+void Tag::parseTagRaw(const UChar* to, IsTextual&& is_textual, AllocTag&& alloc_tag) {
 	type = 0;
 	const size_t length = u_strlen(to);
 	assert(length && "parseTagRaw() will not work with empty strings.");
@@ -91,19 +342,8 @@ void Tag::parseTagRaw(const UChar* to, Grammar* grammar) {
 
 	tag.assign(to, length);
 
-	for (auto iter : grammar->regex_tags) {
-		UErrorCode status = U_ZERO_ERROR;
-		uregex_setText(iter, tag.data(), SI32(tag.size()), &status);
-		if (status == U_ZERO_ERROR) {
-			if (uregex_find(iter, -1, &status)) {
-				type |= T_TEXTUAL;
-			}
-		}
-	}
-	for (auto iter : grammar->icase_tags) {
-		if (ux_strCaseCompare(tag, iter->tag)) {
-			type |= T_TEXTUAL;
-		}
+	if (is_textual(tag)) {
+		type |= T_TEXTUAL;
 	}
 
 	if (tag[0] == '<' && tag[length - 1] == '>') {
@@ -128,7 +368,7 @@ void Tag::parseTagRaw(const UChar* to, Grammar* grammar) {
 		dep_parent = std::numeric_limits<uint32_t>::max();
 		if (u_sscanf(tag.data(), "R:%[^:]:%i", &relname, &dep_parent) == 2 && dep_parent != std::numeric_limits<uint32_t>::max()) {
 			type |= T_RELATION;
-			Tag* reltag = grammar->allocateTag(relname);
+			Tag* reltag = alloc_tag(relname);
 			comparison_hash = reltag->hash;
 		}
 	}
@@ -310,6 +550,15 @@ void Tag::allocateVsNames() {
 	}
 }
 
+void Tag::cacheUTF8() {
+	int32_t len = 0;
+	UErrorCode status = U_ZERO_ERROR;
+	u_strToUTF8(nullptr, 0, &len, tag.data(), SI32(tag.size()), &status);
+	tag_u8.resize(len);
+	status = U_ZERO_ERROR;
+	u_strToUTF8(&tag_u8[0], len, nullptr, tag.data(), SI32(tag.size()), &status);
+}
+
 UString Tag::toUString(bool escape) const {
 	if (!tag_raw.empty()) {
 		return tag_raw;
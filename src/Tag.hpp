@@ -27,6 +27,7 @@
 
 namespace CG3 {
 class Grammar;
+class GrammarApplicator;
 class Set;
 
 using SetVector = std::vector<Set*>;
@@ -98,23 +99,50 @@ public:
 	uint32_t plain_hash = 0;
 	uint32_t number = 0;
 	uint32_t seed = 0;
+	// Epoch of the last lookup for tags created while applying a grammar; 0 for grammar tags and others that must never be reclaimed
+	uint32_t epoch = 0;
 	UString tag;
 	UString tag_raw;
+	// The tag as UTF-8, so that printing it needs no conversion
+	std::string tag_u8;
 	std::unique_ptr<SetVector> vs_sets;
 	std::unique_ptr<UStringVector> vs_names;
+	// Source of a regex that hasn't been compiled yet; binary grammars leave compiling to first use
+	std::unique_ptr<UString> regexp_src;
 	mutable URegularExpression* regexp = nullptr;
 
 	Tag() = default;
 	Tag(const Tag& o);
 	~Tag();
 	void parseTagRaw(const UChar* to, Grammar* grammar);
+	void parseTagRaw(const UChar* to, GrammarApplicator& applicator);
 	UString toUString(bool escape = false) const;
+	void cacheUTF8();
+
+	// Writes the tag as UTF-8, minus lead and trail ASCII characters such as the quotes of baseforms
+	void printUTF8(std::ostream& output, size_t lead = 0, size_t trail = 0) const {
+		if (tag_u8.size() >= lead + trail) {
+			output.write(tag_u8.data() + lead, tag_u8.size() - lead - trail);
+		}
+	}
 
 	uint32_t rehash();
 	void markUsed();
 	void allocateVsSets();
 	void allocateVsNames();
 	void parseNumeric(bool trusted = false);
+
+	bool hasRegexp() const {
+		return regexp || regexp_src;
+	}
+	UStringView regexpPattern() const;
+	UString regexpLiteral() const;
+	URegularExpression* openRegexp(UErrorCode& status) const;
+	void compileRegexp(UErrorCode& status) const;
+
+private:
+	template<typename IsTextual, typename AllocTag>
+	void parseTagRaw(const UChar* to, IsTextual&& is_textual, AllocTag&& alloc_tag);
 };
 
 struct compare_Tag {
@@ -133,6 +161,8 @@ using TagVector = std::vector<Tag*>;
 using TagList = TagVector;
 using Taguint32HashMap = flat_unordered_map<uint32_t, Tag*>;
 using TagSortedVector = sorted_vector<Tag*, compare_Tag>;
+// Regexes that can make other tags textual, each with a literal that any text it matches contains, or empty if unknown
+using TextualRegexes = std::map<URegularExpression*, UString>;
 
 struct compare_TagVector {
 	inline bool operator()(const TagVector& a, const TagVector& b) const {
@@ -23,6 +23,7 @@
 
 #include "stdafx.hpp"
 #include "Tag.hpp"
+#include "frozen_array.hpp"
 
 namespace CG3 {
 struct trie_node_t;
@@ -33,6 +34,21 @@ struct trie_node_t {
 	std::unique_ptr<trie_t> trie;
 };
 
+/**
+ * One record of a trie compiled by trie_flatten(). A record's children are the count records starting at first,
+ * sorted by hash just like the trie_t they came from.
+ *
+ * Binary grammars store these records as they are, so the layout must stay four plain 32 bit words.
+ */
+struct flat_trie_node_t {
+	uint32_t hash = 0;
+	uint32_t first = 0;
+	uint32_t count = 0;
+	uint32_t terminal = 0;
+};
+static_assert(sizeof(flat_trie_node_t) == 16, "flat_trie_node_t is stored verbatim in binary grammars");
+typedef frozen_array<flat_trie_node_t> flat_trie_t;
+
 inline bool trie_insert(trie_t& trie, const TagVector& tv, size_t w = 0) {
 	trie_node_t& node = trie[tv[w]];
 	if (node.terminal) {
@@ -236,6 +252,93 @@ inline TagVectorSet trie_getTagsOrdered(const trie_t& trie) {
 	return rv;
 }
 
+// Lays the trie out breadth first in one array, so the first level is at the front and siblings are always adjacent
+inline void trie_flatten(const trie_t& trie, flat_trie_t& flat) {
+	std::vector<flat_trie_node_t> nodes;
+	std::vector<const trie_t*> subs;
+	auto append = [&](const trie_t& t) {
+		for (auto& kv : t) {
+			nodes.emplace_back();
+			nodes.back().hash = kv.first->hash;
+			nodes.back().terminal = kv.second.terminal;
+			subs.push_back(kv.second.trie.get());
+		}
+	};
+	append(trie);
+	for (size_t i = 0; i < nodes.size(); ++i) {
+		if (subs[i] && !subs[i]->empty()) {
+			nodes[i].first = UI32(nodes.size());
+			nodes[i].count = UI32(subs[i]->size());
+			append(*subs[i]);
+		}
+	}
+	flat.assign(std::move(nodes));
+}
+
+// Number of first-level records in a flattened trie; the first record with children points just past them
+inline size_t trie_roots(const flat_trie_t& flat) {
+	for (auto& n : flat) {
+		if (n.count) {
+			return n.first;
+		}
+	}
+	return flat.size();
+}
+
+inline void trie_getTagList(const flat_trie_t& flat, const Taguint32HashMap& tags, TagList& theTags, uint32_t first, uint32_t count) {
+	for (auto i = first; i < first + count; ++i) {
+		theTags.push_back(tags.find(flat[i].hash)->second);
+		if (flat[i].count) {
+			trie_getTagList(flat, tags, theTags, flat[i].first, flat[i].count);
+		}
+	}
+}
+
+// Lists the tags in the same order as trie_getTagList() would for the trie the records came from
+inline void trie_getTagList(const flat_trie_t& flat, const Taguint32HashMap& tags, TagList& theTags) {
+	trie_getTagList(flat, tags, theTags, 0, UI32(trie_roots(flat)));
+}
+
+inline void trie_unflatten(const flat_trie_t& flat, const Taguint32HashMap& tags, trie_t& trie, uint32_t first, uint32_t count) {
+	trie.reserve(trie.size() + count);
+	for (auto i = first; i < first + count; ++i) {
+		trie_node_t& node = trie[tags.find(flat[i].hash)->second];
+		node.terminal = (flat[i].terminal != 0);
+		if (flat[i].count) {
+			if (!node.trie) {
+				node.trie.reset(new trie_t);
+			}
+			trie_unflatten(flat, tags, *node.trie, flat[i].first, flat[i].count);
+		}
+	}
+}
+
+// Rebuilds the mutable trie that a flattened one came from, for the few tools that edit a loaded grammar
+inline void trie_unflatten(const flat_trie_t& flat, const Taguint32HashMap& tags, trie_t& trie) {
+	trie_unflatten(flat, tags, trie, 0, UI32(trie_roots(flat)));
+}
+
+// Finds the tags on the path to a record of a flattened trie, by walking up through the records whose children span it
+inline bool trie_getTagList(const flat_trie_t& flat, const Taguint32HashMap& tags, TagList& theTags, const void* node) {
+	auto it = std::find_if(flat.begin(), flat.end(), [&](const flat_trie_node_t& n) { return &n == node; });
+	if (it == flat.end()) {
+		return false;
+	}
+	auto at = theTags.size();
+	for (auto i = UI32(std::distance(flat.begin(), it));;) {
+		theTags.insert(theTags.begin() + at, tags.find(flat[i].hash)->second);
+		auto p = i;
+		while (p > 0 && !(flat[p - 1].first <= i && i < flat[p - 1].first + flat[p - 1].count)) {
+			--p;
+		}
+		if (p == 0) {
+			break;
+		}
+		i = p - 1;
+	}
+	return true;
+}
+
 inline void trie_serialize(const trie_t& trie, std::ostream& out) {
 	for (auto& kv : trie) {
 		writeBE<uint32_t>(out, kv.first->number);
@@ -22,6 +22,7 @@
 #define c6d28b7452ec699b_TEXTUALPARSER_H
 
 #include "IGrammarParser.hpp"
+#include "Grammar.hpp"
 #include "Profiler.hpp"
 #include "Strings.hpp"
 #include "sorted_vector.hpp"
@@ -56,6 +57,9 @@ public:
 	[[noreturn]] void error(const char* str, const char* s, const UChar* S, const UChar* p);
 	Tag* addTag(Tag* tag);
 	Grammar* get_grammar() { return result; }
+	Taguint32HashMap& get_tags() { return result->single_tags; }
+	Grammar::regex_tags_t& get_regex_tags() { return result->regex_tags; }
+	Grammar::icase_tags_t& get_icase_tags() { return result->icase_tags; }
 	const char* filebase = nullptr;
 	uint32SortedVector strict_tags;
 	uint32SortedVector list_tags;
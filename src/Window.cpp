@@ -72,6 +72,11 @@ SingleWindow* Window::allocAppendSingleWindow() {
 		swindow->previous = next.back();
 		next.back()->next = swindow;
 	}
+	// Windows may be run as soon as they are read, if the grammar doesn't look ahead
+	else if (current) {
+		swindow->previous = current;
+		current->next = swindow;
+	}
 	next.push_back(swindow);
 	return swindow;
 }
@@ -22,6 +22,7 @@
 #define c6d28b7452ec699b_WINDOW_H
 
 #include "stdafx.hpp"
+#include "sliding_map.hpp"
 
 namespace CG3 {
 class GrammarApplicator;
@@ -37,9 +38,9 @@ public:
 	uint32_t window_counter = 0;
 	uint32_t window_span = 0;
 
-	std::map<uint32_t, Cohort*> cohort_map;
+	sliding_map<Cohort> cohort_map;
 	uint32FlatHashMap dep_map;
-	std::map<uint32_t, Cohort*> dep_window;
+	sliding_map<Cohort> dep_window;
 	uint32FlatHashMap relation_map;
 
 	SingleWindowCont previous;
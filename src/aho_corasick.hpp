@@ -0,0 +1,160 @@
+/*
+* Copyright (C) 2007-2025, GrammarSoft ApS
+* Developed by Tino Didriksen <mail@tinodidriksen.com>
+* Design by Eckhard Bick <eckhard.bick@mail.dk>, Tino Didriksen <mail@tinodidriksen.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this progam.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#ifndef c6d28b7452ec699b_AHO_CORASICK_HPP
+#define c6d28b7452ec699b_AHO_CORASICK_HPP
+#include <vector>
+#include <deque>
+#include <string_view>
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include <cstdint>
+
+namespace CG3 {
+
+/**
+ * Finds which of a fixed set of strings occur in a text, in one pass over the text regardless of how many strings there are.
+ *
+ * Strings are numbered in the order they are first added, and adding the same string again yields the same number.
+ * After build(), find() calls back with the number of each string once for every place it occurs in the text.
+ * Adding more strings afterwards requires another build().
+ */
+template<typename Char>
+class aho_corasick {
+public:
+	typedef std::basic_string_view<Char> string_view;
+	static constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+
+	aho_corasick() {
+		clear();
+	}
+
+	void clear() {
+		nodes.clear();
+		nodes.resize(1);
+		num_strings = 0;
+	}
+
+	size_t size() const {
+		return num_strings;
+	}
+
+	bool empty() const {
+		return num_strings == 0;
+	}
+
+	uint32_t add(string_view str) {
+		uint32_t n = 0;
+		for (auto c : str) {
+			auto& next = nodes[n].next;
+			auto it = std::lower_bound(next.begin(), next.end(), c, edge_less);
+			if (it != next.end() && it->first == c) {
+				n = it->second;
+				continue;
+			}
+			auto nn = static_cast<uint32_t>(nodes.size());
+			next.insert(it, edge(c, nn));
+			nodes.emplace_back();
+			n = nn;
+		}
+		if (nodes[n].string == NONE) {
+			nodes[n].string = num_strings++;
+		}
+		return nodes[n].string;
+	}
+
+	// Links each node to the longest proper suffix of its path that is also in the trie, breadth first so that suffixes are done before the nodes that need them
+	void build() {
+		std::deque<uint32_t> todo;
+		for (auto& e : nodes[0].next) {
+			nodes[e.second].fail = 0;
+			nodes[e.second].out = NONE;
+			todo.push_back(e.second);
+		}
+		while (!todo.empty()) {
+			auto n = todo.front();
+			todo.pop_front();
+			for (auto& e : nodes[n].next) {
+				auto f = nodes[n].fail;
+				auto w = child(f, e.first);
+				while (w == NONE && f != 0) {
+					f = nodes[f].fail;
+					w = child(f, e.first);
+				}
+				auto& cn = nodes[e.second];
+				cn.fail = (w == NONE) ? 0 : w;
+				cn.out = (nodes[cn.fail].string != NONE) ? cn.fail : nodes[cn.fail].out;
+				todo.push_back(e.second);
+			}
+		}
+	}
+
+	template<typename F>
+	void find(string_view text, F&& found) const {
+		if (num_strings == 0) {
+			return;
+		}
+		uint32_t n = 0;
+		for (auto c : text) {
+			auto w = child(n, c);
+			while (w == NONE && n != 0) {
+				n = nodes[n].fail;
+				w = child(n, c);
+			}
+			n = (w == NONE) ? 0 : w;
+			for (auto o = (nodes[n].string != NONE) ? n : nodes[n].out; o != NONE; o = nodes[o].out) {
+				found(nodes[o].string);
+			}
+		}
+	}
+
+private:
+	typedef std::pair<Char, uint32_t> edge;
+
+	struct node {
+		// Sorted by character
+		std::vector<edge> next;
+		uint32_t fail = 0;
+		// Nearest node along the fail links that ends a string
+		uint32_t out = NONE;
+		uint32_t string = NONE;
+	};
+
+	std::vector<node> nodes;
+	uint32_t num_strings = 0;
+
+	static bool edge_less(const edge& e, Char c) {
+		return e.first < c;
+	}
+
+	uint32_t child(uint32_t n, Char c) const {
+		auto& next = nodes[n].next;
+		auto it = std::lower_bound(next.begin(), next.end(), c, edge_less);
+		if (it != next.end() && it->first == c) {
+			return it->second;
+		}
+		return NONE;
+	}
+};
+
+}
+
+#endif
@@ -21,62 +21,68 @@
 #define c6d28b7452ec699b_BLOOMISH_HPP
 #include <algorithm>
 #include <cstdint>
+#include <cstddef>
 
 namespace CG3 {
 
-template<typename Cont>
+/**
+ * A Bloom filter of Bits bits, each value setting K of them.
+ *
+ * Tag hashes are remixed before picking bits, so that the usual 15-30 tags of a reading still leave most of the filter
+ * clear and a miss reliably means the tag isn't there.
+ */
+template<size_t Bits = 256, size_t K = 3>
 class bloomish {
 private:
-	Cont value[4];
+	static constexpr size_t log2(size_t n) {
+		return n <= 1 ? 0 : 1 + log2(n / 2);
+	}
+	static constexpr size_t Words = Bits / 64;
+	static constexpr size_t Shift = log2(Bits);
+	static_assert(Bits >= 64 && (Bits & (Bits - 1)) == 0, "Bits must be a power of 2 of at least 64");
+	static_assert(K >= 1 && K * Shift <= 64, "K times log2(Bits) must fit in 64 bits");
+
+	uint64_t value[Words];
+
+	template<typename F>
+	static void each_bit(uint32_t v, F&& f) {
+		uint64_t h = (static_cast<uint64_t>(v) + 1) * UINT64_C(0x9E3779B97F4A7C15);
+		for (size_t i = 0; i < K; ++i) {
+			auto bit = (h >> (64 - (i + 1) * Shift)) & (Bits - 1);
+			f(bit / 64, UINT64_C(1) << (bit % 64));
+		}
+	}
 
 public:
 	bloomish() {
 		clear();
 	}
 
-	bloomish(const bloomish<Cont>& other) {
-		std::copy(other.value, other.value + 4, &value[0]);
+	bloomish(const bloomish& other) {
+		std::copy(other.value, other.value + Words, &value[0]);
 	}
 
-	bloomish& operator=(const bloomish<Cont>& other) {
-		std::copy(other.value, other.value + 4, &value[0]);
+	bloomish& operator=(const bloomish& other) {
+		std::copy(other.value, other.value + Words, &value[0]);
 		return *this;
 	}
 
 	void clear() {
-		std::fill(value, value + 4, static_cast<Cont>(0));
+		std::fill(value, value + Words, UINT64_C(0));
 	}
 
-	void insert(const Cont& v) {
-		if (v & 4) {
-			value[3] |= v;
-		}
-		else if (v & 2) {
-			value[2] |= v;
-		}
-		else if (v & 1) {
-			value[1] |= v;
-		}
-		else {
-			value[0] |= v;
-		}
+	void insert(uint32_t v) {
+		each_bit(v, [&](size_t w, uint64_t b) { value[w] |= b; });
 	}
 
-	bool matches(const Cont& v) const {
-		if (v & 4) {
-			return (value[3] & v) == v;
-		}
-		else if (v & 2) {
-			return (value[2] & v) == v;
-		}
-		else if (v & 1) {
-			return (value[1] & v) == v;
-		}
-		return (value[0] & v) == v;
+	bool matches(uint32_t v) const {
+		bool rv = true;
+		each_bit(v, [&](size_t w, uint64_t b) { rv &= (value[w] & b) != 0; });
+		return rv;
 	}
 };
 
-typedef bloomish<uint32_t> uint32Bloomish;
+typedef bloomish<> uint32Bloomish;
 }
 
 #endif
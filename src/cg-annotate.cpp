@@ -58,6 +58,12 @@ inline auto xml_encode(fs::path p) {
 	return xml_encode(p.string());
 }
 
+inline auto format_ms(uint64_t ns) {
+	char buf[32];
+	snprintf(buf, sizeof(buf), "%.3f", ns / 1e6);
+	return std::string(buf);
+}
+
 inline void file_save(fs::path fn, std::string_view data) {
 	std::ofstream file(fn.string(), std::ios::binary);
 	file.exceptions(std::ios::badbit | std::ios::failbit);
@@ -173,6 +179,11 @@ int main(int argc, char* argv[]) {
 						html += std::to_string(entry.num_match);
 						html += ", F:";
 						html += std::to_string(entry.num_fail);
+						if (entry.time) {
+							html += ", T:";
+							html += format_ms(entry.time);
+							html += "ms";
+						}
 					}
 					else {
 						std::pair k{ rid, eit->first.id };
@@ -312,6 +323,133 @@ int main(int argc, char* argv[]) {
 		}
 	}
 
+	// Table of where the time went, most expensive first
+	std::map<size_t, std::vector<size_t>> newlines;
+	for (auto& it : grammars) {
+		auto& nls = newlines[it.first];
+		for (int32_t i = 0; i < it.second.length(); ++i) {
+			if (it.second[i] == '\n') {
+				nls.push_back(UIZ(i));
+			}
+		}
+	}
+	std::map<size_t, std::string> grammar_names;
+	for (auto& it : profiler.grammars) {
+		grammar_names[it.second] = xml_encode(fs::path(strings[it.first]).filename());
+	}
+
+	std::vector<std::pair<const Profiler::Key, Profiler::Entry>*> timed;
+	for (auto& it : profiler.entries) {
+		timed.push_back(&it);
+	}
+	std::stable_sort(timed.begin(), timed.end(), [](auto a, auto b) {
+		return a->second.time > b->second.time;
+	});
+
+	html.clear();
+	html += R"X(<!DOCTYPE html>
+<html>
+<head>
+	<meta charset="UTF-8">
+	<title>Time per rule, context, and section</title>
+	<link rel="stylesheet" href="style.css">
+</head>
+<body>
+<table id="times">
+<thead><tr><th>Type</th><th>Grammar</th><th>Line</th><th>Text</th><th>Matches</th><th>Fails</th><th>Time (ms)</th></tr></thead>
+<tbody>
+)X";
+	for (auto it : timed) {
+		auto& e = it->second;
+		html += "<tr><td>";
+		if (e.type == ET_SECTION) {
+			auto section = static_cast<int32_t>(it->first.id);
+			html += "Section</td><td></td><td></td><td>";
+			if (section == -1) {
+				html += "BEFORE-SECTIONS";
+			}
+			else if (section == -2) {
+				html += "AFTER-SECTIONS";
+			}
+			else if (section == -3) {
+				html += "NULL-SECTION";
+			}
+			else {
+				html += "SECTION ";
+				html += std::to_string(section + 1);
+			}
+			html += "</td><td></td><td></td>";
+		}
+		else {
+			html += (e.type == ET_RULE) ? "Rule" : "Context";
+			html += "</td><td>";
+			// Sampled binary grammars have no source, only the line each rule and context came from
+			auto has_source = grammars.count(e.grammar) != 0;
+			if (has_source) {
+				html += grammar_names[e.grammar];
+			}
+			html += "</td><td>";
+			if (has_source) {
+				auto& nls = newlines[e.grammar];
+				html += std::to_string(std::upper_bound(nls.begin(), nls.end(), e.b) - nls.begin() + 1);
+			}
+			else if (e.line) {
+				html += std::to_string(e.line);
+			}
+			html += "</td><td class=\"pre-wrap\">";
+			if (e.example_window) {
+				html += (e.type == ET_RULE) ? "<a href=\"rs/" : "<a href=\"cs/";
+				html += std::to_string(it->first.id);
+				html += ".html\">";
+			}
+			buf.clear();
+			if (has_source) {
+				auto snip = grammars[e.grammar].tempSubString(SI32(e.b), SI32(std::min(e.e - e.b, UIZ(80))));
+				snip.toUTF8String(buf);
+				std::replace(buf.begin(), buf.end(), '\n', ' ');
+			}
+			else if (e.type == ET_RULE) {
+				buf = "rule ";
+				buf += std::to_string(it->first.id - 1);
+			}
+			html += xml_encode(buf);
+			if (e.example_window) {
+				html += "</a>";
+			}
+			html += "</td><td>";
+			html += std::to_string(e.num_match);
+			html += "</td><td>";
+			html += std::to_string(e.num_fail);
+			html += "</td>";
+		}
+		html += "<td>";
+		html += format_ms(e.time);
+		html += "</td></tr>\n";
+	}
+	html += R"X(</tbody>
+</table>
+<script>
+document.querySelectorAll('#times th').forEach(function(th, col) {
+	th.addEventListener('click', function() {
+		var tbody = th.closest('table').tBodies[0];
+		var rows = Array.from(tbody.rows);
+		var asc = th.dataset.asc = (th.dataset.asc === '1') ? '0' : '1';
+		rows.sort(function(a, b) {
+			var x = a.cells[col].textContent, y = b.cells[col].textContent;
+			var d = (x === '' || y === '' || isNaN(x) || isNaN(y)) ? x.localeCompare(y) : x - y;
+			return (asc === '1') ? d : -d;
+		});
+		rows.forEach(function(r) {
+			tbody.appendChild(r);
+		});
+	});
+});
+</script>
+</body>
+</html>
+)X";
+	file_save("times.html", html);
+
 	html.clear();
 	for (auto& it : profiler.grammars) {
 		auto s_f = xml_encode(fs::path(strings[it.first]).filename());
@@ -323,7 +461,10 @@ int main(int argc, char* argv[]) {
 	}
 	std::swap(html, buf);
 
-	auto gn = strings[profiler.grammars.begin()->first];
+	std::string gn{"binary grammar"};
+	if (!profiler.grammars.empty()) {
+		gn = strings[profiler.grammars.begin()->first];
+	}
 	html.resize(512 + gn.size() + buf.size());
 	sz = sprintf(&html[0], R"X(<!DOCTYPE html>
 <html>
@@ -336,6 +477,7 @@ int main(int argc, char* argv[]) {
 <ul>
 %s
 </ul>
+<p><a href="times.html">Time per rule, context, and section</a></p>
 </body>
 </html>
 )X", xml_encode(fs::path(gn).filename()).c_str(), buf.c_str());
@@ -410,6 +552,25 @@ a {
 	background-color: #eee;
 }
 
+#times {
+	border-collapse: collapse;
+}
+
+#times th {
+	cursor: pointer;
+	background-color: #ddd;
+}
+
+#times td, #times th {
+	padding: 0.5ex 1ex;
+	border: 1px solid #ccc;
+	vertical-align: top;
+}
+
+#times .pre-wrap {
+	padding-left: 1ex;
+}
+
 .ln {
 	white-space: nowrap;
 	margin-right: 1ex;
@@ -121,6 +121,7 @@ int main(int argc, char* argv[]) {
 		grammar.ordered = true;
 	}
 
+	std::ios_base::sync_with_stdio(false);
 	ux_stripBOM(std::cin);
 
 	std::istream* instream = &std::cin;
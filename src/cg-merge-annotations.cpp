@@ -41,6 +41,7 @@ int main(int argc, char* argv[]) {
 			strings[it.second] = it.first;
 		}
 
+		// Textual grammars are compared by their source, binary ones by a digest of their rules
 		if (out_strings[0] != strings[0]) {
 			throw std::runtime_error("Cannot merge database from different grammars!");
 		}
@@ -54,6 +55,17 @@ int main(int argc, char* argv[]) {
 			auto& oe = out.entries[it.first];
 			oe.num_match += ie.num_match;
 			oe.num_fail += ie.num_fail;
+			oe.time += ie.time;
+			// Sections have no entry until a rule in them has run
+			oe.type = ie.type;
+			if (!oe.line) {
+				oe.line = ie.line;
+			}
+			if (!oe.grammar && ie.grammar) {
+				oe.grammar = UI32(out.addString(strings[ie.grammar]));
+				oe.b = ie.b;
+				oe.e = ie.e;
+			}
 			if (!oe.example_window && ie.example_window) {
 				auto id = out.addString(strings[ie.example_window]);
 				oe.example_window = id;
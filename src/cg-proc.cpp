@@ -59,6 +59,7 @@ void endProgram(char* name) {
 	cout << "	-g, --generation:	 do not surround lexical units in ^$" << endl;
 	cout << "	-1, --first:	 	 only output the first analysis if ambiguity remains" << endl;
 	cout << "	-z, --null-flush:	flush output on the null character" << endl;
+	cout << "	-l, --low-latency:	 write each window as soon as later input cannot change it" << endl;
 
 	cout << "	-v, --version:	 	 version" << endl;
 	cout << "	-h, --help:		 show this help" << endl;
@@ -77,6 +78,7 @@ void endProgram(char* name) {
 	cout << "	-g:	 do not surround lexical units in ^$" << endl;
 	cout << "	-1:	 only output the first analysis if ambiguity remains" << endl;
 	cout << "	-z:	 flush output on the null character" << endl;
+	cout << "	-l:	 write each window as soon as later input cannot change it" << endl;
 
 	cout << "	-v:	 version" << endl;
 	cout << "	-h:	 show this help" << endl;
@@ -91,6 +93,7 @@ int main(int argc, char* argv[]) {
 	bool delimit_lexical_units = true;
 	bool surface_readings = false;
 	bool only_first = false;
+	bool low_latency = false;
 	int cmd = 0;
 	int sections = 0;
 	int stream_format = 1;
@@ -112,15 +115,16 @@ int main(int argc, char* argv[]) {
 		{"first",   		0, 0, '1'},
 		{"help",		0, 0, 'h'},
 		{"null-flush",		0, 0, 'z'},
+		{"low-latency",		0, 0, 'l'},
 	};
 #endif
 
 	for (;;) {
 #if HAVE_GETOPT_LONG
 		int option_index;
-		auto c = getopt_long(argc, argv, "ds:f:tr:n1wvhz", long_options, &option_index);
+		auto c = getopt_long(argc, argv, "ds:f:tr:n1wvhzl", long_options, &option_index);
 #else
-		auto c = getopt(argc, argv, "ds:f:tr:ing1wvhz");
+		auto c = getopt(argc, argv, "ds:f:tr:ing1wvhzl");
 #endif
 		if (c == -1) {
 			break;
@@ -181,6 +185,9 @@ int main(int argc, char* argv[]) {
 		case 'z':
 			// Null-flush is default
 			break;
+		case 'l':
+			low_latency = true;
+			break;
 		case 'h':
 		default:
 			endProgram(argv[0]);
@@ -237,6 +244,9 @@ int main(int argc, char* argv[]) {
 		endProgram(argv[0]);
 	}
 
+	// Lets UStreamReader read std::cin in blocks
+	std::ios_base::sync_with_stdio(false);
+
 	std::istream* ux_stdin = &std::cin;
 	std::unique_ptr<std::ifstream> _ux_stdin;
 	if (optind <= (argc - 2)) {
@@ -322,6 +332,7 @@ int main(int argc, char* argv[]) {
 		apertiumApplicator->print_only_first = only_first;
 		apertiumApplicator->delimit_lexical_units = delimit_lexical_units;
 		apertiumApplicator->surface_readings = surface_readings;
+		apertiumApplicator->low_latency = low_latency;
 		applicator.reset(apertiumApplicator);
 	}
 
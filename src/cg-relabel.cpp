@@ -80,6 +80,8 @@ Grammar* cg3_grammar_load(const char* filename, std::ostream& ux_stdout, std::os
 	}
 
 	grammar->reindex();
+	// Relabelling edits the sets' tries, which a mapped binary grammar only has in flat form
+	grammar->unflattenTries();
 
 	return grammar;
 }
@@ -100,6 +100,8 @@ cg3_sconverter* cg3_sconverter_create(cg3_sformat fmt_in, cg3_sformat fmt_out);
 void cg3_sconverter_free(cg3_sconverter* converter_);
 void cg3_sconverter_run_fns(cg3_sconverter* converter_, const char* input, const char* output);
 
+// Applicators never modify the grammar, so one grammar may be shared by several applicators running in separate threads.
+// Each applicator must only be used by one thread at a time, and the grammar must outlive all its applicators.
 cg3_applicator* cg3_applicator_create(cg3_grammar* grammar);
 cg3_applicator* cg3_applicator_create_binary(cg3_grammar* grammar);
 // Pass in OR'ed values from cg3_flags; each call resets flags, so set all needed ones in a single call.
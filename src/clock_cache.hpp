@@ -0,0 +1,172 @@
+/*
+* Copyright (C) 2007-2025, GrammarSoft ApS
+* Developed by Tino Didriksen <mail@tinodidriksen.com>
+* Design by Eckhard Bick <eckhard.bick@mail.dk>, Tino Didriksen <mail@tinodidriksen.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this progam.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#ifndef c6d28b7452ec699b_CLOCK_CACHE_HPP
+#define c6d28b7452ec699b_CLOCK_CACHE_HPP
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace CG3 {
+
+/**
+ * Remembers yes/no answers for 64 bit keys within a memory budget.
+ *
+ * Keys are kept in buckets of 4. The table starts small and doubles when a bucket overflows while at least half the
+ * table is in use, until it would exceed the budget. Otherwise, an overflowing bucket evicts by CLOCK: entries that were hit since the hand last passed them
+ * get another round, so answers that keep being asked for (punctuation, function words) stay while one-offs make room.
+ */
+class clock_cache {
+public:
+	static constexpr int UNKNOWN = -1;
+
+	uint64_t hits = 0;
+	uint64_t misses = 0;
+	uint64_t evictions = 0;
+
+	void set_budget(size_t bytes) {
+		budget = bytes;
+	}
+
+	size_t bytes() const {
+		return buckets.capacity() * sizeof(bucket);
+	}
+
+	// Returns 1 or 0 for a known answer, UNKNOWN otherwise
+	int find(uint64_t key) {
+		if (!buckets.empty()) {
+			auto& b = buckets[slot(key)];
+			for (uint8_t i = 0; i < WAYS; ++i) {
+				if ((b.used & (1 << i)) && b.keys[i] == key) {
+					b.ref |= (1 << i);
+					++hits;
+					return (b.yes >> i) & 1;
+				}
+			}
+		}
+		++misses;
+		return UNKNOWN;
+	}
+
+	void insert(uint64_t key, bool yes) {
+		if (buckets.empty()) {
+			buckets.resize(MIN_BUCKETS);
+			shift = 64 - MIN_BITS;
+		}
+		for (;;) {
+			auto& b = buckets[slot(key)];
+			uint8_t way = WAYS;
+			for (uint8_t i = 0; i < WAYS; ++i) {
+				if ((b.used & (1 << i)) && b.keys[i] == key) {
+					way = i;
+					break;
+				}
+			}
+			if (way == WAYS) {
+				if (b.used != FULL) {
+					for (way = 0; b.used & (1 << way); ++way) {
+					}
+				}
+				else if (count * 2 >= buckets.size() * WAYS && bytes() * 2 <= budget) {
+					grow();
+					continue;
+				}
+				else {
+					while (b.ref & (1 << b.hand)) {
+						b.ref &= ~(1 << b.hand);
+						b.hand = (b.hand + 1) % WAYS;
+					}
+					way = b.hand;
+					b.hand = (b.hand + 1) % WAYS;
+					++evictions;
+					--count;
+				}
+				++count;
+			}
+			b.keys[way] = key;
+			b.used |= (1 << way);
+			b.ref &= ~(1 << way);
+			if (yes) {
+				b.yes |= (1 << way);
+			}
+			else {
+				b.yes &= ~(1 << way);
+			}
+			return;
+		}
+	}
+
+	void clear() {
+		for (auto& b : buckets) {
+			b.used = b.ref = b.hand = 0;
+		}
+		count = 0;
+	}
+
+private:
+	static constexpr uint8_t WAYS = 4;
+	static constexpr uint8_t FULL = (1 << WAYS) - 1;
+	static constexpr uint8_t MIN_BITS = 6;
+	static constexpr size_t MIN_BUCKETS = 1 << MIN_BITS;
+
+	struct bucket {
+		uint64_t keys[WAYS];
+		uint8_t used = 0;
+		uint8_t yes = 0;
+		uint8_t ref = 0;
+		uint8_t hand = 0;
+	};
+
+	std::vector<bucket> buckets;
+	size_t count = 0;
+	uint8_t shift = 64;
+	size_t budget = 0;
+
+	// Fibonacci hashing on the top bits, so that doubling splits each bucket in two and never overflows one
+	size_t slot(uint64_t key) const {
+		return static_cast<size_t>((key * UINT64_C(0x9E3779B97F4A7C15)) >> shift);
+	}
+
+	void grow() {
+		std::vector<bucket> old;
+		old.swap(buckets);
+		buckets.resize(old.size() * 2);
+		--shift;
+		for (auto& ob : old) {
+			for (uint8_t i = 0; i < WAYS; ++i) {
+				if (!(ob.used & (1 << i))) {
+					continue;
+				}
+				auto& b = buckets[slot(ob.keys[i])];
+				uint8_t way = 0;
+				for (; b.used & (1 << way); ++way) {
+				}
+				b.keys[way] = ob.keys[i];
+				b.used |= (1 << way);
+				b.yes |= ((ob.yes >> i) & 1) << way;
+				b.ref |= ((ob.ref >> i) & 1) << way;
+			}
+		}
+	}
+};
+
+}
+
+#endif
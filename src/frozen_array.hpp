@@ -0,0 +1,110 @@
+/*
+* Copyright (C) 2007-2025, GrammarSoft ApS
+* Developed by Tino Didriksen <mail@tinodidriksen.com>
+* Design by Eckhard Bick <eckhard.bick@mail.dk>, Tino Didriksen <mail@tinodidriksen.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this progam.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#ifndef c6d28b7452ec699b_FROZEN_ARRAY_HPP
+#define c6d28b7452ec699b_FROZEN_ARRAY_HPP
+#include <vector>
+#include <cstddef>
+
+namespace CG3 {
+
+/**
+ * A read-only array that either owns its elements or borrows them from memory that someone else keeps alive,
+ * such as a binary grammar mapped straight from its file.
+ *
+ * It is filled either through assign(), which copies into storage of its own, or through borrow(), which only
+ * remembers where the elements are. Either way it is read as one contiguous block.
+ */
+template<typename T>
+class frozen_array {
+public:
+	typedef const T* const_iterator;
+
+	frozen_array() = default;
+
+	frozen_array(const frozen_array& o) {
+		*this = o;
+	}
+
+	frozen_array& operator=(const frozen_array& o) {
+		if (o.borrowed()) {
+			borrow(o.first, o.count);
+		}
+		else {
+			assign(o.own);
+		}
+		return *this;
+	}
+
+	void assign(std::vector<T> elems) {
+		own.swap(elems);
+		own.shrink_to_fit();
+		first = own.data();
+		count = own.size();
+	}
+
+	void borrow(const T* elems, size_t n) {
+		own.clear();
+		own.shrink_to_fit();
+		first = elems;
+		count = n;
+	}
+
+	void clear() {
+		assign(std::vector<T>());
+	}
+
+	bool borrowed() const {
+		return count && first != own.data();
+	}
+
+	const T* data() const {
+		return first;
+	}
+
+	size_t size() const {
+		return count;
+	}
+
+	bool empty() const {
+		return count == 0;
+	}
+
+	const T& operator[](size_t i) const {
+		return first[i];
+	}
+
+	const_iterator begin() const {
+		return first;
+	}
+
+	const_iterator end() const {
+		return first + count;
+	}
+
+private:
+	std::vector<T> own;
+	const T* first = nullptr;
+	size_t count = 0;
+};
+
+}
+
+#endif
@@ -487,6 +487,17 @@ inline void insert_if_exists(boost::dynamic_bitset<>& cont, const boost::dynamic
 	}
 }
 
+// Sets the bits listed in ids, growing cont to size bits first so it can still be combined with others of that size
+template<typename C>
+inline void insert_ids(boost::dynamic_bitset<>& cont, const C& ids, size_t size) {
+	if (cont.size() < size) {
+		cont.resize(size);
+	}
+	for (auto id : ids) {
+		cont.set(id);
+	}
+}
+
 template<typename S, typename T>
 inline void writeRaw(S& stream, const T& value) {
 	stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
@@ -518,6 +529,36 @@ inline void writeLE(S& stream, T value) {
 	writeRaw(stream, value);
 }
 
+/**
+ * Reads from a block of memory with the std::istream::read() interface, but without going through a stream buffer.
+ * Reading past the end throws std::ios_base::failure, as a stream with all exceptions enabled would.
+ */
+class buffer_reader {
+public:
+	buffer_reader(const char* buffer, size_t length)
+	  : cur(buffer)
+	  , end(buffer + length)
+	{
+	}
+
+	buffer_reader& read(char* out, size_t n) {
+		if (n > remaining()) {
+			throw std::ios_base::failure("Read past end of buffer");
+		}
+		memcpy(out, cur, n);
+		cur += n;
+		return *this;
+	}
+
+	size_t remaining() const {
+		return static_cast<size_t>(end - cur);
+	}
+
+private:
+	const char* cur = nullptr;
+	const char* end = nullptr;
+};
+
 template<typename T>
 inline T readBE(std::istream& stream) {
 	T value;
@@ -525,8 +566,15 @@ inline T readBE(std::istream& stream) {
 	return be::big_to_native(value);
 }
 
-template<>
-inline double readBE(std::istream& stream) {
+template<typename T>
+inline T readBE(buffer_reader& stream) {
+	T value;
+	readRaw(stream, value);
+	return be::big_to_native(value);
+}
+
+template<typename S>
+inline double readBE_double(S& stream) {
 	auto mant64 = readBE<uint64_t>(stream);
 	auto exp = static_cast<int>(readBE<int32_t>(stream));
 
@@ -535,6 +583,16 @@ inline double readBE(std::istream& stream) {
 	return ldexp(value, exp);
 }
 
+template<>
+inline double readBE(std::istream& stream) {
+	return readBE_double(stream);
+}
+
+template<>
+inline double readBE(buffer_reader& stream) {
+	return readBE_double(stream);
+}
+
 template<typename S, typename T>
 inline void readLE(S& stream, T& value) {
 	readRaw(stream, value);
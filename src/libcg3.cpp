@@ -40,6 +40,10 @@ std::unique_ptr<std::ostream> ux_stderr;
 
 bool did_init = false;
 bool did_cleanup = false;
+
+// Applicators sharing a grammar may run in different threads, so tag text conversions get per-thread buffers
+thread_local UString ubuffer(CG3_BUFFER_SIZE, 0);
+thread_local std::string cbuffer(CG3_BUFFER_SIZE, 0);
 }
 
 cg3_status cg3_init(FILE* in, FILE* out, FILE* err) {
@@ -348,7 +352,7 @@ inline Tag* _tag_copy(GrammarApplicator* to, Tag* t) {
 }
 
 inline Tag* _tag_copy(GrammarApplicator* from, GrammarApplicator* to, uint32_t hash) {
-	Tag* t = from->grammar->single_tags[hash];
+	Tag* t = from->single_tags[hash];
 	return _tag_copy(to, t);
 }
 
@@ -481,7 +485,7 @@ void cg3_cohort_getrelation_u(cg3_cohort *cohort_, const UChar *rel, uint32_t *r
 	if ((cohort->type & CT_RELATED) && !cohort->relations.empty()) {
 		for (auto miter : cohort->relations) {
 			for (auto siter : miter->second) {
-				if (ga->grammar->single_tags.find(miter.first)->second->tag == rel) {
+				if (ga->single_tags.find(miter.first)->second->tag == rel) {
 					*rel_parent = siter;
 				}
 			}
@@ -492,12 +496,12 @@ void cg3_cohort_getrelation_u(cg3_cohort *cohort_, const UChar *rel, uint32_t *r
 void cg3_cohort_getrelation_u8(cg3_cohort *cohort_, const char *rel, uint32_t *rel_parent) {
 	UErrorCode status = U_ZERO_ERROR;
 
-	u_strFromUTF8(&gbuffers[0][0], CG3_BUFFER_SIZE-1, 0, rel, strlen(rel), &status);
+	u_strFromUTF8(&ubuffer[0], CG3_BUFFER_SIZE-1, 0, rel, strlen(rel), &status);
 	if (U_FAILURE(status)) {
 		u_fprintf(ux_stderr, "CG3 Error: Failed to convert text from UTF-8 to UTF-16. Status = %s\n", u_errorName(status));
 		return;
 	}
-	cg3_cohort_getrelation_u(cohort_, &gbuffers[0][0], rel_parent);
+	cg3_cohort_getrelation_u(cohort_, &ubuffer[0], rel_parent);
 }
 //*/
 
@@ -557,7 +561,7 @@ cg3_tag* cg3_reading_gettag(cg3_reading* reading_, size_t which) {
 	auto it = reading->tags_list.begin();
 	std::advance(it, which);
 	auto ga = reading->parent->parent->parent->parent;
-	return ga->grammar->single_tags.find(*it)->second;
+	return ga->single_tags.find(*it)->second;
 }
 
 size_t cg3_reading_numtraces(cg3_reading* reading_) {
@@ -614,13 +618,13 @@ cg3_tag* cg3_tag_create_u(cg3_applicator* applicator_, const UChar* text) {
 cg3_tag* cg3_tag_create_u8(cg3_applicator* applicator, const char* text) {
 	UErrorCode status = U_ZERO_ERROR;
 
-	u_strFromUTF8(&gbuffers[0][0], CG3_BUFFER_SIZE - 1, 0, text, SI32(strlen(text)), &status);
+	u_strFromUTF8(&ubuffer[0], CG3_BUFFER_SIZE - 1, 0, text, SI32(strlen(text)), &status);
 	if (U_FAILURE(status)) {
 		u_fprintf(ux_stderr, "CG3 Error: Failed to convert text from UTF-8 to UTF-16. Status = %s\n", u_errorName(status));
 		return 0;
 	}
 
-	return cg3_tag_create_u(applicator, &gbuffers[0][0]);
+	return cg3_tag_create_u(applicator, &ubuffer[0]);
 }
 
 cg3_tag* cg3_tag_create_u16(cg3_applicator* applicator, const uint16_t* text) {
@@ -635,25 +639,25 @@ cg3_tag* cg3_tag_create_u32(cg3_applicator* applicator, const uint32_t* text) {
 		++length;
 	}
 
-	u_strFromUTF32(&gbuffers[0][0], CG3_BUFFER_SIZE - 1, 0, reinterpret_cast<const UChar32*>(text), length, &status);
+	u_strFromUTF32(&ubuffer[0], CG3_BUFFER_SIZE - 1, 0, reinterpret_cast<const UChar32*>(text), length, &status);
 	if (U_FAILURE(status)) {
 		u_fprintf(ux_stderr, "CG3 Error: Failed to convert text from UTF-32 to UTF-16. Status = %s\n", u_errorName(status));
 		return 0;
 	}
 
-	return cg3_tag_create_u(applicator, &gbuffers[0][0]);
+	return cg3_tag_create_u(applicator, &ubuffer[0]);
 }
 
 cg3_tag* cg3_tag_create_w(cg3_applicator* applicator, const wchar_t* text) {
 	UErrorCode status = U_ZERO_ERROR;
 
-	u_strFromWCS(&gbuffers[0][0], CG3_BUFFER_SIZE - 1, 0, text, SI32(wcslen(text)), &status);
+	u_strFromWCS(&ubuffer[0], CG3_BUFFER_SIZE - 1, 0, text, SI32(wcslen(text)), &status);
 	if (U_FAILURE(status)) {
 		u_fprintf(ux_stderr, "CG3 Error: Failed to convert text from wchar_t to UTF-16. Status = %s\n", u_errorName(status));
 		return 0;
 	}
 
-	return cg3_tag_create_u(applicator, &gbuffers[0][0]);
+	return cg3_tag_create_u(applicator, &ubuffer[0]);
 }
 
 const UChar* cg3_tag_gettext_u(cg3_tag* tag_) {
@@ -665,13 +669,13 @@ const char* cg3_tag_gettext_u8(cg3_tag* tag_) {
 	auto tag = static_cast<Tag*>(tag_);
 	UErrorCode status = U_ZERO_ERROR;
 
-	u_strToUTF8(&cbuffers[0][0], CG3_BUFFER_SIZE - 1, 0, tag->tag.data(), SI32(tag->tag.size()), &status);
+	u_strToUTF8(&cbuffer[0], CG3_BUFFER_SIZE - 1, 0, tag->tag.data(), SI32(tag->tag.size()), &status);
 	if (U_FAILURE(status)) {
 		u_fprintf(ux_stderr, "CG3 Error: Failed to convert text from UChar to UTF-8. Status = %s\n", u_errorName(status));
 		return 0;
 	}
 
-	return &cbuffers[0][0];
+	return &cbuffer[0];
 }
 
 const uint16_t* cg3_tag_gettext_u16(cg3_tag* tag_) {
@@ -683,7 +687,7 @@ const uint32_t* cg3_tag_gettext_u32(cg3_tag* tag_) {
 	auto tag = static_cast<Tag*>(tag_);
 	UErrorCode status = U_ZERO_ERROR;
 
-	UChar32* tmp = reinterpret_cast<UChar32*>(&cbuffers[0][0]);
+	UChar32* tmp = reinterpret_cast<UChar32*>(&cbuffer[0]);
 
 	u_strToUTF32(tmp, (CG3_BUFFER_SIZE / sizeof(UChar32)) - 1, 0, tag->tag.data(), SI32(tag->tag.size()), &status);
 	if (U_FAILURE(status)) {
@@ -698,7 +702,7 @@ const wchar_t* cg3_tag_gettext_w(cg3_tag* tag_) {
 	auto tag = static_cast<Tag*>(tag_);
 	UErrorCode status = U_ZERO_ERROR;
 
-	auto tmp = reinterpret_cast<wchar_t*>(&cbuffers[0][0]);
+	auto tmp = reinterpret_cast<wchar_t*>(&cbuffer[0]);
 
 	u_strToWCS(tmp, (CG3_BUFFER_SIZE / sizeof(wchar_t)) - 1, 0, tag->tag.data(), SI32(tag->tag.size()), &status);
 	if (U_FAILURE(status)) {
@@ -23,7 +23,9 @@
 #include "GrammarWriter.hpp"
 #include "BinaryGrammar.hpp"
 #include "FormatConverter.hpp"
+#include "ParallelApplicator.hpp"
 #include "version.hpp"
+#include <thread>
 
 #include "options.hpp"
 #include "options_parser.hpp"
@@ -153,6 +155,9 @@ int main(int argc, char* argv[]) {
 
 	UConverter* conv = ucnv_open(codepage_cli, &status);
 
+	// Otherwise std::cin reads byte by byte through C stdio, which defeats UStreamReader's block reads
+	std::ios_base::sync_with_stdio(false);
+
 	std::ostream* ux_stdout = &std::cout;
 	std::unique_ptr<std::ofstream> _ux_stdout;
 	if (options[STDOUT].doesOccur) {
@@ -225,8 +230,8 @@ int main(int argc, char* argv[]) {
 			std::cerr << "Error: --dump-ast is for textual grammars only!" << std::endl;
 			CG3Quit(1);
 		}
-		if (options[PROFILING].doesOccur) {
-			std::cerr << "Error: --profile is for textual grammars only!" << std::endl;
+		if (options[PROFILING].doesOccur && !options[PROFILE_SAMPLE].doesOccur) {
+			std::cerr << "Error: --profile is for textual grammars only, unless sampling with --profile-sample!" << std::endl;
 			CG3Quit(1);
 		}
 		parser.reset(new BinaryGrammar(grammar, *ux_stderr));
@@ -281,7 +286,26 @@ int main(int argc, char* argv[]) {
 	std::unique_ptr<Profiler> profiler;
 	if (options[PROFILING].doesOccur) {
 		profiler.reset(new Profiler);
-		dynamic_cast<TextualParser*>(parser.get())->profiler = profiler.get();
+		if (auto tp = dynamic_cast<TextualParser*>(parser.get())) {
+			tp->profiler = profiler.get();
+		}
+	}
+	if (options[PROFILE_SAMPLE].doesOccur && !options[PROFILING].doesOccur) {
+		std::cerr << "Error: --profile-sample needs --profile to know where to write the data." << std::endl;
+		CG3Quit(1);
+	}
+
+	size_t num_threads = 1;
+	if (options[THREADS].doesOccur) {
+		auto& v = options[THREADS].value;
+		if (v.empty() || v.size() > 4 || v.find_first_not_of("0123456789") != std::string::npos) {
+			std::cerr << "Error: --threads must be a number from 0 to 9999, not '" << v << "'!" << std::endl;
+			CG3Quit(1);
+		}
+		num_threads = std::stoul(v);
+		if (num_threads == 0) {
+			num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+		}
 	}
 
 	if (parser->parse_grammar(options[GRAMMAR].value.c_str())) {
@@ -311,7 +335,7 @@ int main(int argc, char* argv[]) {
 	if (options[DUMP_AST].doesOccur) {
 		dynamic_cast<TextualParser*>(parser.get())->print_ast(*ux_stdout);
 	}
-	if (options[PROFILING].doesOccur) {
+	if (options[PROFILING].doesOccur && !grammar.is_binary) {
 		auto& buf = profiler->buf;
 		buf.str("");
 		buf.clear();
@@ -319,6 +343,22 @@ int main(int argc, char* argv[]) {
 		auto sz = profiler->addString(buf.str());
 		profiler->grammar_ast = sz;
 	}
+	else if (options[PROFILING].doesOccur) {
+		// A binary grammar has no source to tell it apart by, so its profiles are marked with a digest of its rules instead
+		uint32_t digest = 0;
+		for (auto rule : grammar.rule_by_number) {
+			digest = hash_value(rule->number, digest);
+			digest = hash_value(rule->line, digest);
+			digest = hash_value(UI32(rule->type), digest);
+			if (!rule->name.empty()) {
+				digest = hash_value(rule->name, digest);
+			}
+			for (auto test : rule->tests) {
+				digest = hash_value(test->hash, digest);
+			}
+		}
+		profiler->grammar_ast = profiler->addString("binary grammar " + std::to_string(digest));
+	}
 
 	if (options[MAPPING_PREFIX].doesOccur) {
 		ucnv_reset(conv);
@@ -361,60 +401,124 @@ int main(int argc, char* argv[]) {
 		CG3Quit(1);
 	}
 
-	if (!options[GRAMMAR_ONLY].doesOccur) {
-		FormatConverter applicator(*ux_stderr);
-		applicator.fmt_input = CG3SF_CG;
-
-		if (options[IN_CG].doesOccur) {
-			applicator.fmt_input = CG3SF_CG;
-		}
-		else if (options[IN_NICELINE].doesOccur) {
-			applicator.fmt_input = CG3SF_NICELINE;
-		}
-		else if (options[IN_APERTIUM].doesOccur) {
-			applicator.fmt_input = CG3SF_APERTIUM;
-		}
-		else if (options[IN_FST].doesOccur) {
-			applicator.fmt_input = CG3SF_FST;
-		}
-		else if (options[IN_PLAIN].doesOccur) {
-			applicator.fmt_input = CG3SF_PLAIN;
+	if (profiler) {
+		// Binary grammars have no source offsets, so rules and contexts are only known by number and line
+		for (auto rule : grammar.rule_by_number) {
+			auto& r = profiler->entries[Profiler::Key{ ET_RULE, rule->number + 1 }];
+			r.line = rule->line;
+			for (auto test : rule->tests) {
+				auto& t = profiler->entries[Profiler::Key{ ET_CONTEXT, test->hash }];
+				t.type = ET_CONTEXT;
+				t.line = test->line;
+			}
 		}
-		else if (options[IN_JSONL].doesOccur) {
-			applicator.fmt_input = CG3SF_JSONL;
+		if (options[PROFILE_SAMPLE].doesOccur) {
+			profiler->examples = false;
+			profiler->checkpoint_fname = options[PROFILING].value;
 		}
-		else if (options[IN_BINARY].doesOccur) {
-			applicator.fmt_input = CG3SF_BINARY;
+	}
+
+	if (!options[GRAMMAR_ONLY].doesOccur) {
+		std::unique_ptr<MatchMemo> match_memo;
+		if (options[MATCH_CACHE].doesOccur) {
+			size_t budget = UI64(32) << 20;
+			if (options[MATCH_FILE_SIZE].doesOccur) {
+				budget = UI64(std::stoul(options[MATCH_FILE_SIZE].value)) << 20;
+			}
+			match_memo.reset(new MatchMemo(grammar, budget));
+			std::ifstream min(options[MATCH_CACHE].value, std::ios::binary);
+			if (min && !match_memo->load(min) && options[VERBOSE].doesOccur) {
+				std::cerr << "Warning: Match cache " << options[MATCH_CACHE].value << " was made for a different grammar, so starting over." << std::endl;
+			}
 		}
 
-		applicator.setGrammar(&grammar);
-		applicator.setOptions(conv);
+		auto setup_applicator = [&](FormatConverter& applicator) {
+			applicator.fmt_input = CG3SF_CG;
 
-		applicator.fmt_output = CG3SF_CG;
-		if (options[OUT_APERTIUM].doesOccur) {
-			applicator.fmt_output = CG3SF_APERTIUM;
-			applicator.unicode_tags = true;
-		}
-		else if (options[OUT_FST].doesOccur) {
-			applicator.fmt_output = CG3SF_FST;
-		}
-		else if (options[OUT_NICELINE].doesOccur) {
-			applicator.fmt_output = CG3SF_NICELINE;
-		}
-		else if (options[OUT_PLAIN].doesOccur) {
-			applicator.fmt_output = CG3SF_PLAIN;
-		}
-		else if (options[OUT_JSONL].doesOccur) {
-			applicator.fmt_output = CG3SF_JSONL;
+			if (options[IN_CG].doesOccur) {
+				applicator.fmt_input = CG3SF_CG;
+			}
+			else if (options[IN_NICELINE].doesOccur) {
+				applicator.fmt_input = CG3SF_NICELINE;
+			}
+			else if (options[IN_APERTIUM].doesOccur) {
+				applicator.fmt_input = CG3SF_APERTIUM;
+			}
+			else if (options[IN_FST].doesOccur) {
+				applicator.fmt_input = CG3SF_FST;
+			}
+			else if (options[IN_PLAIN].doesOccur) {
+				applicator.fmt_input = CG3SF_PLAIN;
+			}
+			else if (options[IN_JSONL].doesOccur) {
+				applicator.fmt_input = CG3SF_JSONL;
+			}
+			else if (options[IN_BINARY].doesOccur) {
+				applicator.fmt_input = CG3SF_BINARY;
+			}
+
+			applicator.setGrammar(&grammar);
+			applicator.setOptions(conv);
+
+			applicator.fmt_output = CG3SF_CG;
+			if (options[OUT_APERTIUM].doesOccur) {
+				applicator.fmt_output = CG3SF_APERTIUM;
+				applicator.unicode_tags = true;
+			}
+			else if (options[OUT_FST].doesOccur) {
+				applicator.fmt_output = CG3SF_FST;
+			}
+			else if (options[OUT_NICELINE].doesOccur) {
+				applicator.fmt_output = CG3SF_NICELINE;
+			}
+			else if (options[OUT_PLAIN].doesOccur) {
+				applicator.fmt_output = CG3SF_PLAIN;
+			}
+			else if (options[OUT_JSONL].doesOccur) {
+				applicator.fmt_output = CG3SF_JSONL;
+			}
+			else if (options[OUT_BINARY].doesOccur) {
+				applicator.fmt_output = CG3SF_BINARY;
+			}
+
+			if (options[PROFILE_SAMPLE].doesOccur) {
+				applicator.sample_profiler = profiler.get();
+				applicator.profile_sample = std::max(UI32(std::stoul(options[PROFILE_SAMPLE].value)), UI32(1));
+			}
+			else if (options[PROFILING].doesOccur) {
+				applicator.profiler = profiler.get();
+			}
+			applicator.match_memo = match_memo.get();
+		};
+
+		if (num_threads > 1) {
+			ParallelApplicator applicator(*ux_stderr, grammar, num_threads, setup_applicator);
+			applicator.runGrammarOnText(*ux_stdin, *ux_stdout);
 		}
-		else if (options[OUT_BINARY].doesOccur) {
-			applicator.fmt_output = CG3SF_BINARY;
+		else {
+			FormatConverter applicator(*ux_stderr);
+			setup_applicator(applicator);
+			applicator.runGrammarOnText(*ux_stdin, *ux_stdout);
+
+			if (options[VERBOSE].doesOccur) {
+				std::cerr << "Contextual tests shared between rules: " << applicator.numContextHits << " reused, " << applicator.numContextMisses << " run." << std::endl;
+				std::cerr << "Rules skipped for lacking sets their contexts need: " << applicator.numRulesSkipped << "." << std::endl;
+				applicator.printMatchCacheStats();
+			}
 		}
 
-		if (options[PROFILING].doesOccur) {
-			applicator.profiler = profiler.get();
+		if (match_memo) {
+			std::ofstream mout(options[MATCH_CACHE].value, std::ios::binary);
+			if (mout) {
+				match_memo->save(mout);
+			}
+			if (!mout) {
+				std::cerr << "Warning: Could not write match cache " << options[MATCH_CACHE].value << "." << std::endl;
+			}
+			if (options[VERBOSE].doesOccur) {
+				std::cerr << "Match cache: " << match_memo->hits() << " hits, " << match_memo->misses() << " misses, " << match_memo->evictions() << " evictions, " << match_memo->size() << " tags, " << match_memo->bytes() / 1024 << " KiB." << std::endl;
+			}
 		}
-		applicator.runGrammarOnText(*ux_stdin, *ux_stdout);
 
 		if (options[VERBOSE].doesOccur) {
 			std::cerr << "Applying grammar on input took " << (clock() - main_timer) / (double)CLOCKS_PER_SEC << " seconds." << std::endl;
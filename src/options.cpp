@@ -69,6 +69,8 @@ options_t options{
 	UOption{"single-run",            0, UOPT_NO_ARG,       "runs each section only once; same as --max-runs 1"},
 	UOption{"max-runs",              0, UOPT_REQUIRES_ARG, "runs each section max N times; defaults to unlimited (0)"},
 	UOption{"profile",               0, UOPT_REQUIRES_ARG, "gathers profiling statistics and code coverage into a SQLite database"},
+	UOption{"profile-sample",        0, UOPT_REQUIRES_ARG, "with --profile, only profiles 1 in N windows and keeps no examples, saving every minute; also works for binary grammars"},
+	UOption{"threads",               0, UOPT_REQUIRES_ARG, "runs the grammar in N threads, splitting the input where windows are independent; 0 for one per core"},
 	UOption{"prefix",              'p', UOPT_REQUIRES_ARG, "sets the mapping prefix; defaults to @"},
 	UOption{"unicode-tags",          0, UOPT_NO_ARG,       "outputs Unicode code points for things like ->"},
 	UOption{"unique-tags",           0, UOPT_NO_ARG,       "outputs unique tags only once per reading"},
@@ -79,6 +81,10 @@ options_t options{
 	UOption{"always-span",           0, UOPT_NO_ARG,       "forces scanning tests to always span across window boundaries"},
 	UOption{"soft-limit",            0, UOPT_REQUIRES_ARG, "number of cohorts after which the SOFT-DELIMITERS kick in; defaults to 300"},
 	UOption{"hard-limit",            0, UOPT_REQUIRES_ARG, "number of cohorts after which the window is forcefully cut; defaults to 500"},
+	UOption{"max-runtime-tags",      0, UOPT_REQUIRES_ARG, "reclaims tags no window refers to anymore once input has created more than N; defaults to unlimited (0)"},
+	UOption{"match-cache-size",      0, UOPT_REQUIRES_ARG, "MiB of memory for remembering which sets matched which readings; defaults to 32"},
+	UOption{"match-cache",           0, UOPT_REQUIRES_ARG, "file to keep regex matches in across runs, looked up by tag text"},
+	UOption{"match-file-size",       0, UOPT_REQUIRES_ARG, "MiB of memory for the regex matches of --match-cache; defaults to 32"},
 	UOption{"text-delimit",        'T', UOPT_OPTIONAL_ARG, "additional delimit based on non-CG text, ensuring it isn't attached to a cohort; defaults to /(^|\\n)</s/r"},
 	UOption{"dep-delimit",         'D', UOPT_OPTIONAL_ARG, "delimit windows based on dependency instead of DELIMITERS; defaults to 10"},
 	UOption{"dep-absolute",          0, UOPT_NO_ARG,       "outputs absolute cohort numbers rather than relative ones"},
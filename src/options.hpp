@@ -67,6 +67,8 @@ enum OPTIONS {
 	SINGLERUN,
 	MAXRUNS,
 	PROFILING,
+	PROFILE_SAMPLE,
+	THREADS,
 	MAPPING_PREFIX,
 	UNICODE_TAGS,
 	UNIQUE_TAGS,
@@ -76,6 +78,10 @@ enum OPTIONS {
 	ALWAYS_SPAN,
 	SOFT_LIMIT,
 	HARD_LIMIT,
+	MAX_RUNTIME_TAGS,
+	MATCH_CACHE_SIZE,
+	MATCH_CACHE,
+	MATCH_FILE_SIZE,
 	TEXT_DELIMIT,
 	DEP_DELIMIT,
 	DEP_ABSOLUTE,
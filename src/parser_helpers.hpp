@@ -119,7 +119,7 @@ Tag* parseTag(const UChar* to, const UChar* p, State& state, bool unescape=true)
 
 	Taguint32HashMap::iterator it;
 	uint32_t thash = hash_value(to);
-	if ((it = state.get_grammar()->single_tags.find(thash)) != state.get_grammar()->single_tags.end() && !it->second->tag.empty() && it->second->tag == to) {
+	if ((it = state.get_tags().find(thash)) != state.get_tags().end() && !it->second->tag.empty() && it->second->tag == to) {
 		return it->second;
 	}
 
@@ -261,18 +261,21 @@ Tag* parseTag(const UChar* to, const UChar* p, State& state, bool unescape=true)
 			}
 		}
 
-		for (auto iter : state.get_grammar()->regex_tags) {
+		for (auto& iter : state.get_regex_tags()) {
+			if (!iter.second.empty() && tag->tag.find(iter.second) == UString::npos) {
+				continue;
+			}
 			UErrorCode status = U_ZERO_ERROR;
-			uregex_setText(iter, tag->tag.data(), SI32(tag->tag.size()), &status);
+			uregex_setText(iter.first, tag->tag.data(), SI32(tag->tag.size()), &status);
 			if (status != U_ZERO_ERROR) {
 				state.error("%s: Error: uregex_setText(parseTag) returned %s on line %u near `%S` - cannot continue!\n", u_errorName(status), p);
 			}
 			status = U_ZERO_ERROR;
-			if (uregex_find(iter, -1, &status)) {
+			if (uregex_find(iter.first, -1, &status)) {
 				tag->type |= T_TEXTUAL;
 			}
 		}
-		for (auto iter : state.get_grammar()->icase_tags) {
+		for (auto iter : state.get_icase_tags()) {
 			if (ux_strCaseCompare(tag->tag, iter->tag)) {
 				tag->type |= T_TEXTUAL;
 			}
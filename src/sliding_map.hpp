@@ -0,0 +1,233 @@
+/*
+* Copyright (C) 2007-2025, GrammarSoft ApS
+* Developed by Tino Didriksen <mail@tinodidriksen.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this progam.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#ifndef c6d28b7452ec699b_SLIDING_MAP_HPP
+#define c6d28b7452ec699b_SLIDING_MAP_HPP
+#include <vector>
+#include <limits>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+
+namespace CG3 {
+
+/**
+ * Maps increasing numbers to pointers, for keys that live in a range which only ever moves forward, such as cohorts'
+ * global numbers while windows come and go.
+ *
+ * Entries are kept in a ring buffer indexed by key, so lookups are a subtraction and a mask. Erasing the lowest or
+ * highest key trims the range, so the buffer stays the size of the live span. Key 0 is stored on its own, since it
+ * is used as an alias for the current window's first cohort. A null value means absent, and the largest key is reserved.
+ * Iteration is in key order and, like std::map, stays valid while other keys are inserted or erased.
+ */
+template<typename T>
+class sliding_map {
+public:
+	typedef uint32_t key_type;
+	typedef T* mapped_type;
+	typedef std::pair<key_type, mapped_type> value_type;
+
+	class const_iterator {
+	private:
+		friend class sliding_map;
+		const sliding_map* sm = nullptr;
+		value_type cur{ END, nullptr };
+
+		const_iterator(const sliding_map& sm, key_type key)
+		  : sm(&sm)
+		  , cur(key, key == END ? nullptr : sm.get(key))
+		{
+		}
+
+	public:
+		const_iterator() = default;
+
+		const_iterator& operator++() {
+			cur = sm->next(cur.first);
+			return *this;
+		}
+
+		const value_type& operator*() const {
+			return cur;
+		}
+
+		const value_type* operator->() const {
+			return &cur;
+		}
+
+		bool operator==(const const_iterator& o) const {
+			return cur.first == o.cur.first;
+		}
+
+		bool operator!=(const const_iterator& o) const {
+			return cur.first != o.cur.first;
+		}
+	};
+	typedef const_iterator iterator;
+
+	const_iterator begin() const {
+		if (zero) {
+			return const_iterator(*this, 0);
+		}
+		return const_iterator(*this, next(0).first);
+	}
+
+	const_iterator end() const {
+		return const_iterator(*this, END);
+	}
+
+	const_iterator find(key_type key) const {
+		if (get(key)) {
+			return const_iterator(*this, key);
+		}
+		return end();
+	}
+
+	size_t count(key_type key) const {
+		return get(key) != nullptr;
+	}
+
+	bool empty() const {
+		return !zero && !span;
+	}
+
+	size_t capacity() const {
+		return slots.size();
+	}
+
+	// Like std::map, this makes room for an absent key; the next call drops that room again if nothing was stored in it
+	mapped_type& operator[](key_type key) {
+		if (key == 0) {
+			return zero;
+		}
+		trim();
+		if (!span) {
+			if (slots.empty()) {
+				slots.resize(16);
+			}
+			low = key;
+			span = 1;
+		}
+		else if (key < low) {
+			reserve(low + span - key);
+			span += low - key;
+			low = key;
+		}
+		else if (key >= low + span) {
+			reserve(key - low + 1);
+			span = key - low + 1;
+		}
+		return slots[key & (slots.size() - 1)];
+	}
+
+	std::pair<const_iterator, bool> insert(const value_type& kv) {
+		auto& v = (*this)[kv.first];
+		bool added = (v == nullptr);
+		if (added) {
+			v = kv.second;
+		}
+		trim();
+		return std::make_pair(const_iterator(*this, kv.first), added);
+	}
+
+	void erase(key_type key) {
+		if (key == 0) {
+			zero = nullptr;
+		}
+		else if (key >= low && key < low + span) {
+			slots[key & (slots.size() - 1)] = nullptr;
+			trim();
+		}
+	}
+
+	void clear() {
+		for (; span; --span, ++low) {
+			slots[low & (slots.size() - 1)] = nullptr;
+		}
+		zero = nullptr;
+	}
+
+private:
+	static constexpr key_type END = std::numeric_limits<key_type>::max();
+
+	std::vector<mapped_type> slots;
+	mapped_type zero = nullptr;
+	key_type low = 0;
+	key_type span = 0;
+
+	mapped_type get(key_type key) const {
+		if (key == 0) {
+			return zero;
+		}
+		if (key >= low && key - low < span) {
+			return slots[key & (slots.size() - 1)];
+		}
+		return nullptr;
+	}
+
+	value_type next(key_type key) const {
+		key_type k = (key < low) ? low : key + 1;
+		for (; k < low + span; ++k) {
+			if (auto v = slots[k & (slots.size() - 1)]) {
+				return value_type(k, v);
+			}
+		}
+		return value_type(END, nullptr);
+	}
+
+	// Drops absent entries from both ends of the range, which is what keeps the buffer from growing with the input
+	void trim() {
+		while (span && !slots[low & (slots.size() - 1)]) {
+			++low;
+			--span;
+		}
+		while (span && !slots[(low + span - 1) & (slots.size() - 1)]) {
+			--span;
+		}
+		// A far key may have stretched the buffer once; give the memory back when the live span is a fraction of it
+		if (slots.size() > 64 && span * 8 < slots.size()) {
+			resize(std::max<size_t>(16, span * 2));
+		}
+	}
+
+	void reserve(size_t n) {
+		if (n <= slots.size()) {
+			return;
+		}
+		resize(n);
+	}
+
+	// Rebuilds the buffer at the smallest power of two that holds n entries
+	void resize(size_t n) {
+		size_t cap = 16;
+		while (cap < n) {
+			cap *= 2;
+		}
+		std::vector<mapped_type> ns(cap, nullptr);
+		for (key_type k = low; k < low + span; ++k) {
+			ns[k & (cap - 1)] = slots[k & (slots.size() - 1)];
+		}
+		slots.swap(ns);
+	}
+};
+
+}
+
+#endif
@@ -0,0 +1,103 @@
+/*
+* Copyright (C) 2007-2025, GrammarSoft ApS
+* Developed by Tino Didriksen <mail@tinodidriksen.com>
+* Design by Eckhard Bick <eckhard.bick@mail.dk>, Tino Didriksen <mail@tinodidriksen.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this progam.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "MatchMemo.hpp"
+#include "Grammar.hpp"
+#include <thread>
+#include <atomic>
+#include <sstream>
+#include <cstdio>
+
+using namespace CG3;
+
+#define CHECK(x) \
+	do { \
+		if (!(x)) { \
+			fprintf(stderr, "Error: Check failed on line %d: %s\n", __LINE__, #x); \
+			return 1; \
+		} \
+	} while (0)
+
+UString text(const char* prefix, uint32_t n) {
+	UString rv;
+	for (auto p = prefix; *p; ++p) {
+		rv += static_cast<UChar>(*p);
+	}
+	for (auto c : std::to_string(n)) {
+		rv += static_cast<UChar>(c);
+	}
+	return rv;
+}
+
+int main() {
+	Grammar grammar;
+	constexpr size_t budget = 64 * 1024;
+	MatchMemo memo(grammar, budget);
+
+	// A full memo keeps taking new texts, and keeps those that are asked about
+	auto hot = text("hot", 0);
+	memo.insert(hot, 1, true);
+	for (uint32_t i = 0; i < 20000; ++i) {
+		auto t = text("cold", i);
+		memo.insert(t, 1, (i % 2) != 0);
+		memo.insert(t, 2, (i % 2) == 0);
+		CHECK(memo.find(hot, 1) == 1);
+	}
+	CHECK(memo.bytes() <= budget);
+	CHECK(memo.evictions() > 0);
+	CHECK(memo.size() < 20000);
+	CHECK(memo.find(text("cold", 19999), 2) == 0);
+	CHECK(memo.find(text("cold", 0), 1) == MatchMemo::UNKNOWN);
+
+	// What survives is what a new memo loads back
+	std::stringstream buf;
+	memo.save(buf);
+	MatchMemo loaded(grammar, budget);
+	CHECK(loaded.load(buf));
+	CHECK(loaded.size() == memo.size());
+	CHECK(loaded.find(hot, 1) == 1);
+	CHECK(loaded.find(text("cold", 19999), 1) == 1);
+
+	// Threads share one memo without losing or mixing up answers
+	MatchMemo shared(grammar, budget * 16);
+	std::atomic<int> bad{ 0 };
+	std::vector<std::thread> threads;
+	for (uint32_t n = 0; n < 4; ++n) {
+		threads.emplace_back([&, n]() {
+			for (uint32_t i = 0; i < 5000; ++i) {
+				auto t = text("t", i % 1000);
+				auto known = shared.find(t, n);
+				if (known == MatchMemo::UNKNOWN) {
+					shared.insert(t, n, ((i + n) % 3) == 0);
+				}
+				else if (known != static_cast<int>(((i % 1000 + n) % 3) == 0)) {
+					++bad;
+				}
+			}
+		});
+	}
+	for (auto& t : threads) {
+		t.join();
+	}
+	CHECK(bad == 0);
+	CHECK(shared.evictions() == 0);
+	CHECK(shared.hits() + shared.misses() == 20000);
+
+	return 0;
+}
@@ -0,0 +1,81 @@
+/*
+* Copyright (C) 2007-2025, GrammarSoft ApS
+* Developed by Tino Didriksen <mail@tinodidriksen.com>
+* Design by Eckhard Bick <eckhard.bick@mail.dk>, Tino Didriksen <mail@tinodidriksen.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this progam.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "sliding_map.hpp"
+#include <cstdio>
+
+using namespace CG3;
+
+#define CHECK(x) \
+	do { \
+		if (!(x)) { \
+			fprintf(stderr, "Error: Check failed on line %d: %s\n", __LINE__, #x); \
+			return 1; \
+		} \
+	} while (0)
+
+int main() {
+	int vals[1000] = {};
+	sliding_map<int> sm;
+
+	CHECK(sm.empty());
+	CHECK(sm.find(5) == sm.end());
+
+	// A window's worth of cohorts sliding forward, as Window::cohort_map sees them
+	for (uint32_t k = 1; k < 1000; ++k) {
+		sm[k] = &vals[k];
+		if (k > 40) {
+			sm.erase(k - 40);
+		}
+	}
+	CHECK(sm.count(959) == 0);
+	CHECK(sm.count(960) == 1);
+	CHECK(sm.find(999)->second == &vals[999]);
+	CHECK(sm.capacity() <= 64);
+
+	uint32_t expect = 960;
+	for (auto& kv : sm) {
+		CHECK(kv.first == expect);
+		CHECK(kv.second == &vals[expect]);
+		++expect;
+	}
+	CHECK(expect == 1000);
+
+	// Key 0 is an alias kept outside the range
+	sm[0] = &vals[0];
+	CHECK(sm.begin()->first == 0);
+	CHECK(sm.capacity() <= 64);
+
+	// Looking up absent keys, near or far, must not leave the buffer stretched
+	CHECK(sm.find(5000000) == sm.end());
+	CHECK(sm.capacity() <= 64);
+	CHECK(sm[2000000] == nullptr);
+	CHECK(sm[7] == nullptr);
+	sm[1000] = &vals[0];
+	CHECK(sm.capacity() <= 128);
+	CHECK(sm.count(2000000) == 0);
+	CHECK(sm.count(7) == 0);
+	CHECK(sm.begin()->first == 0);
+	CHECK((++sm.begin())->first == 960);
+
+	sm.clear();
+	CHECK(sm.empty());
+
+	return 0;
+}
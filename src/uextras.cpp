@@ -60,10 +60,163 @@ size_t findAndReplace(UnicodeString& str, UStringView from, UStringView to) {
 	return rv;
 }
 
-size_t get_line_clean(UString& line, UString& cleaned, std::istream& input, bool keep_tabs) {
+constexpr size_t STREAM_BLOCK_SIZE = 1 << 16;
+
+UStreamReader::UStreamReader(std::istream& input)
+  : input(&input)
+{
+}
+
+bool UStreamReader::fill() {
+	pos = 0;
+	chars.clear();
+
+	auto sb = input->rdbuf();
+	if (!sb) {
+		input->setstate(std::ios_base::eofbit | std::ios_base::failbit);
+		return false;
+	}
+	// Reading through the stream would have flushed the tied output on every character, so at least do it before waiting for more input
+	if (input->tie()) {
+		input->tie()->flush();
+	}
+	if (sb->sgetc() == std::char_traits<char>::eof()) {
+		input->setstate(std::ios_base::eofbit | std::ios_base::failbit);
+		return false;
+	}
+
+	auto n = static_cast<size_t>(std::max(sb->in_avail(), std::streamsize(1)));
+	n = std::min(n, STREAM_BLOCK_SIZE);
+	bytes.resize(n + 3);
+	n = static_cast<size_t>(sb->sgetn(&bytes[0], n));
+
+	// Complete a multi-byte sequence cut off at the end of the block
+	for (size_t i = n, e = (n > 4 ? n - 4 : 0); i > e; --i) {
+		auto b = static_cast<uint8_t>(bytes[i - 1]);
+		if ((b & 0xC0) == 0x80) {
+			continue;
+		}
+		size_t need = (b >= 0xF0) ? 4 : (b >= 0xE0) ? 3 : (b >= 0xC0) ? 2 : 1;
+		need -= std::min(need, n - (i - 1));
+		if (need) {
+			if (static_cast<size_t>(sb->sgetn(&bytes[n], need)) != need) {
+				throw std::runtime_error("Could not read expected bytes from stream");
+			}
+			n += need;
+		}
+		break;
+	}
+
+	// UTF-16 never needs more code units than UTF-8 needs bytes
+	chars.resize(n);
+	auto in = reinterpret_cast<const uint8_t*>(bytes.data());
+	size_t o = 0;
+	for (size_t i = 0; i < n;) {
+		// ASCII is widened 8 bytes at a time, and only the runs in between are handed to ICU
+		for (; i + 8 <= n; i += 8) {
+			uint64_t w = 0;
+			memcpy(&w, in + i, 8);
+			if (w & 0x8080808080808080ULL) {
+				break;
+			}
+			for (size_t k = 0; k < 8; ++k) {
+				chars[o++] = in[i + k];
+			}
+		}
+		for (; i < n && in[i] < 0x80; ++i) {
+			chars[o++] = in[i];
+		}
+		// Continuation bytes are never ASCII, so a non-ASCII run always ends on a whole sequence
+		size_t s = i;
+		for (; i < n && in[i] >= 0x80; ++i) {
+		}
+		if (s < i) {
+			int32_t len = 0;
+			UErrorCode err = U_ZERO_ERROR;
+			u_strFromUTF8(&chars[o], SI32(n - o), &len, &bytes[s], SI32(i - s), &err);
+			if (U_FAILURE(err)) {
+				throw std::runtime_error("Failed to convert from UTF-8 to UTF-16");
+			}
+			o += len;
+		}
+	}
+	chars.resize(o);
+
+	return true;
+}
+
+// Same contract as u_fgets(), which returns nullptr for a lone newline
+UChar* UStreamReader::gets(UChar* s, int32_t n) {
+	s[0] = 0;
+	int32_t i = 0;
+	for (; i < n; ++i) {
+		if (pos == chars.size() && !fill()) {
+			s[i] = 0;
+			break;
+		}
+		UChar c = chars[pos++];
+		s[i] = c;
+		if (ISNL(c)) {
+			break;
+		}
+	}
+	if (i < n) {
+		s[i + 1] = 0;
+	}
+
+	if (i == 0) {
+		return nullptr;
+	}
+	return s;
+}
+
+void UOutputBuffer::grow(size_t n) {
+	auto used = pptr() - pbase();
+	data.resize(std::max(data.size() * 2, used + n + CG3_BUFFER_SIZE));
+	setp(&data[0], &data[0] + data.size());
+	pbump(static_cast<int>(used));
+}
+
+std::streambuf::int_type UOutputBuffer::overflow(std::streambuf::int_type c) {
+	using traits = std::streambuf::traits_type;
+	if (traits::eq_int_type(c, traits::eof())) {
+		return traits::not_eof(c);
+	}
+	grow(1);
+	*pptr() = traits::to_char_type(c);
+	pbump(1);
+	return c;
+}
+
+std::streamsize UOutputBuffer::xsputn(const char* s, std::streamsize n) {
+	if (epptr() - pptr() < n) {
+		grow(static_cast<size_t>(n));
+	}
+	memcpy(pptr(), s, static_cast<size_t>(n));
+	pbump(static_cast<int>(n));
+	return n;
+}
+
+int UOutputBuffer::sync() {
+	flushed = true;
+	return 0;
+}
+
+void UOutputBuffer::writeTo(std::ostream& output) {
+	if (pptr() != pbase()) {
+		output.write(pbase(), pptr() - pbase());
+		setp(pbase(), epptr());
+	}
+	if (flushed) {
+		output.flush();
+		flushed = false;
+	}
+}
+
+size_t get_line_clean(UString& line, UString& cleaned, UStreamReader& input, bool keep_tabs) {
 	size_t offset = 0, packoff = 0;
 	// Read as much of the next line as will fit in the current buffer
-	while (u_fgets(&line[offset], SI32(line.size() - offset - 1), input)) {
+	while (input.gets(&line[offset], SI32(line.size() - offset - 1))) {
 		// Copy the segment just read to cleaned
 		for (; offset < line.size(); ++offset) {
 			// Only copy one space character, regardless of how many are in input
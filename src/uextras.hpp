@@ -103,6 +103,57 @@ UChar32 u_fputc(UChar32 c, std::ostream& output);
 
 namespace CG3 {
 
+/**
+ * Reads UTF-8 from a stream a block at a time and hands it out as UTF-16, as a faster replacement for u_fgetc() and u_fgets().
+ *
+ * Each block is whatever the stream has buffered, so interactive input is never waited on for longer than u_fgetc() would.
+ * Input that has been read but not yet handed out is lost when the reader is destroyed.
+ */
+class UStreamReader {
+public:
+	UStreamReader(std::istream& input);
+
+	UChar getc() {
+		if (pos == chars.size() && !fill()) {
+			return U_EOF;
+		}
+		return chars[pos++];
+	}
+
+	UChar* gets(UChar* s, int32_t n);
+
+private:
+	std::istream* input = nullptr;
+	std::string bytes;
+	UString chars;
+	size_t pos = 0;
+
+	bool fill();
+};
+
+/**
+ * An output stream that collects everything in memory, so that it can be handed to the real stream in a single write.
+ */
+class UOutputBuffer : private std::streambuf, public std::ostream {
+public:
+	UOutputBuffer()
+	  : std::ostream(this)
+	{
+	}
+
+	// Writes out everything collected so far, and flushes output if this stream was flushed in the meantime
+	void writeTo(std::ostream& output);
+
+private:
+	std::string data;
+	bool flushed = false;
+
+	void grow(size_t n);
+	std::streambuf::int_type overflow(std::streambuf::int_type c) override;
+	std::streamsize xsputn(const char* s, std::streamsize n) override;
+	int sync() override;
+};
+
 inline int ux_isSetOp(const UChar* it) {
 	switch (it[1]) {
 	case 0:
@@ -243,7 +294,7 @@ inline UChar* ux_bufcpy(UChar* dst, const UChar* src, size_t n) {
 
 std::string ux_dirname(const char* in);
 size_t findAndReplace(UnicodeString& str, UStringView from, UStringView to);
-size_t get_line_clean(UString& line, UString& cleaned, std::istream& input, bool keep_tabs = false);
+size_t get_line_clean(UString& line, UString& cleaned, UStreamReader& input, bool keep_tabs = false);
 
 }
 
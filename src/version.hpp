@@ -28,10 +28,10 @@ constexpr auto CG3_COPYRIGHT_STRING = "Copyright (C) 2007-2025 GrammarSoft ApS.
 constexpr uint32_t CG3_VERSION_MAJOR = 1;
 constexpr uint32_t CG3_VERSION_MINOR = 6;
 constexpr uint32_t CG3_VERSION_PATCH = 7;
-constexpr uint32_t CG3_REVISION = 13898;
-constexpr uint32_t CG3_FEATURE_REV = 13898;
+constexpr uint32_t CG3_REVISION = 13899;
+constexpr uint32_t CG3_FEATURE_REV = 13899;
 constexpr uint32_t CG3_TOO_OLD = 10373;
 constexpr uint32_t CG3_EXTERNAL_PROTOCOL = 7226;
-constexpr uint32_t CG3_BINARY_STREAM = 1;
+constexpr uint32_t CG3_BINARY_STREAM = 2;
 
 #endif
@@ -0,0 +1,79 @@
+#!/usr/bin/env perl
+use strict;
+use warnings;
+use Cwd qw(realpath);
+use FileHandle;
+use IPC::Open2;
+
+my ($bindir, $sep) = $0 =~ /^(.*)(\\|\/).*/;
+$bindir = realpath $bindir;
+chdir $bindir or die("Error: Could not change directory to $bindir !");
+
+my $bpath = $ARGV[0];
+my $binary = $bpath."cg-proc";
+my $compiler = $bpath."cg-comp";
+
+`"$compiler" grammar.cg3 grammar.bin  >stdout.txt 2>stderr.txt`;
+
+my $input = do {
+  local $/;
+  open my $fh, '<', 'input.txt' or die "Couldn't open input.txt for reading: $!\n";
+  <$fh>;
+};
+
+# The first window must come out as soon as the next one starts, long before the request's null is sent
+my $cut = index($input, '$', index($input, '^a/')) + 1;
+my $expected = do {
+  local $/;
+  open my $fh, '<', 'expected.txt' or die "Couldn't open expected.txt for reading: $!\n";
+  <$fh>;
+};
+my $early = substr($expected, 0, index($expected, '<sent>$') + length('<sent>$'));
+
+# Server:
+my $pid = open2(*Reader, *Writer, "$binary", "-z", "-l", "-d", "grammar.bin");
+
+# Client:
+my $tries = 10;
+my $timeout = 2;
+eval {
+  local $SIG{ALRM} = sub { die "timed out"; };
+  alarm($timeout);
+  do {
+    print Writer substr($input, 0, $cut);
+    my $got = do {
+      local $/ = '<sent>$';
+      <Reader>;
+    };
+    # Later requests start with the newline that followed the previous null
+    if ($got =~ s/^\n+//r ne $early) {
+      die "first window was not written early";
+    }
+    print Writer substr($input, $cut);
+    do {
+      local $/ = "\0";
+      $got .= <Reader> . "\n"; # input/expected have a final newline
+      open my $out, '>', "output.txt" or die "Couldn't open output.txt for writing: $!\n";
+      print $out $got;
+
+      `diff -a -B expected.txt output.txt >diff.txt`;
+      if (-s "diff.txt") {
+        last;
+      }
+      else {
+        $tries--;
+      }
+    };
+  } while ($tries > 0);
+  alarm(0);
+};
+
+if (my $e = $@) {
+  print STDERR "Fail: $e\n";
+}
+elsif ($tries != 0) {
+  print STDERR "Fail\n";
+}
+else {
+  print STDERR "Success\n";
+}
@@ -0,0 +1,85 @@
+#!/usr/bin/env perl
+use strict;
+use warnings;
+use Cwd qw(realpath);
+use File::Path qw(rmtree);
+
+my ($bindir, $sep) = $0 =~ /^(.*)(\\|\/).*/;
+$bindir = realpath $bindir;
+chdir $bindir or die("Error: Could not change directory to $bindir !");
+
+my $binary = $ARGV[0];
+my $binary_annotate = $binary;
+$binary_annotate =~ s@/vislcg3([^/]*)$@/cg-annotate$1@;
+if (!$binary_annotate || $binary_annotate eq '' || !(-x $binary_annotate)) {
+	die("Error: $binary_annotate is not executable!");
+}
+my $binary_merge = $binary;
+$binary_merge =~ s@/vislcg3([^/]*)$@/cg-merge-annotations$1@;
+if (!$binary_merge || $binary_merge eq '' || !(-x $binary_merge)) {
+	die("Error: $binary_merge is not executable!");
+}
+
+my $bad = 0;
+my @results;
+
+sub check {
+	my ($ok) = @_;
+	push(@results, $ok ? 'Success' : 'Fail');
+	$bad = 1 if !$ok;
+}
+
+# Lists the rows of times.html, which hold every rule and context with its line, text, and counts
+# Times differ from run to run, so when asked to they are left out and the rows sorted
+sub annotate {
+	my ($profile, $output, $untimed) = @_;
+	rmtree('annotated');
+	`"$binary_annotate" $profile annotated >stdout.txt 2>stderr.txt`;
+	my $ok = ($? == 0 && -s 'annotated/index.html');
+	open my $in, '<', 'annotated/times.html' or return 0;
+	open my $out, '>', $output or die "Couldn't open $output for writing: $!\n";
+	my @rows = grep { /^<tr><td>/ } <$in>;
+	if ($untimed) {
+		s@<td>[0-9.]+</td></tr>$@</tr>@ for @rows;
+		@rows = sort @rows;
+	}
+	print $out @rows;
+	close $in;
+	close $out;
+	return $ok;
+}
+
+# A profile from before the time and line columns were added
+check(annotate('profile-old.sqlite', 'output.txt') && -s 'annotated/rs/1.html');
+`diff -B expected.txt output.txt >diff.txt`;
+check(!-s 'diff.txt');
+
+# Two runs of a textual grammar, merged
+`"$binary" -g grammar.cg3 -I input.txt -O output.run.txt --profile profile-1.sqlite >stdout.run.txt 2>stderr.run.txt`;
+`"$binary" -g grammar.cg3 -I input.txt -O output.run.txt --profile profile-2.sqlite >>stdout.run.txt 2>>stderr.run.txt`;
+`"$binary_merge" profile-merged.sqlite profile-1.sqlite profile-2.sqlite >stdout.merge.txt 2>stderr.merge.txt`;
+check($? == 0 && annotate('profile-merged.sqlite', 'output.merged.txt', 1));
+`diff -B expected.merged.txt output.merged.txt >diff.merged.txt`;
+check(!-s 'diff.merged.txt');
+
+# Two sampled runs of the same grammar compiled, merged; these only know rules and contexts by line
+`"$binary" -g grammar.cg3 --grammar-only --grammar-bin profile.cg3b >>stdout.run.txt 2>>stderr.run.txt`;
+`"$binary" -g profile.cg3b -I input.txt -O output.run.txt --profile profile-b1.sqlite --profile-sample 1 >>stdout.run.txt 2>>stderr.run.txt`;
+`"$binary" -g profile.cg3b -I input.txt -O output.run.txt --profile profile-b2.sqlite --profile-sample 1 >>stdout.run.txt 2>>stderr.run.txt`;
+`"$binary_merge" profile-merged.sqlite profile-b1.sqlite profile-b2.sqlite >>stdout.merge.txt 2>>stderr.merge.txt`;
+check($? == 0 && annotate('profile-merged.sqlite', 'output.binary.txt', 1));
+`diff -B expected.binary.txt output.binary.txt >diff.binary.txt`;
+check(!-s 'diff.binary.txt');
+
+# Profiles of different grammars must not be merged, whether the grammars are textual or binary
+`"$binary" -g grammar-other.cg3 --grammar-only --grammar-bin profile.cg3b >>stdout.run.txt 2>>stderr.run.txt`;
+`"$binary" -g profile.cg3b -I input.txt -O output.run.txt --profile profile-b2.sqlite --profile-sample 1 >>stdout.run.txt 2>>stderr.run.txt`;
+`"$binary_merge" profile-merged.sqlite profile-b1.sqlite profile-b2.sqlite >>stdout.merge.txt 2>>stderr.merge.txt`;
+check($? != 0);
+`"$binary_merge" profile-merged.sqlite profile-1.sqlite profile-b1.sqlite >>stdout.merge.txt 2>>stderr.merge.txt`;
+check($? != 0);
+
+rmtree('annotated');
+unlink('profile.cg3b', 'profile-1.sqlite', 'profile-2.sqlite', 'profile-b1.sqlite', 'profile-b2.sqlite', 'profile-merged.sqlite');
+print STDERR join(' ', @results)."\n";
+exit($bad);
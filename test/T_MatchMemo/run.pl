@@ -0,0 +1,56 @@
+#!/usr/bin/env perl
+use strict;
+use warnings;
+use Cwd qw(realpath);
+
+my ($bindir, $sep) = $0 =~ /^(.*)(\\|\/).*/;
+$bindir = realpath $bindir;
+chdir $bindir or die("Error: Could not change directory to $bindir !");
+
+my $binary = $ARGV[0];
+my $bad = 0;
+my @results;
+
+sub check {
+	my ($ok) = @_;
+	push(@results, $ok ? 'Success' : 'Fail');
+	$bad = 1 if !$ok;
+}
+
+sub run_memo {
+	my ($grammar, $memo) = @_;
+	`"$binary" -v -g $grammar -I input.txt -O output.txt --match-cache $memo >stdout.txt 2>stderr.txt`;
+	`diff -B expected.txt output.txt >diff.txt`;
+	my $stderr = `cat stderr.txt`;
+	my ($hits, $misses) = $stderr =~ /^Match cache: (\d+) hits, (\d+) misses/m;
+	return ($stderr, $hits // -1, $misses // -1);
+}
+
+unlink('memo.bin', 'memo.other.bin', 'memo.cut.bin');
+
+# First run fills the memo, second run answers everything from it with the same output
+my ($stderr, $hits, $misses) = run_memo('grammar.cg3', 'memo.bin');
+check(!-s 'diff.txt' && $hits == 0 && $misses > 0 && -s 'memo.bin');
+my $all = $misses;
+($stderr, $hits, $misses) = run_memo('grammar.cg3', 'memo.bin');
+check(!-s 'diff.txt' && $hits == $all && $misses == 0);
+
+# A memo from another grammar is ignored rather than trusted
+`cp memo.bin memo.other.bin`;
+`"$binary" -v -g grammar-other.cg3 -I input.txt -O output.other.txt --match-cache memo.other.bin >stdout.other.txt 2>stderr.other.txt`;
+$stderr = `cat stderr.other.txt`;
+check($stderr =~ /different grammar/ && $stderr =~ /^Match cache: 0 hits/m);
+
+# A truncated memo still gives the entries before the cut
+open my $in, '<:raw', 'memo.bin' or die "Couldn't open memo.bin for reading: $!\n";
+my $memo = do { local $/; <$in>; };
+close $in;
+open my $out, '>:raw', 'memo.cut.bin' or die "Couldn't open memo.cut.bin for writing: $!\n";
+print $out substr($memo, 0, int(length($memo) / 2));
+close $out;
+($stderr, $hits, $misses) = run_memo('grammar.cg3', 'memo.cut.bin');
+check(!-s 'diff.txt' && $stderr !~ /different grammar/ && $hits > 0 && $misses > 0);
+
+unlink('memo.bin', 'memo.other.bin', 'memo.cut.bin');
+print STDERR join(' ', @results)."\n";
+exit($bad);